@@ -1,4 +1,9 @@
 #include "audio.h"
+#include "audio_adpcm.h"
+#include "audio_convert.h"
+#include "audio_decoder.h"
+#include "audio_flac.h"
+#include "audio_resample.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -10,16 +15,282 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 #define TAG "AUDIO"
 #define AUDIO_DMA_BUFFER_FRAMES 256
-#define AUDIO_WAV_CHUNK_BYTES (16 * 1024)
+// The prefetch ring rides out SD stalls, so DMA only has to cover the writer
+// being scheduled late. Whatever it holds is heard after a seek.
+#define AUDIO_DMA_BUFFER_COUNT 4
+#define AUDIO_DMA_EVENTS 16
+// Writes go out a DMA buffer at a time and give up after this, so a stop or
+// pause is seen within one buffer period whatever the caller passed.
+#define AUDIO_WRITE_TIMEOUT_MS 10
+#define AUDIO_NO_SEEK UINT32_MAX
+#define AUDIO_NO_FRAME UINT64_MAX
+#define AUDIO_PREFETCH_TASK_STACK 4096
+#define AUDIO_PREFETCH_TASK_PRIORITY 6
+#define AUDIO_PREFETCH_POLL_MS 20
+#define AUDIO_GAIN_UNITY 32768 // Q15
+#define AUDIO_GAIN_MIN_DB -48.0f
+// The ramp runs in Q15 with 8 more fraction bits so short steps don't stall.
+#define AUDIO_GAIN_FRAC_BITS 8
+#define AUDIO_WAVE_FORMAT_PCM 0x0001
+#define AUDIO_WAVE_FORMAT_FLOAT 0x0003
+#define AUDIO_WAVE_FORMAT_IMA_ADPCM 0x0011
+#define AUDIO_WAVE_FORMAT_EXTENSIBLE 0xFFFE
+// Samples are published in blocks, so a reader only has to stay one block
+// clear of the published head to know its copy was not overwritten.
+#define AUDIO_TAP_BLOCK (AUDIO_TAP_SAMPLES / 4)
 
 static audio_i2s_config_t s_cfg;
+static uint32_t s_output_rate; // what I2S is clocked at now
 static bool s_initialized = false;
 static volatile bool s_stop_requested = false;
+static uint32_t s_stop_count; // stop requests so far
+static volatile bool s_paused = false;
+static int64_t s_silence_requested_us; // when the last stop or pause came in
 static volatile bool s_is_playing = false;
+static int16_t s_tap[AUDIO_TAP_SAMPLES];
+static uint32_t s_tap_head;      // samples written so far, published after the samples
+static uint32_t s_tap_read_head; // reader's copy of the head at its last read
+static QueueHandle_t s_i2s_events;
+static uint64_t s_frames_written; // to I2S since audio_init
+static uint64_t s_frames_played;  // of those, consumed by DMA
+static uint64_t s_position_mark;  // s_frames_written when the track reached s_position_base
+static uint64_t s_position_base;
+static uint32_t s_position_rate; // track rate, 0 between tracks
+static uint32_t s_position_ms;   // published by the writer
+static uint32_t s_duration_ms;
+static uint32_t s_seek_ms = AUDIO_NO_SEEK; // latest request, taken by the writer
+static uint64_t s_resume_frame = AUDIO_NO_FRAME; // writer only: re-read from here after a pause
+static bool s_can_seek;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;          // 0 marks the end of the track
+    uint32_t generation; // seeks the reader had seen when it filled this
+} audio_block_t;
+
+typedef struct {
+    audio_decoder_t *decoder;
+    QueueHandle_t free_blocks;
+    QueueHandle_t filled_blocks;
+    SemaphoreHandle_t primed; // given once the ring is full or the track ended
+    SemaphoreHandle_t done;
+    volatile bool stop;
+    uint64_t seek_frame;
+    uint32_t generation; // bumped by the writer after setting seek_frame
+} audio_prefetch_t;
+
+static audio_buffer_status_t s_buffer;
+static audio_dsp_stats_t s_dsp;
+static int32_t s_gain_target = AUDIO_GAIN_UNITY; // written by audio_set_volume
+static int32_t s_gain_ramp_to = AUDIO_GAIN_UNITY;
+static int32_t s_gain = AUDIO_GAIN_UNITY << AUDIO_GAIN_FRAC_BITS;
+static int32_t s_gain_step;
+static uint32_t s_gain_ramp_left;
+
+static void audio_tap_write(const int16_t *frames, size_t count) {
+    uint32_t head = s_tap_head;
+    while (count > 0) {
+        size_t block = count < AUDIO_TAP_BLOCK ? count : AUDIO_TAP_BLOCK;
+        for (size_t i = 0; i < block; ++i) {
+            s_tap[(head + i) & (AUDIO_TAP_SAMPLES - 1)] = (int16_t)((frames[i * 2] + frames[i * 2 + 1]) >> 1);
+        }
+        head += block;
+        __atomic_store_n(&s_tap_head, head, __ATOMIC_RELEASE);
+        frames += block * 2;
+        count -= block;
+    }
+}
+
+static void audio_gain_constant(int16_t *samples, size_t count, int32_t gain) {
+    if (gain >= AUDIO_GAIN_UNITY) {
+        return;
+    }
+    if (gain <= 0) {
+        memset(samples, 0, count * sizeof(int16_t));
+        return;
+    }
+    // Gain never exceeds unity, so the product can't overflow int16.
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = (int16_t)((samples[i] * gain) >> 15);
+    }
+}
+
+// Applies the current volume to interleaved stereo frames in place.
+static void audio_gain_process(int16_t *frames, size_t count) {
+    int64_t start = esp_timer_get_time();
+    int32_t target = __atomic_load_n(&s_gain_target, __ATOMIC_RELAXED);
+    if (target != s_gain_ramp_to) {
+        s_gain_ramp_to = target;
+        s_gain_ramp_left = AUDIO_GAIN_RAMP_FRAMES;
+        s_gain_step = ((target << AUDIO_GAIN_FRAC_BITS) - s_gain) / AUDIO_GAIN_RAMP_FRAMES;
+    }
+    size_t ramped = count < s_gain_ramp_left ? count : s_gain_ramp_left;
+    for (size_t i = 0; i < ramped; ++i) {
+        s_gain += s_gain_step;
+        int32_t gain = s_gain >> AUDIO_GAIN_FRAC_BITS;
+        frames[i * 2] = (int16_t)((frames[i * 2] * gain) >> 15);
+        frames[i * 2 + 1] = (int16_t)((frames[i * 2 + 1] * gain) >> 15);
+    }
+    s_gain_ramp_left -= ramped;
+    if (s_gain_ramp_left == 0) {
+        // Land exactly on the target whatever the step rounding left.
+        s_gain = s_gain_ramp_to << AUDIO_GAIN_FRAC_BITS;
+    }
+    audio_gain_constant(frames + ramped * 2, (count - ramped) * 2, s_gain >> AUDIO_GAIN_FRAC_BITS);
+
+    size_t bytes = count * 2 * sizeof(int16_t);
+    if (bytes > 0) {
+        uint32_t cost = (uint32_t)((esp_timer_get_time() - start) * 16384 / (int64_t)bytes);
+        s_dsp.gain_us_per_16k = cost;
+        if (cost > s_dsp.max_gain_us_per_16k) {
+            s_dsp.max_gain_us_per_16k = cost;
+        }
+    }
+}
+
+// DMA reports each buffer it finishes, so the position follows what left
+// for the DAC rather than what was queued. Buffers of silence sent while the
+// writer was starved report too, and a full event queue drops some; either
+// way the count is pulled back within what DMA can hold. Events are taken
+// before counting frames just written, which they can't be about.
+static void audio_count_played(size_t frames_written) {
+    i2s_event_t event;
+    while (xQueueReceive(s_i2s_events, &event, 0) == pdPASS) {
+        if (event.type == I2S_EVENT_TX_DONE) {
+            s_frames_played += AUDIO_DMA_BUFFER_FRAMES;
+        }
+    }
+    if (s_frames_played > s_frames_written) {
+        s_frames_played = s_frames_written;
+    }
+    s_frames_written += frames_written;
+    const uint64_t capacity = AUDIO_DMA_BUFFER_COUNT * AUDIO_DMA_BUFFER_FRAMES;
+    if (s_frames_written - s_frames_played > capacity) {
+        s_frames_played = s_frames_written - capacity;
+    }
+    if (s_position_rate) {
+        uint64_t played = s_frames_played > s_position_mark ? s_frames_played - s_position_mark : 0;
+        uint64_t ms = s_position_base * 1000 / s_position_rate + played * 1000 / s_output_rate;
+        __atomic_store_n(&s_position_ms, (uint32_t)ms, __ATOMIC_RELAXED);
+    }
+}
+
+// The frames written from here on start at track frame.
+static void audio_mark_position(uint64_t frame, uint32_t rate_hz) {
+    s_position_mark = s_frames_written;
+    s_position_base = frame;
+    s_position_rate = rate_hz;
+    audio_count_played(0);
+}
+
+// Every write to I2S goes through here so the tap and the position see
+// exactly what plays. Writes at most one DMA buffer and may come back short.
+static esp_err_t audio_write(const void *data, size_t bytes, size_t *written) {
+    const size_t slice = AUDIO_DMA_BUFFER_FRAMES * 2 * sizeof(int16_t);
+    esp_err_t ret = i2s_write(s_cfg.port, data, bytes < slice ? bytes : slice, written, pdMS_TO_TICKS(AUDIO_WRITE_TIMEOUT_MS));
+    audio_tap_write(data, *written / (2 * sizeof(int16_t)));
+    audio_count_played(*written / (2 * sizeof(int16_t)));
+    return ret;
+}
+
+// Silences whatever DMA still holds, the buffer being sent included, and
+// returns how many frames of it had not been heard yet.
+static size_t audio_flush_dma(void) {
+    audio_count_played(0);
+    size_t pending = (size_t)(s_frames_written - s_frames_played);
+    i2s_zero_dma_buffer(s_cfg.port);
+    return pending;
+}
+
+static void audio_note_silence(void) {
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - s_silence_requested_us);
+    s_buffer.stop_us = elapsed;
+    if (elapsed > s_buffer.max_stop_us) {
+        s_buffer.max_stop_us = elapsed;
+    }
+}
+
+static bool audio_interrupted(void) {
+    return s_stop_requested || __atomic_load_n(&s_seek_ms, __ATOMIC_RELAXED) != AUDIO_NO_SEEK || s_resume_frame != AUDIO_NO_FRAME;
+}
+
+// Gains and writes frames, returning early if a stop or seek is requested.
+// A pause holds it here, and what the flush took from DMA is sent again on
+// resume: from these frames if they still have it, otherwise by reading the
+// track again from the last frame heard.
+static void audio_output(int16_t *frames, size_t count) {
+    audio_gain_process(frames, count);
+    const size_t bytes = count * 2 * sizeof(int16_t);
+    size_t offset = 0;
+    while (offset < bytes && !audio_interrupted()) {
+        if (s_paused) {
+            size_t pending = audio_flush_dma();
+            audio_note_silence();
+            size_t back = pending * 2 * sizeof(int16_t);
+            back = back < offset ? back : offset;
+            offset -= back;
+            s_frames_written -= back / (2 * sizeof(int16_t));
+            bool lost = back < pending * 2 * sizeof(int16_t) && s_can_seek;
+            uint64_t heard = s_frames_played > s_position_mark ? s_frames_played - s_position_mark : 0;
+            while (s_paused && !audio_interrupted()) {
+                vTaskDelay(pdMS_TO_TICKS(AUDIO_PREFETCH_POLL_MS));
+            }
+            if (lost && !audio_interrupted()) {
+                s_resume_frame = s_position_base + heard * s_position_rate / s_output_rate;
+            }
+            continue;
+        }
+        size_t written = 0;
+        audio_write((uint8_t *)frames + offset, bytes - offset, &written);
+        offset += written;
+    }
+}
+
+// out holds AUDIO_RESAMPLE_CHUNK_FRAMES frames; each pass fills at most that
+// much, so the time between writes stays bounded whatever the ratio.
+static void audio_output_resampled(audio_resampler_t *rs, int16_t *out, const int16_t *frames, size_t count) {
+    size_t produced = 0;
+    do {
+        int64_t start = esp_timer_get_time();
+        size_t used = count;
+        produced = audio_resampler_process(rs, frames, &used, out, AUDIO_RESAMPLE_CHUNK_FRAMES);
+        if (produced > 0) {
+            uint32_t cost = (uint32_t)((esp_timer_get_time() - start) * 16384 / (int64_t)(produced * 2 * sizeof(int16_t)));
+            s_dsp.resample_us_per_16k = cost;
+            if (cost > s_dsp.max_resample_us_per_16k) {
+                s_dsp.max_resample_us_per_16k = cost;
+            }
+        }
+        frames += used * 2;
+        count -= used;
+        audio_output(out, produced);
+    } while ((count > 0 || produced == AUDIO_RESAMPLE_CHUNK_FRAMES) && !audio_interrupted());
+}
+
+static bool audio_dac_rate(uint32_t rate_hz) {
+    static const uint32_t rates[] = {8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000};
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i) {
+        if (rates[i] == rate_hz) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t audio_set_output_rate(uint32_t rate_hz) {
+    if (rate_hz == s_output_rate) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(i2s_set_clk(s_cfg.port, rate_hz, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO), TAG, "Set clk failed");
+    s_output_rate = rate_hz;
+    return ESP_OK;
+}
 
 static esp_err_t audio_configure_driver(const audio_i2s_config_t *config) {
     i2s_config_t i2s_conf = {
@@ -29,14 +300,14 @@ static esp_err_t audio_configure_driver(const audio_i2s_config_t *config) {
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
+        .dma_buf_count = AUDIO_DMA_BUFFER_COUNT,
         .dma_buf_len = AUDIO_DMA_BUFFER_FRAMES,
         .use_apll = true,
         .tx_desc_auto_clear = true,
         .mclk_multiple = I2S_MCLK_MULTIPLE_256,
     };
 
-    ESP_RETURN_ON_ERROR(i2s_driver_install(config->port, &i2s_conf, 0, NULL), TAG, "i2s install failed");
+    ESP_RETURN_ON_ERROR(i2s_driver_install(config->port, &i2s_conf, AUDIO_DMA_EVENTS, &s_i2s_events), TAG, "i2s install failed");
 
     i2s_pin_config_t pin_config = {
         .mck_io_num = config->mclk_pin,
@@ -58,8 +329,14 @@ esp_err_t audio_init(const audio_i2s_config_t *config) {
     }
 
     s_cfg = *config;
+    if (s_cfg.prefetch_blocks == 0) {
+        s_cfg.prefetch_blocks = AUDIO_DEFAULT_PREFETCH_BLOCKS;
+    }
+    ESP_RETURN_ON_FALSE(s_cfg.prefetch_blocks <= AUDIO_MAX_PREFETCH_BLOCKS, ESP_ERR_INVALID_ARG, TAG, "Too many prefetch blocks");
+    s_buffer.blocks = s_cfg.prefetch_blocks;
     ESP_RETURN_ON_ERROR(audio_configure_driver(config), TAG, "Driver config failed");
     ESP_RETURN_ON_ERROR(i2s_set_clk(config->port, config->sample_rate_hz, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO), TAG, "Set clk failed");
+    s_output_rate = config->sample_rate_hz;
     s_initialized = true;
     return ESP_OK;
 }
@@ -75,14 +352,14 @@ esp_err_t audio_play_beep(float frequency_hz, uint32_t duration_ms, float volume
         volume = 0.3f;
     }
 
-    size_t total_frames = (s_cfg.sample_rate_hz * duration_ms) / 1000;
+    size_t total_frames = (s_output_rate * duration_ms) / 1000;
     size_t buffer_samples = AUDIO_DMA_BUFFER_FRAMES;
     int16_t *buffer = heap_caps_malloc(buffer_samples * 2 * sizeof(int16_t), MALLOC_CAP_DMA);
     if (!buffer) {
         return ESP_ERR_NO_MEM;
     }
 
-    float phase_increment = 2.0f * (float)M_PI * frequency_hz / (float)s_cfg.sample_rate_hz;
+    float phase_increment = 2.0f * (float)M_PI * frequency_hz / (float)s_output_rate;
     float phase = 0.0f;
     size_t generated = 0;
     while (generated < total_frames) {
@@ -97,9 +374,14 @@ esp_err_t audio_play_beep(float frequency_hz, uint32_t duration_ms, float volume
                 phase -= 2.0f * (float)M_PI;
             }
         }
+        audio_gain_process(buffer, frames_now);
         size_t bytes_to_write = frames_now * 2 * sizeof(int16_t);
-        size_t written = 0;
-        i2s_write(s_cfg.port, buffer, bytes_to_write, &written, portMAX_DELAY);
+        size_t offset = 0;
+        while (offset < bytes_to_write) {
+            size_t written = 0;
+            audio_write((uint8_t *)buffer + offset, bytes_to_write - offset, &written);
+            offset += written;
+        }
         generated += frames_now;
     }
 
@@ -107,110 +389,649 @@ esp_err_t audio_play_beep(float frequency_hz, uint32_t duration_ms, float volume
     return ESP_OK;
 }
 
-#pragma pack(push, 1)
 typedef struct {
-    char chunk_id[4];
-    uint32_t chunk_size;
-    char format[4];
-    char subchunk1_id[4];
-    uint32_t subchunk1_size;
-    uint16_t audio_format;
-    uint16_t num_channels;
+    audio_pcm_format_t format;
     uint32_t sample_rate;
-    uint32_t byte_rate;
-    uint16_t block_align;
-    uint16_t bits_per_sample;
-    char subchunk2_id[4];
-    uint32_t subchunk2_size;
-} wav_header_t;
-#pragma pack(pop)
-
-esp_err_t audio_play_wav_file(const char *path) {
-    if (!s_initialized || !path) {
-        return ESP_ERR_INVALID_STATE;
-    }
+    uint32_t data_bytes;
+    uint16_t adpcm_block; // block_align of IMA ADPCM data, 0 for PCM
+    uint32_t fact_frames; // from the fact chunk, 0 if there is none
+} audio_wav_info_t;
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s", path);
-        return ESP_FAIL;
+// PCM straight from the data chunk, converted in the block it was read into,
+// or IMA ADPCM read a block at a time and decoded into the ring.
+typedef struct {
+    audio_decoder_t base;
+    FILE *file;
+    long data_offset;
+    uint32_t data_bytes;
+    uint32_t remaining;
+    audio_pcm_format_t format;
+    audio_dither_t dither;
+    uint16_t adpcm_bytes;
+    uint64_t frames_left;
+    uint32_t block_us; // decode time of the current ADPCM block so far
+    audio_adpcm_block_t adpcm;
+    uint8_t *block;
+} audio_wav_decoder_t;
+
+static uint16_t audio_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t audio_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static esp_err_t audio_wav_format(const uint8_t *fmt, uint32_t size, audio_wav_info_t *info) {
+    uint16_t tag = audio_le16(fmt);
+    uint16_t channels = audio_le16(fmt + 2);
+    uint16_t block_align = audio_le16(fmt + 12);
+    uint16_t bits = audio_le16(fmt + 14);
+    if (tag == AUDIO_WAVE_FORMAT_EXTENSIBLE && size >= 40) {
+        // The SubFormat GUID opens with the plain format tag. bits is the
+        // container size; fewer valid bits still convert correctly.
+        tag = audio_le16(fmt + 24);
+    }
+    info->sample_rate = audio_le32(fmt + 4);
+    info->format.channels = (uint8_t)channels;
+    info->adpcm_block = 0;
+    if (tag == AUDIO_WAVE_FORMAT_IMA_ADPCM && bits == 4) {
+        // Blocks are whole words per channel with at least one code word.
+        info->format.sample = AUDIO_SAMPLE_S16;
+        info->adpcm_block = block_align;
+        if ((channels != 1 && channels != 2) || block_align % (4 * channels) || block_align < 8 * channels ||
+            block_align > AUDIO_ADPCM_MAX_BLOCK_BYTES || info->sample_rate == 0) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        return ESP_OK;
+    } else if (tag == AUDIO_WAVE_FORMAT_FLOAT && bits == 32) {
+        info->format.sample = AUDIO_SAMPLE_F32;
+    } else if (tag != AUDIO_WAVE_FORMAT_PCM) {
+        return ESP_ERR_NOT_SUPPORTED;
+    } else if (bits == 8) {
+        info->format.sample = AUDIO_SAMPLE_U8;
+    } else if (bits == 16) {
+        info->format.sample = AUDIO_SAMPLE_S16;
+    } else if (bits == 24) {
+        info->format.sample = AUDIO_SAMPLE_S24;
+    } else if (bits == 32) {
+        info->format.sample = AUDIO_SAMPLE_S32;
+    } else {
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    if ((channels != 1 && channels != 2) || block_align != audio_pcm_frame_bytes(&info->format) || info->sample_rate == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
 
-    wav_header_t header;
-    size_t read = fread(&header, 1, sizeof(header), f);
-    if (read != sizeof(header) || strncmp(header.chunk_id, "RIFF", 4) != 0 || strncmp(header.format, "WAVE", 4) != 0 || strncmp(header.subchunk1_id, "fmt ", 4) != 0) {
+// Walks the RIFF chunks up to "data", leaving the file at the first sample.
+static esp_err_t audio_wav_parse(FILE *f, audio_wav_info_t *info) {
+    uint8_t riff[12];
+    if (fread(riff, 1, sizeof(riff), f) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
         ESP_LOGE(TAG, "Invalid WAV header");
-        fclose(f);
         return ESP_ERR_INVALID_ARG;
     }
+    bool have_format = false;
+    info->fact_frames = 0;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk)) {
+        uint32_t size = audio_le32(chunk + 4);
+        if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_format) {
+                ESP_LOGE(TAG, "WAV data before fmt");
+                return ESP_ERR_INVALID_ARG;
+            }
+            info->data_bytes = size;
+            return ESP_OK;
+        }
+        uint32_t skip = size + (size & 1);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[40];
+            size_t want = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (size < 16 || fread(fmt, 1, want, f) != want) {
+                ESP_LOGE(TAG, "Invalid WAV fmt chunk");
+                return ESP_ERR_INVALID_ARG;
+            }
+            esp_err_t ret = audio_wav_format(fmt, size, info);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Unsupported WAV format");
+                return ret;
+            }
+            have_format = true;
+            skip -= want;
+        } else if (memcmp(chunk, "fact", 4) == 0 && size >= 4) {
+            // Compressed data pads its last block; this says where it ends.
+            uint8_t frames[4];
+            if (fread(frames, 1, sizeof(frames), f) != sizeof(frames)) {
+                break;
+            }
+            info->fact_frames = audio_le32(frames);
+            skip -= sizeof(frames);
+        }
+        if (skip && fseek(f, skip, SEEK_CUR) != 0) {
+            break;
+        }
+    }
+    ESP_LOGE(TAG, "No WAV data chunk");
+    return ESP_ERR_NOT_FOUND;
+}
 
-    if (header.audio_format != 1 || header.num_channels != 2 || header.bits_per_sample != 16 || header.sample_rate != s_cfg.sample_rate_hz) {
-        ESP_LOGE(TAG, "Unsupported WAV format");
-        fclose(f);
-        return ESP_ERR_NOT_SUPPORTED;
+size_t audio_source_read(FILE *f, void *dst, size_t bytes) {
+    if (s_cfg.read_callback) {
+        s_cfg.read_callback(true, s_cfg.read_user_data);
+    }
+    int64_t start = esp_timer_get_time();
+    size_t got = fread(dst, 1, bytes, f);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (s_cfg.read_callback) {
+        s_cfg.read_callback(false, s_cfg.read_user_data);
+    }
+    if (elapsed > s_buffer.max_read_us) {
+        s_buffer.max_read_us = elapsed;
+    }
+    return got;
+}
+
+static size_t audio_wav_read(audio_decoder_t *decoder, uint8_t *dst, size_t bytes) {
+    audio_wav_decoder_t *wav = (audio_wav_decoder_t *)decoder;
+    // Reads are sized so both the file's frames and the stereo int16 they
+    // convert to fit in dst.
+    const size_t frame_bytes = audio_pcm_frame_bytes(&wav->format);
+    size_t want = bytes / (frame_bytes > 4 ? frame_bytes : 4) * frame_bytes;
+    if (wav->remaining < want) {
+        want = wav->remaining;
+    }
+    size_t frames = audio_source_read(wav->file, dst, want) / frame_bytes;
+    wav->remaining -= frames * frame_bytes;
+    if (frames > 0 && (wav->format.sample != AUDIO_SAMPLE_S16 || wav->format.channels != 2)) {
+        int64_t start = esp_timer_get_time();
+        size_t out = audio_convert_frames(dst, frames, &wav->format, &wav->dither);
+        uint32_t cost = (uint32_t)((esp_timer_get_time() - start) * 16384 / (int64_t)out);
+        s_dsp.convert_us_per_16k = cost;
+        if (cost > s_dsp.max_convert_us_per_16k) {
+            s_dsp.max_convert_us_per_16k = cost;
+        }
     }
+    return frames;
+}
 
-    if (strncmp(header.subchunk2_id, "data", 4) != 0) {
-        ESP_LOGW(TAG, "Non-standard WAV, attempting to locate data chunk");
-        char chunk_id[4];
-        uint32_t chunk_size = 0;
-        bool data_found = false;
-        while (fread(chunk_id, 1, 4, f) == 4) {
-            if (fread(&chunk_size, 1, 4, f) != 4) {
+static size_t audio_wav_read_adpcm(audio_decoder_t *decoder, uint8_t *dst, size_t bytes) {
+    audio_wav_decoder_t *wav = (audio_wav_decoder_t *)decoder;
+    int16_t *out = (int16_t *)dst;
+    size_t want = bytes / (2 * sizeof(int16_t));
+    if (want > wav->frames_left) {
+        want = (size_t)wav->frames_left;
+    }
+    size_t done = 0;
+    while (done < want) {
+        if (wav->adpcm.pos == wav->adpcm.frames) {
+            size_t len = wav->remaining < wav->adpcm_bytes ? wav->remaining : wav->adpcm_bytes;
+            len = audio_source_read(wav->file, wav->block, len);
+            wav->remaining -= len;
+            if (!audio_adpcm_begin(&wav->adpcm, wav->block, len, wav->format.channels)) {
                 break;
             }
-            if (memcmp(chunk_id, "data", 4) == 0) {
-                data_found = true;
-                header.subchunk2_size = chunk_size;
-                break;
+        }
+        int64_t start = esp_timer_get_time();
+        done += audio_adpcm_decode(&wav->adpcm, out + done * 2, want - done);
+        wav->block_us += (uint32_t)(esp_timer_get_time() - start);
+        if (wav->adpcm.pos == wav->adpcm.frames) {
+            decoder->frame_us = wav->block_us;
+            if (wav->block_us > decoder->max_frame_us) {
+                decoder->max_frame_us = wav->block_us;
             }
-            fseek(f, chunk_size, SEEK_CUR);
+            wav->block_us = 0;
         }
-        if (!data_found) {
-            fclose(f);
-            return ESP_ERR_NOT_FOUND;
+    }
+    wav->frames_left -= done;
+    return done;
+}
+
+// PCM frames map straight onto the data chunk. Each ADPCM block carries its
+// own predictor state, so that restarts at the block holding frame and
+// decodes its way up to it.
+static esp_err_t audio_wav_seek(audio_decoder_t *decoder, uint64_t frame) {
+    audio_wav_decoder_t *wav = (audio_wav_decoder_t *)decoder;
+    if (decoder->total_frames && frame > decoder->total_frames) {
+        frame = decoder->total_frames;
+    }
+    uint64_t offset = frame * audio_pcm_frame_bytes(&wav->format);
+    uint64_t skip = 0;
+    if (wav->adpcm_bytes) {
+        const uint32_t block_frames = audio_adpcm_block_frames(wav->adpcm_bytes, wav->format.channels);
+        offset = frame / block_frames * wav->adpcm_bytes;
+        skip = frame % block_frames;
+    }
+    if (offset > wav->data_bytes) {
+        offset = wav->data_bytes;
+    }
+    ESP_RETURN_ON_FALSE(fseek(wav->file, wav->data_offset + (long)offset, SEEK_SET) == 0, ESP_FAIL, TAG, "WAV seek failed");
+    wav->remaining = wav->data_bytes - (uint32_t)offset;
+    if (!wav->adpcm_bytes) {
+        return ESP_OK;
+    }
+    wav->frames_left = decoder->total_frames ? decoder->total_frames - (frame - skip) : UINT64_MAX;
+    wav->adpcm.pos = wav->adpcm.frames;
+    wav->block_us = 0;
+    int16_t scratch[64 * 2];
+    while (skip > 0) {
+        size_t want = skip < 64 ? (size_t)skip : 64;
+        size_t got = audio_wav_read_adpcm(decoder, (uint8_t *)scratch, want * 2 * sizeof(int16_t));
+        if (got == 0) {
+            break;
         }
+        skip -= got;
     }
+    return ESP_OK;
+}
 
-    uint8_t *buffer = heap_caps_malloc(AUDIO_WAV_CHUNK_BYTES, MALLOC_CAP_DMA);
-    if (!buffer) {
-        fclose(f);
-        return ESP_ERR_NO_MEM;
+static void audio_wav_close(audio_decoder_t *decoder) {
+    heap_caps_free(decoder);
+}
+
+static esp_err_t audio_wav_open(FILE *f, audio_decoder_t **decoder) {
+    audio_wav_info_t info;
+    ESP_RETURN_ON_ERROR(audio_wav_parse(f, &info), TAG, "Not a playable WAV");
+    // An ADPCM block is read whole, into a buffer that comes with the decoder.
+    audio_wav_decoder_t *wav = heap_caps_calloc(1, sizeof(*wav) + info.adpcm_block, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ESP_RETURN_ON_FALSE(wav, ESP_ERR_NO_MEM, TAG, "No memory for decoder");
+    wav->base.read = audio_wav_read;
+    wav->base.seek = audio_wav_seek;
+    wav->base.close = audio_wav_close;
+    wav->base.sample_rate = info.sample_rate;
+    wav->base.total_frames = info.data_bytes / audio_pcm_frame_bytes(&info.format);
+    if (info.adpcm_block) {
+        const uint32_t header = 4u * info.format.channels;
+        const uint32_t block_frames = audio_adpcm_block_frames(info.adpcm_block, info.format.channels);
+        const uint32_t tail = info.data_bytes % info.adpcm_block;
+        const uint64_t frames = (uint64_t)(info.data_bytes / info.adpcm_block) * block_frames + (tail >= header ? (tail - header) / header * 8 + 1 : 0);
+        // Only trust fact to trim padding from the last block; some writers
+        // fill it with something else.
+        const bool trim = info.fact_frames && info.fact_frames < frames && info.fact_frames + block_frames > frames;
+        wav->base.read = audio_wav_read_adpcm;
+        wav->base.total_frames = trim ? info.fact_frames : frames;
+        wav->frames_left = info.data_bytes ? wav->base.total_frames : UINT64_MAX;
+        wav->adpcm_bytes = info.adpcm_block;
+        wav->block = (uint8_t *)(wav + 1);
+    }
+    wav->file = f;
+    wav->data_offset = ftell(f);
+    wav->data_bytes = info.data_bytes ? info.data_bytes : UINT32_MAX;
+    wav->remaining = wav->data_bytes;
+    wav->format = info.format;
+    wav->dither.state = 0x9E3779B9;
+    *decoder = &wav->base;
+    return ESP_OK;
+}
+
+// Picks the decoder from the first bytes of the file rather than its name.
+static esp_err_t audio_open_decoder(FILE *f, audio_decoder_t **decoder) {
+    uint8_t magic[4];
+    size_t got = fread(magic, 1, sizeof(magic), f);
+    if (fseek(f, 0, SEEK_SET) != 0 || got != sizeof(magic)) {
+        ESP_LOGE(TAG, "File too short");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (memcmp(magic, "fLaC", 4) == 0 || memcmp(magic, "ID3", 3) == 0) {
+        return audio_flac_open(f, decoder);
+    }
+    return audio_wav_open(f, decoder);
+}
+
+static void audio_prefetch_task(void *arg) {
+    audio_prefetch_t *p = arg;
+    audio_decoder_t *decoder = p->decoder;
+    audio_block_t block;
+    uint32_t generation = 0;
+    bool failed = false;
+    bool ended = false;
+    while (!p->stop) {
+        // Wake up now and then so a stop is seen while the writer is stalled.
+        if (xQueueReceive(p->free_blocks, &block, pdMS_TO_TICKS(AUDIO_PREFETCH_POLL_MS)) != pdPASS) {
+            continue;
+        }
+        // A seek restarts reading, even once the end was queued.
+        uint32_t wanted = __atomic_load_n(&p->generation, __ATOMIC_ACQUIRE);
+        if (wanted != generation) {
+            generation = wanted;
+            failed = decoder->seek(decoder, p->seek_frame) != ESP_OK;
+            ended = false;
+            s_buffer.eof = false;
+        }
+        if (ended) {
+            xQueueSend(p->free_blocks, &block, 0);
+            vTaskDelay(pdMS_TO_TICKS(AUDIO_PREFETCH_POLL_MS));
+            continue;
+        }
+        size_t frames = failed ? 0 : decoder->read(decoder, block.data, AUDIO_PREFETCH_BLOCK_BYTES);
+        block.len = frames * 2 * sizeof(int16_t);
+        block.generation = generation;
+        if (frames > 0) {
+            s_dsp.decode_frame_us = decoder->frame_us;
+            if (decoder->max_frame_us > s_dsp.max_decode_frame_us) {
+                s_dsp.max_decode_frame_us = decoder->max_frame_us;
+            }
+        }
+        xQueueSend(p->filled_blocks, &block, portMAX_DELAY);
+        s_buffer.filled = (uint8_t)uxQueueMessagesWaiting(p->filled_blocks);
+        if (frames == 0) {
+            ended = true;
+            s_buffer.eof = true;
+            xSemaphoreGive(p->primed);
+        } else if (s_buffer.filled >= s_buffer.blocks) {
+            xSemaphoreGive(p->primed);
+        }
+    }
+    xSemaphoreGive(p->done);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t audio_play_prefetched(audio_decoder_t *decoder, uint32_t stops) {
+    const uint8_t blocks = s_buffer.blocks;
+    const uint32_t rate_hz = decoder->sample_rate;
+    audio_prefetch_t p = {
+        .decoder = decoder,
+        .free_blocks = xQueueCreate(blocks, sizeof(audio_block_t)),
+        .filled_blocks = xQueueCreate(blocks, sizeof(audio_block_t)),
+        .primed = xSemaphoreCreateBinary(),
+        .done = xSemaphoreCreateBinary(),
+    };
+    uint8_t *memory = heap_caps_malloc((size_t)blocks * AUDIO_PREFETCH_BLOCK_BYTES, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    audio_block_t block = {0};
+    audio_resampler_t rs = {0};
+    int16_t *resampled = NULL;
+    esp_err_t ret = ESP_OK;
+    if (!memory || !p.free_blocks || !p.filled_blocks || !p.primed || !p.done) {
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+    if (rate_hz != s_output_rate) {
+        ret = audio_resampler_init(&rs, rate_hz, s_output_rate);
+        resampled = heap_caps_malloc(AUDIO_RESAMPLE_CHUNK_FRAMES * 2 * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (ret == ESP_OK && !resampled) {
+            ret = ESP_ERR_NO_MEM;
+        }
+        if (ret != ESP_OK) {
+            goto cleanup;
+        }
+    }
+    for (uint8_t i = 0; i < blocks; ++i) {
+        block.data = memory + (size_t)i * AUDIO_PREFETCH_BLOCK_BYTES;
+        xQueueSend(p.free_blocks, &block, 0);
     }
 
+    s_buffer.filled = 0;
+    s_buffer.low_water = blocks;
+    s_buffer.eof = false;
+    s_buffer.max_read_us = 0;
+    // A stop that came in while the file was being opened still applies.
     s_stop_requested = false;
+    if (__atomic_load_n(&s_stop_count, __ATOMIC_ACQUIRE) != stops) {
+        s_stop_requested = true;
+    }
+    s_paused = false;
+    __atomic_store_n(&s_seek_ms, AUDIO_NO_SEEK, __ATOMIC_RELAXED);
+    s_resume_frame = AUDIO_NO_FRAME;
+    s_can_seek = decoder->seek != NULL;
+    s_duration_ms = (uint32_t)(decoder->total_frames * 1000 / rate_hz);
+    audio_mark_position(0, rate_hz);
     s_is_playing = true;
+    if (xTaskCreatePinnedToCore(audio_prefetch_task, "audio_prefetch", AUDIO_PREFETCH_TASK_STACK, &p, AUDIO_PREFETCH_TASK_PRIORITY, NULL, 0) != pdPASS) {
+        s_is_playing = false;
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
 
+    // Fill the ring before the first write so playback starts with its full
+    // margin against SD stalls.
+    while (!audio_interrupted() && xSemaphoreTake(p.primed, pdMS_TO_TICKS(AUDIO_PREFETCH_POLL_MS)) != pdPASS) {
+    }
+    uint32_t generation = 0;
+    int64_t seek_start = 0;
+    bool refilling = false;
     while (!s_stop_requested) {
-        size_t bytes_read = fread(buffer, 1, AUDIO_WAV_CHUNK_BYTES, f);
-        if (bytes_read == 0) {
-            break;
+        uint32_t seek_ms = __atomic_exchange_n(&s_seek_ms, AUDIO_NO_SEEK, __ATOMIC_ACQUIRE);
+        // A resume that has to re-read goes the same way as a seek.
+        uint64_t frame = s_resume_frame;
+        s_resume_frame = AUDIO_NO_FRAME;
+        if (seek_ms != AUDIO_NO_SEEK) {
+            frame = (uint64_t)seek_ms * rate_hz / 1000;
         }
-        size_t offset = 0;
-        while (offset < bytes_read && !s_stop_requested) {
-            size_t bytes_to_write = bytes_read - offset;
-            size_t written = 0;
-            i2s_write(s_cfg.port, buffer + offset, bytes_to_write, &written, portMAX_DELAY);
-            offset += written;
+        if (frame != AUDIO_NO_FRAME) {
+            // Everything read so far is stale: hand it back so the reader
+            // can start over at once, and silence what DMA still holds.
+            seek_start = esp_timer_get_time();
+            refilling = true;
+            if (decoder->total_frames && frame > decoder->total_frames) {
+                frame = decoder->total_frames;
+            }
+            p.seek_frame = frame;
+            __atomic_store_n(&p.generation, ++generation, __ATOMIC_RELEASE);
+            while (xQueueReceive(p.filled_blocks, &block, 0) == pdPASS) {
+                xQueueSend(p.free_blocks, &block, 0);
+            }
+            audio_flush_dma();
+            if (resampled) {
+                audio_resampler_reset(&rs);
+            }
+            audio_mark_position(frame, rate_hz);
+        }
+        if (xQueueReceive(p.filled_blocks, &block, 0) != pdPASS) {
+            if (!seek_start) {
+                s_buffer.underruns++;
+            }
+            bool got = false;
+            while (!audio_interrupted() && !got) {
+                got = xQueueReceive(p.filled_blocks, &block, pdMS_TO_TICKS(AUDIO_PREFETCH_POLL_MS)) == pdPASS;
+            }
+            if (!got) {
+                continue;
+            }
         }
-        if (bytes_read < AUDIO_WAV_CHUNK_BYTES) {
+        if (block.generation != generation) {
+            xQueueSend(p.free_blocks, &block, 0);
+            continue;
+        }
+        UBaseType_t waiting = uxQueueMessagesWaiting(p.filled_blocks);
+        s_buffer.filled = (uint8_t)waiting;
+        if (block.len == 0) {
+            if (resampled) {
+                // Flush the filter's look-ahead so the track ends whole.
+                static const int16_t silence[AUDIO_RESAMPLE_TAPS] = {0};
+                audio_output_resampled(&rs, resampled, silence, AUDIO_RESAMPLE_TAPS / 2);
+            }
             break;
         }
+        if (seek_start) {
+            // The first sought frame is heard once DMA has played out what
+            // is queued ahead of it.
+            uint64_t ahead = s_frames_written - s_frames_played;
+            uint32_t elapsed = (uint32_t)(esp_timer_get_time() - seek_start + (int64_t)(ahead * 1000000 / s_output_rate));
+            s_buffer.seek_us = elapsed;
+            if (elapsed > s_buffer.max_seek_us) {
+                s_buffer.max_seek_us = elapsed;
+            }
+            seek_start = 0;
+        }
+        // A seek empties the ring on purpose; that isn't margin lost.
+        if (refilling) {
+            refilling = waiting + 1 < s_buffer.blocks && !s_buffer.eof;
+        } else if (waiting < s_buffer.low_water) {
+            s_buffer.low_water = (uint8_t)waiting;
+        }
+        size_t frames = block.len / (2 * sizeof(int16_t));
+        if (resampled) {
+            audio_output_resampled(&rs, resampled, (const int16_t *)block.data, frames);
+        } else {
+            audio_output((int16_t *)block.data, frames);
+        }
+        xQueueSend(p.free_blocks, &block, 0);
     }
 
-    heap_caps_free(buffer);
-    fclose(f);
-    s_is_playing = false;
     if (s_stop_requested) {
-        s_stop_requested = false;
+        // A track that ends plays out; a stopped one is cut off now.
+        audio_flush_dma();
+        if (!s_paused) {
+            audio_note_silence();
+        }
     }
-    return ESP_OK;
+    p.stop = true;
+    xSemaphoreTake(p.done, portMAX_DELAY);
+    s_buffer.filled = 0;
+    s_is_playing = false;
+    s_stop_requested = false;
+    s_paused = false;
+    s_position_rate = 0;
+    __atomic_store_n(&s_position_ms, 0, __ATOMIC_RELAXED);
+    s_duration_ms = 0;
+
+cleanup:
+    audio_resampler_deinit(&rs);
+    heap_caps_free(resampled);
+    heap_caps_free(memory);
+    if (p.free_blocks) {
+        vQueueDelete(p.free_blocks);
+    }
+    if (p.filled_blocks) {
+        vQueueDelete(p.filled_blocks);
+    }
+    if (p.primed) {
+        vSemaphoreDelete(p.primed);
+    }
+    if (p.done) {
+        vSemaphoreDelete(p.done);
+    }
+    return ret;
+}
+
+esp_err_t audio_play_wav_file(const char *path, uint32_t stops) {
+    if (!s_initialized || !path) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return ESP_FAIL;
+    }
+
+    audio_decoder_t *decoder = NULL;
+    esp_err_t ret = audio_open_decoder(f, &decoder);
+    if (ret != ESP_OK) {
+        fclose(f);
+        return ret;
+    }
+
+    // Re-clocking is exact; rates the DAC can't take are resampled to the
+    // configured one instead.
+    uint32_t out_rate = s_cfg.reclock_per_track && audio_dac_rate(decoder->sample_rate) ? decoder->sample_rate : s_cfg.sample_rate_hz;
+    ret = audio_set_output_rate(out_rate);
+    if (ret == ESP_OK) {
+        ret = audio_play_prefetched(decoder, stops);
+    }
+    decoder->close(decoder);
+    fclose(f);
+    return ret;
 }
 
 void audio_request_stop(void) {
+    s_silence_requested_us = esp_timer_get_time();
+    __atomic_add_fetch(&s_stop_count, 1, __ATOMIC_RELEASE);
     s_stop_requested = true;
 }
 
+uint32_t audio_get_stop_count(void) {
+    return __atomic_load_n(&s_stop_count, __ATOMIC_ACQUIRE);
+}
+
+esp_err_t audio_set_paused(bool paused) {
+    if (!s_is_playing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (paused && !s_paused) {
+        s_silence_requested_us = esp_timer_get_time();
+    }
+    s_paused = paused;
+    return ESP_OK;
+}
+
+bool audio_is_paused(void) {
+    return s_is_playing && s_paused;
+}
+
+esp_err_t audio_seek_ms(uint32_t position_ms) {
+    if (!s_is_playing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_can_seek) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (position_ms == AUDIO_NO_SEEK) {
+        position_ms--;
+    }
+    __atomic_store_n(&s_seek_ms, position_ms, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+uint32_t audio_get_position_ms(void) {
+    return __atomic_load_n(&s_position_ms, __ATOMIC_RELAXED);
+}
+
+uint32_t audio_get_duration_ms(void) {
+    return s_duration_ms;
+}
+
+void audio_set_volume(uint8_t volume_percent) {
+    int32_t gain = 0;
+    if (volume_percent >= 100) {
+        gain = AUDIO_GAIN_UNITY;
+    } else if (volume_percent > 0) {
+        float db = AUDIO_GAIN_MIN_DB * (float)(100 - volume_percent) / 99.0f;
+        gain = (int32_t)(powf(10.0f, db / 20.0f) * AUDIO_GAIN_UNITY + 0.5f);
+    }
+    __atomic_store_n(&s_gain_target, gain, __ATOMIC_RELAXED);
+}
+
+void audio_get_dsp_stats(audio_dsp_stats_t *stats) {
+    if (stats) {
+        *stats = s_dsp;
+    }
+}
+
+uint32_t audio_get_output_rate(void) {
+    return s_output_rate;
+}
+
 bool audio_is_playing(void) {
     return s_is_playing;
 }
+
+void audio_get_buffer_status(audio_buffer_status_t *status) {
+    if (status) {
+        *status = s_buffer;
+    }
+}
+
+bool audio_is_buffered(void) {
+    return s_is_playing && (s_buffer.eof || s_buffer.filled * 2 >= s_buffer.blocks);
+}
+
+bool audio_tap_read(int16_t *dst, size_t count) {
+    if (!dst || count == 0 || count > AUDIO_TAP_SAMPLES / 2) {
+        return false;
+    }
+    uint32_t head = __atomic_load_n(&s_tap_head, __ATOMIC_ACQUIRE);
+    if (head == s_tap_read_head || head < count) {
+        return false;
+    }
+    s_tap_read_head = head;
+    uint32_t start = head - count;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = s_tap[(start + i) & (AUDIO_TAP_SAMPLES - 1)];
+    }
+    // The writer may be up to a block past the head it last published.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint32_t now = __atomic_load_n(&s_tap_head, __ATOMIC_RELAXED);
+    return now + AUDIO_TAP_BLOCK - start <= AUDIO_TAP_SAMPLES;
+}
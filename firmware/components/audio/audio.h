@@ -8,6 +8,10 @@
 #include "driver/i2s.h"
 #include "esp_err.h"
 
+// Called with true before and false after each block read from the file, on
+// the reader task, so access to a shared bus can be arbitrated.
+typedef void (*audio_read_callback_t)(bool begin, void *user_data);
+
 typedef struct {
     i2s_port_t port;
     gpio_num_t mclk_pin;
@@ -15,10 +19,89 @@ typedef struct {
     gpio_num_t lrclk_pin;
     gpio_num_t dout_pin;
     uint32_t sample_rate_hz;
+    // Re-clock I2S to each track's rate when it is a standard one; otherwise
+    // every track is resampled to sample_rate_hz, which keeps playlists gapless.
+    bool reclock_per_track;
+    uint8_t prefetch_blocks; // PCM ring depth, 0 = AUDIO_DEFAULT_PREFETCH_BLOCKS
+    audio_read_callback_t read_callback;
+    void *read_user_data;
 } audio_i2s_config_t;
 
+// Playback decodes the file on its own task into a ring of blocks ahead of
+// the I2S writer, so an SD stall (the card shares its bus with the display)
+// only costs ring depth instead of an underrun.
+#define AUDIO_PREFETCH_BLOCK_BYTES 4096
+#define AUDIO_DEFAULT_PREFETCH_BLOCKS 8
+#define AUDIO_MAX_PREFETCH_BLOCKS 32
+
+typedef struct {
+    uint8_t blocks;       // ring depth
+    uint8_t filled;       // blocks read ahead of the writer
+    uint8_t low_water;    // fewest filled blocks the writer has seen this track
+    bool eof;             // the reader has queued the end of the track
+    uint32_t underruns;   // writer found the ring empty, since audio_init
+    uint32_t max_read_us; // slowest single block read this track
+    uint32_t seek_us;     // last seek, or resume that re-read, until its first frame reaches the DAC
+    uint32_t max_seek_us; // since audio_init
+    uint32_t stop_us;     // last stop or pause request until DMA was silenced
+    uint32_t max_stop_us; // since audio_init
+} audio_buffer_status_t;
+
+// Volume is applied in Q15 on the way to I2S. A new target is reached over
+// AUDIO_GAIN_RAMP_FRAMES with a per-frame linear ramp, so fast knob turns
+// don't click.
+#define AUDIO_GAIN_RAMP_FRAMES 512
+
+typedef struct {
+    uint32_t gain_us_per_16k;     // gain stage cost of the last block, scaled to 16 KB
+    uint32_t max_gain_us_per_16k;
+    uint32_t resample_us_per_16k; // last resampler pass, per 16 KB of output
+    uint32_t max_resample_us_per_16k;
+    uint32_t convert_us_per_16k; // last format conversion, per 16 KB of output
+    uint32_t max_convert_us_per_16k;
+    uint32_t decode_frame_us; // CPU time for the last FLAC frame or ADPCM block
+    uint32_t max_decode_frame_us;
+} audio_dsp_stats_t;
+
+// Mono mix of everything written to I2S, kept for visualisers. The audio
+// path only ever overwrites the oldest samples; it never waits for a reader.
+#define AUDIO_TAP_SAMPLES 2048
+
 esp_err_t audio_init(const audio_i2s_config_t *config);
 esp_err_t audio_play_beep(float frequency_hz, uint32_t duration_ms, float volume);
-esp_err_t audio_play_wav_file(const char *path);
+// Plays a WAV (mono or stereo PCM at 8, 16, 24 or 32 bits, 32-bit float or
+// IMA ADPCM, including WAVE_FORMAT_EXTENSIBLE) or a FLAC file, told apart by
+// content; either is converted to stereo int16 as it is read.
+// Any stop requested after audio_get_stop_count() returned stops cancels the
+// track, even one that comes in while the file is still being opened.
+esp_err_t audio_play_wav_file(const char *path, uint32_t stops);
+// Stops the playing track; what DMA holds is silenced rather than played out.
 void audio_request_stop(void);
+// Stop requests so far.
+uint32_t audio_get_stop_count(void);
+// Holds the track where it is, silencing DMA at once, and carries on from
+// the same frame when cleared. Seeks still apply while paused.
+// ESP_ERR_INVALID_STATE if nothing is playing.
+esp_err_t audio_set_paused(bool paused);
+bool audio_is_paused(void);
+// Moves the playing track to position_ms; callable from any task. Requests
+// the writer hasn't reached yet replace each other, so a burst of them costs
+// one seek. ESP_ERR_INVALID_STATE if nothing is playing.
+esp_err_t audio_seek_ms(uint32_t position_ms);
+// Position of what has been played out by I2S DMA, not what was decoded;
+// 0 when nothing is playing.
+uint32_t audio_get_position_ms(void);
+// 0 if nothing is playing or the file doesn't say.
+uint32_t audio_get_duration_ms(void);
+// 0 mutes, 1..100 maps onto -48..0 dB.
+void audio_set_volume(uint8_t volume_percent);
+void audio_get_dsp_stats(audio_dsp_stats_t *stats);
 bool audio_is_playing(void);
+uint32_t audio_get_output_rate(void);
+void audio_get_buffer_status(audio_buffer_status_t *status);
+// True once the ring is at least half full or holds the rest of the track.
+bool audio_is_buffered(void);
+// Copies the newest count samples (at most AUDIO_TAP_SAMPLES / 2), oldest
+// first. Returns false if nothing was written since the last call or the
+// writer lapped the copy. Only one task may read.
+bool audio_tap_read(int16_t *dst, size_t count);
@@ -0,0 +1,85 @@
+#include "audio_adpcm.h"
+
+static const int16_t s_steps[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,    31,    34,    37,
+    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,   130,   143,   157,   173,   190,   209,
+    230,   253,   279,   307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,   1060,  1166,
+    1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,
+    7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+static const int8_t s_index_adjust[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+static inline int16_t audio_adpcm_step(audio_adpcm_channel_t *ch, uint32_t code) {
+    const int32_t step = s_steps[ch->index];
+    int32_t diff = step >> 3;
+    if (code & 4) {
+        diff += step;
+    }
+    if (code & 2) {
+        diff += step >> 1;
+    }
+    if (code & 1) {
+        diff += step >> 2;
+    }
+    int32_t p = (code & 8) ? ch->predictor - diff : ch->predictor + diff;
+    p = p > INT16_MAX ? INT16_MAX : (p < INT16_MIN ? INT16_MIN : p);
+    ch->predictor = p;
+    int32_t index = ch->index + s_index_adjust[code];
+    ch->index = index < 0 ? 0 : (index > 88 ? 88 : index);
+    return (int16_t)p;
+}
+
+bool audio_adpcm_begin(audio_adpcm_block_t *block, const uint8_t *data, size_t bytes, uint8_t channels) {
+    const size_t header = 4u * channels;
+    if (channels < 1 || channels > 2 || bytes < header) {
+        return false;
+    }
+    for (uint8_t c = 0; c < channels; ++c) {
+        const uint8_t *h = data + c * 4;
+        block->state[c].predictor = (int16_t)(h[0] | (h[1] << 8));
+        block->state[c].index = h[2] > 88 ? 88 : h[2];
+    }
+    block->data = data + header;
+    block->channels = channels;
+    // A short block still holds whole words for every channel.
+    block->frames = (uint32_t)((bytes - header) / header) * 8 + 1;
+    block->pos = 0;
+    return true;
+}
+
+size_t audio_adpcm_decode(audio_adpcm_block_t *block, int16_t *dst, size_t frames) {
+    size_t n = block->frames - block->pos;
+    if (n > frames) {
+        n = frames;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    const uint8_t channels = block->channels;
+    size_t first = block->pos;
+    size_t out = 0;
+    if (first == 0) {
+        dst[0] = (int16_t)block->state[0].predictor;
+        dst[1] = (int16_t)block->state[channels - 1].predictor;
+        first = 1;
+        out = 1;
+    }
+    const size_t end = block->pos + n;
+    for (uint8_t c = 0; c < channels; ++c) {
+        audio_adpcm_channel_t st = block->state[c];
+        int16_t *o = dst + out * 2 + c;
+        for (size_t f = first; f < end; ++f, o += 2) {
+            // Code k of a channel is nibble k % 8 of its word in group k / 8.
+            const size_t k = f - 1;
+            const uint8_t byte = block->data[((k >> 3) * channels + c) * 4 + ((k & 7) >> 1)];
+            o[0] = audio_adpcm_step(&st, (byte >> ((k & 1) << 2)) & 0x0F);
+            if (channels == 1) {
+                o[1] = o[0];
+            }
+        }
+        block->state[c] = st;
+    }
+    block->pos = (uint32_t)end;
+    return n;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// IMA ADPCM as WAVE_FORMAT_IMA_ADPCM stores it. A block opens with a 4-byte
+// header per channel (first sample, step index), then 4-byte words of eight
+// 4-bit codes, one word per channel in turn, low nibble first.
+#define AUDIO_ADPCM_MAX_BLOCK_BYTES 8192
+
+typedef struct {
+    int32_t predictor;
+    int32_t index;
+} audio_adpcm_channel_t;
+
+typedef struct {
+    const uint8_t *data; // first code word after the headers
+    uint8_t channels;
+    uint32_t frames; // in this block, the header frame included
+    uint32_t pos;    // next frame to decode
+    audio_adpcm_channel_t state[2];
+} audio_adpcm_block_t;
+
+// Frames in a whole block of block_bytes.
+static inline uint32_t audio_adpcm_block_frames(size_t block_bytes, uint8_t channels) {
+    return (uint32_t)(block_bytes / (4u * channels) - 1) * 8 + 1;
+}
+
+// Starts decoding a block of bytes (the last one in a file may be short).
+// block must stay valid until it is decoded. False if it is too short.
+bool audio_adpcm_begin(audio_adpcm_block_t *block, const uint8_t *data, size_t bytes, uint8_t channels);
+// Decodes up to frames of the block as stereo int16 (mono is duplicated)
+// and returns how many; any split of a block decodes the same.
+size_t audio_adpcm_decode(audio_adpcm_block_t *block, int16_t *dst, size_t frames);
@@ -0,0 +1,155 @@
+#include "audio_convert.h"
+
+#include <string.h>
+
+static inline uint32_t audio_dither_next(audio_dither_t *dither) {
+    uint32_t x = dither->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    dither->state = x;
+    return x;
+}
+
+static inline int16_t audio_sat16(int32_t v) {
+    return v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : (int16_t)v);
+}
+
+// Drops the low 8 bits of a 24-bit sample with TPDF dither of +-1 output LSB.
+static inline int16_t audio_s24_to_s16(int32_t v, uint32_t r) {
+    int32_t d = (int32_t)(r & 0xFF) - (int32_t)((r >> 8) & 0xFF);
+    return audio_sat16((v + d + 128) >> 8);
+}
+
+void audio_convert_u8(uint8_t *buf, size_t count) {
+    int16_t *dst = (int16_t *)buf;
+    for (size_t i = count; i-- > 0;) {
+        dst[i] = (int16_t)(((int32_t)buf[i] - 128) << 8);
+    }
+}
+
+void audio_convert_s24(uint8_t *buf, size_t count, audio_dither_t *dither) {
+    int16_t *dst = (int16_t *)buf;
+    size_t i = 0;
+    // Four packed samples are three aligned words; all three are loaded
+    // before the 8 output bytes land on the first two.
+    const uint32_t *src = (const uint32_t *)buf;
+    for (; i + 4 <= count; i += 4, src += 3) {
+        uint32_t w0 = src[0];
+        uint32_t w1 = src[1];
+        uint32_t w2 = src[2];
+        int32_t s0 = (int32_t)(w0 << 8) >> 8;
+        int32_t s1 = (int32_t)(((w0 >> 24) | (w1 << 8)) << 8) >> 8;
+        int32_t s2 = (int32_t)(((w1 >> 16) | (w2 << 16)) << 8) >> 8;
+        int32_t s3 = (int32_t)w2 >> 8;
+        uint32_t r0 = audio_dither_next(dither);
+        uint32_t r1 = audio_dither_next(dither);
+        dst[i] = audio_s24_to_s16(s0, r0);
+        dst[i + 1] = audio_s24_to_s16(s1, r0 >> 16);
+        dst[i + 2] = audio_s24_to_s16(s2, r1);
+        dst[i + 3] = audio_s24_to_s16(s3, r1 >> 16);
+    }
+    for (; i < count; ++i) {
+        const uint8_t *p = buf + i * 3;
+        int32_t s = (int32_t)(((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)) << 8) >> 8;
+        dst[i] = audio_s24_to_s16(s, audio_dither_next(dither));
+    }
+}
+
+void audio_convert_s32(uint8_t *buf, size_t count, audio_dither_t *dither) {
+    const int32_t *src = (const int32_t *)buf;
+    int16_t *dst = (int16_t *)buf;
+    // Bits below the 24th are under the dither anyway.
+    for (size_t i = 0; i < count; i += 2) {
+        uint32_t r = audio_dither_next(dither);
+        dst[i] = audio_s24_to_s16(src[i] >> 8, r);
+        if (i + 1 < count) {
+            dst[i + 1] = audio_s24_to_s16(src[i + 1] >> 8, r >> 16);
+        }
+    }
+}
+
+void audio_convert_f32(uint8_t *buf, size_t count, audio_dither_t *dither) {
+    const float *src = (const float *)buf;
+    int16_t *dst = (int16_t *)buf;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t r = audio_dither_next(dither);
+        float d = (float)((int32_t)(r & 0xFFFF) - (int32_t)(r >> 16)) * (1.0f / 65536.0f);
+        float v = src[i] * 32768.0f + d;
+        // Written so NaN lands on the negative rail rather than in undefined
+        // territory.
+        if (!(v >= -32768.0f)) {
+            dst[i] = INT16_MIN;
+        } else if (v >= 32767.0f) {
+            dst[i] = INT16_MAX;
+        } else {
+            // Truncation and the remainder are both exact in float, so this
+            // rounds half away from zero without a biased add.
+            int32_t n = (int32_t)v;
+            float frac = v - (float)n;
+            n += frac >= 0.5f ? 1 : (frac <= -0.5f ? -1 : 0);
+            dst[i] = (int16_t)n;
+        }
+    }
+}
+
+void audio_upmix_mono(int16_t *buf, size_t count) {
+    for (size_t i = count; i-- > 0;) {
+        int16_t s = buf[i];
+        buf[i * 2] = s;
+        buf[i * 2 + 1] = s;
+    }
+}
+
+void audio_convert_planar(int16_t *dst, const int32_t *left, const int32_t *right, size_t frames, uint8_t bits, audio_dither_t *dither) {
+    if (bits <= 16) {
+        const int shift = 16 - bits;
+        for (size_t i = 0; i < frames; ++i) {
+            dst[i * 2] = (int16_t)((uint32_t)left[i] << shift);
+            dst[i * 2 + 1] = (int16_t)((uint32_t)right[i] << shift);
+        }
+        return;
+    }
+    // Scaled up to 24 bits, the 24-bit rounding and dither apply unchanged.
+    const int shift = 24 - bits;
+    if (left == right) {
+        // Mono keeps both channels identical, so it takes the same dither.
+        for (size_t i = 0; i < frames; i += 2) {
+            uint32_t r = audio_dither_next(dither);
+            dst[i * 2] = dst[i * 2 + 1] = audio_s24_to_s16((int32_t)((uint32_t)left[i] << shift), r);
+            if (i + 1 < frames) {
+                dst[i * 2 + 2] = dst[i * 2 + 3] = audio_s24_to_s16((int32_t)((uint32_t)left[i + 1] << shift), r >> 16);
+            }
+        }
+        return;
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        uint32_t r = audio_dither_next(dither);
+        dst[i * 2] = audio_s24_to_s16((int32_t)((uint32_t)left[i] << shift), r);
+        dst[i * 2 + 1] = audio_s24_to_s16((int32_t)((uint32_t)right[i] << shift), r >> 16);
+    }
+}
+
+size_t audio_convert_frames(uint8_t *buf, size_t frames, const audio_pcm_format_t *format, audio_dither_t *dither) {
+    const size_t count = frames * format->channels;
+    switch (format->sample) {
+        case AUDIO_SAMPLE_U8:
+            audio_convert_u8(buf, count);
+            break;
+        case AUDIO_SAMPLE_S24:
+            audio_convert_s24(buf, count, dither);
+            break;
+        case AUDIO_SAMPLE_S32:
+            audio_convert_s32(buf, count, dither);
+            break;
+        case AUDIO_SAMPLE_F32:
+            audio_convert_f32(buf, count, dither);
+            break;
+        default:
+            break;
+    }
+    if (format->channels == 1) {
+        audio_upmix_mono((int16_t *)buf, frames);
+    }
+    return frames * 2 * sizeof(int16_t);
+}
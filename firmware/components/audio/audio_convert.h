@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample layouts a WAV may carry. Everything is converted to interleaved
+// stereo int16 in place, in the buffer it was read into.
+typedef enum {
+    AUDIO_SAMPLE_S16 = 0,
+    AUDIO_SAMPLE_U8,
+    AUDIO_SAMPLE_S24,
+    AUDIO_SAMPLE_S32,
+    AUDIO_SAMPLE_F32,
+} audio_sample_format_t;
+
+typedef struct {
+    audio_sample_format_t sample;
+    uint8_t channels; // 1 or 2
+} audio_pcm_format_t;
+
+// TPDF dither for the kernels that drop bits: two uniform values per sample,
+// one output LSB wide each, from a xorshift generator.
+typedef struct {
+    uint32_t state;
+} audio_dither_t;
+
+static inline size_t audio_sample_bytes(audio_sample_format_t sample) {
+    static const uint8_t bytes[] = {2, 1, 3, 4, 4};
+    return bytes[sample];
+}
+
+static inline size_t audio_pcm_frame_bytes(const audio_pcm_format_t *format) {
+    return audio_sample_bytes(format->sample) * format->channels;
+}
+
+// Kernels rewrite count samples in place as int16. u8 grows the data and
+// runs back to front; the rest shrink it and run front to back. buf must be
+// 4-byte aligned.
+void audio_convert_u8(uint8_t *buf, size_t count);
+void audio_convert_s24(uint8_t *buf, size_t count, audio_dither_t *dither);
+void audio_convert_s32(uint8_t *buf, size_t count, audio_dither_t *dither);
+void audio_convert_f32(uint8_t *buf, size_t count, audio_dither_t *dither);
+// Duplicates count mono int16 samples into stereo frames, back to front.
+void audio_upmix_mono(int16_t *buf, size_t count);
+
+// Interleaves decoded planes of bits-wide samples (8..24) as stereo int16;
+// pass the same plane twice for mono. Widths over 16 bits are dithered.
+void audio_convert_planar(int16_t *dst, const int32_t *left, const int32_t *right, size_t frames, uint8_t bits, audio_dither_t *dither);
+
+// Converts frames of format to stereo int16 in place and returns the bytes
+// that make up; buf must hold max(input, frames * 4) bytes.
+size_t audio_convert_frames(uint8_t *buf, size_t frames, const audio_pcm_format_t *format, audio_dither_t *dither);
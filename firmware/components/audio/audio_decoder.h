@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+
+// A decoder turns an open file into stereo int16 frames for the prefetch
+// reader. Implementations embed this as their first member and allocate
+// everything they need when they are opened, so playback itself never
+// touches the heap.
+typedef struct audio_decoder_s audio_decoder_t;
+
+struct audio_decoder_s {
+    // Fills up to bytes of dst (4-byte aligned) with stereo int16 frames and
+    // returns how many; 0 at the end of the track or on a decode error.
+    size_t (*read)(audio_decoder_t *decoder, uint8_t *dst, size_t bytes);
+    // Moves so the next read starts at frame; NULL if the format can't seek.
+    esp_err_t (*seek)(audio_decoder_t *decoder, uint64_t frame);
+    // Frees the decoder. The file stays open.
+    void (*close)(audio_decoder_t *decoder);
+    uint32_t sample_rate;
+    uint64_t total_frames; // 0 if the header doesn't say
+    uint32_t frame_us;     // CPU time for the last coded frame, file reads excluded
+    uint32_t max_frame_us; // since the decoder was opened
+};
+
+// Reads from a track's file, bracketed by the bus callback and timed into
+// the buffer status. Decoders read through this and nothing else.
+size_t audio_source_read(FILE *f, void *dst, size_t bytes);
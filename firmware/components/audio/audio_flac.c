@@ -0,0 +1,698 @@
+#include "audio_flac.h"
+#include "audio_convert.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define TAG "AUDIO_FLAC"
+#define AUDIO_FLAC_INPUT_BYTES 4096
+#define AUDIO_FLAC_HEADER_MAX 16 // longest frame header, CRC-8 included
+#define AUDIO_FLAC_STREAMINFO 0
+#define AUDIO_FLAC_SEEKTABLE 3
+#define AUDIO_FLAC_SEEKPOINT_BYTES 18
+#define AUDIO_FLAC_PLACEHOLDER UINT64_MAX
+#define AUDIO_FLAC_LEFT_SIDE 8
+#define AUDIO_FLAC_RIGHT_SIDE 9
+#define AUDIO_FLAC_MID_SIDE 10
+
+// Bits are taken MSB first from a left-aligned 64-bit cache, refilled a
+// byte at a time from the input buffer. Bits below the valid ones are zero.
+typedef struct {
+    FILE *file;
+    uint64_t cache;
+    int bits;         // valid bits in cache
+    size_t pos;       // next byte of buf to load into the cache
+    size_t len;       // bytes in buf
+    uint32_t read_us; // time spent in file reads, so decode time can leave it out
+    bool eof;
+    bool error; // a read ran past the end of the file
+    uint8_t buf[AUDIO_FLAC_INPUT_BYTES];
+} audio_flac_bits_t;
+
+typedef struct {
+    uint64_t sample;
+    uint32_t offset; // from the first frame
+} audio_flac_seekpoint_t;
+
+typedef struct {
+    uint64_t first_sample;
+    uint32_t block_size;
+    uint8_t assignment; // channel assignment code
+} audio_flac_frame_t;
+
+typedef struct {
+    audio_decoder_t base;
+    audio_flac_bits_t bits;
+    audio_dither_t dither;
+    uint32_t min_block;
+    uint32_t max_block;
+    uint8_t channels;
+    uint8_t bps;
+    uint32_t first_frame; // file offset of the first frame
+    uint32_t stream_end;  // file size
+    uint16_t seekpoint_count;
+    audio_flac_seekpoint_t seekpoints[AUDIO_FLAC_MAX_SEEKPOINTS];
+    uint64_t frame_first;  // first sample of the decoded frame
+    uint32_t frame_samples;
+    uint32_t frame_pos;    // next sample of the decoded frame to hand out
+    uint64_t skip_to;      // drop samples before this after a seek
+    uint8_t md5[16];       // of the decoded stream, from STREAMINFO
+    int32_t *samples[2];   // one block per channel
+} audio_flac_t;
+
+static uint32_t audio_flac_be(const uint8_t *p, size_t bytes) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static uint8_t audio_flac_crc8(const uint8_t *p, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= p[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+static size_t audio_flac_input(audio_flac_bits_t *b, uint8_t *dst, size_t bytes) {
+    int64_t start = esp_timer_get_time();
+    size_t got = audio_source_read(b->file, dst, bytes);
+    b->read_us += (uint32_t)(esp_timer_get_time() - start);
+    return got;
+}
+
+static void audio_flac_fill(audio_flac_bits_t *b) {
+    while (b->bits <= 56) {
+        if (b->pos == b->len) {
+            if (b->eof) {
+                return;
+            }
+            b->pos = 0;
+            b->len = audio_flac_input(b, b->buf, sizeof(b->buf));
+            if (b->len == 0) {
+                b->eof = true;
+                return;
+            }
+        }
+        b->cache |= (uint64_t)b->buf[b->pos++] << (56 - b->bits);
+        b->bits += 8;
+    }
+}
+
+// n is at most 32.
+static inline uint32_t audio_flac_bits(audio_flac_bits_t *b, int n) {
+    if (n == 0) {
+        return 0;
+    }
+    if (b->bits < n) {
+        audio_flac_fill(b);
+        if (b->bits < n) {
+            b->error = true;
+            return 0;
+        }
+    }
+    uint32_t v = (uint32_t)(b->cache >> (64 - n));
+    b->cache <<= n;
+    b->bits -= n;
+    return v;
+}
+
+static inline int32_t audio_flac_signed(audio_flac_bits_t *b, int n) {
+    if (n == 0) {
+        return 0;
+    }
+    return (int32_t)(audio_flac_bits(b, n) << (32 - n)) >> (32 - n);
+}
+
+// Counts zero bits up to and including the next one bit.
+static inline uint32_t audio_flac_unary(audio_flac_bits_t *b) {
+    uint32_t zeros = 0;
+    for (;;) {
+        if (b->cache != 0) {
+            int z = __builtin_clzll(b->cache);
+            b->cache = z < 63 ? b->cache << (z + 1) : 0;
+            b->bits -= z + 1;
+            return zeros + (uint32_t)z;
+        }
+        zeros += (uint32_t)b->bits;
+        b->bits = 0;
+        audio_flac_fill(b);
+        if (b->bits == 0) {
+            b->error = true;
+            return zeros;
+        }
+    }
+}
+
+static void audio_flac_align(audio_flac_bits_t *b) {
+    audio_flac_bits(b, b->bits & 7);
+}
+
+// Copies up to n bytes ahead of a byte-aligned reader without consuming them.
+static size_t audio_flac_peek(audio_flac_bits_t *b, uint8_t *dst, size_t n) {
+    size_t have = 0;
+    for (int shift = 56; have < n && shift >= 64 - b->bits; shift -= 8) {
+        dst[have++] = (uint8_t)(b->cache >> shift);
+    }
+    if (b->len - b->pos < n - have && !b->eof) {
+        memmove(b->buf, b->buf + b->pos, b->len - b->pos);
+        b->len -= b->pos;
+        b->pos = 0;
+        size_t got = audio_flac_input(b, b->buf + b->len, sizeof(b->buf) - b->len);
+        b->len += got;
+        b->eof = got == 0;
+    }
+    size_t take = b->len - b->pos < n - have ? b->len - b->pos : n - have;
+    memcpy(dst + have, b->buf + b->pos, take);
+    return have + take;
+}
+
+static void audio_flac_skip(audio_flac_bits_t *b, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        audio_flac_bits(b, 8);
+    }
+}
+
+static bool audio_flac_reposition(audio_flac_bits_t *b, uint32_t offset) {
+    b->cache = 0;
+    b->bits = 0;
+    b->pos = 0;
+    b->len = 0;
+    b->eof = false;
+    b->error = false;
+    return fseek(b->file, offset, SEEK_SET) == 0;
+}
+
+// Parses a frame header from p and returns its length, or 0 if p doesn't
+// hold one this stream could have written.
+static size_t audio_flac_parse_header(const audio_flac_t *dec, const uint8_t *p, size_t avail, audio_flac_frame_t *fh) {
+    if (avail < 5 || p[0] != 0xFF || (p[1] & 0xFE) != 0xF8) {
+        return 0;
+    }
+    const uint8_t size_code = p[2] >> 4;
+    const uint8_t rate_code = p[2] & 0x0F;
+    const uint8_t assignment = p[3] >> 4;
+    const uint8_t bits_code = (p[3] >> 1) & 0x07;
+    static const uint8_t bits[] = {0, 8, 12, 0, 16, 20, 24, 32};
+    if ((p[3] & 1) || size_code == 0 || rate_code == 15 || assignment > AUDIO_FLAC_MID_SIDE) {
+        return 0;
+    }
+    if ((assignment < AUDIO_FLAC_LEFT_SIDE ? assignment + 1 : 2) != dec->channels) {
+        return 0;
+    }
+    if (bits_code != 0 && bits[bits_code] != dec->bps) {
+        return 0;
+    }
+
+    // The frame or sample number, UTF-8 style: the lead byte's run of ones
+    // counts the bytes.
+    size_t n = 4;
+    const uint8_t lead = p[n++];
+    const int ones = __builtin_clz(~((uint32_t)lead << 24));
+    if (ones == 1 || ones == 8) {
+        return 0;
+    }
+    const int extra = ones ? ones - 1 : 0;
+    uint64_t number = lead & (0x7F >> ones);
+    if (n + extra > avail) {
+        return 0;
+    }
+    for (int i = 0; i < extra; ++i, ++n) {
+        if ((p[n] & 0xC0) != 0x80) {
+            return 0;
+        }
+        number = (number << 6) | (p[n] & 0x3F);
+    }
+
+    size_t tail = (size_code == 6 ? 1 : size_code == 7 ? 2 : 0) + (rate_code == 12 ? 1 : rate_code >= 13 ? 2 : 0);
+    if (n + tail + 1 > avail) {
+        return 0;
+    }
+    if (size_code == 1) {
+        fh->block_size = 192;
+    } else if (size_code <= 5) {
+        fh->block_size = 576u << (size_code - 2);
+    } else if (size_code <= 7) {
+        fh->block_size = audio_flac_be(p + n, size_code - 5) + 1;
+        n += size_code - 5;
+    } else {
+        fh->block_size = 256u << (size_code - 8);
+    }
+    // Coded rates are only there for decoders that skip STREAMINFO.
+    n += rate_code == 12 ? 1 : rate_code >= 13 ? 2 : 0;
+    if (audio_flac_crc8(p, n) != p[n]) {
+        return 0;
+    }
+    if (fh->block_size > dec->max_block) {
+        return 0;
+    }
+    // A fixed-blocksize stream numbers frames, not samples.
+    fh->first_sample = (p[1] & 1) ? number : number * dec->max_block;
+    fh->assignment = assignment;
+    return n + 1;
+}
+
+// Finds the next frame header with a valid CRC-8, skipping anything that
+// isn't one, and leaves the reader just past it.
+static bool audio_flac_sync(audio_flac_t *dec, audio_flac_frame_t *fh) {
+    audio_flac_bits_t *b = &dec->bits;
+    uint8_t head[AUDIO_FLAC_HEADER_MAX];
+    audio_flac_align(b);
+    for (;;) {
+        size_t avail = audio_flac_peek(b, head, sizeof(head));
+        if (avail == 0) {
+            return false;
+        }
+        size_t len = audio_flac_parse_header(dec, head, avail, fh);
+        if (len) {
+            audio_flac_skip(b, len);
+            return true;
+        }
+        audio_flac_bits(b, 8);
+    }
+}
+
+static bool audio_flac_residual(audio_flac_bits_t *b, int32_t *out, uint32_t block_size, uint32_t order) {
+    const uint32_t method = audio_flac_bits(b, 2);
+    if (method > 1) {
+        return false;
+    }
+    const int param_bits = method ? 5 : 4;
+    const uint32_t escape = method ? 31 : 15;
+    const uint32_t partition_order = audio_flac_bits(b, 4);
+    const uint32_t partition_size = block_size >> partition_order;
+    if ((partition_size << partition_order) != block_size || partition_size < order) {
+        return false;
+    }
+    uint32_t i = order;
+    for (uint32_t part = 0; part < (1u << partition_order); ++part) {
+        const uint32_t end = (part + 1) * partition_size;
+        const uint32_t k = audio_flac_bits(b, param_bits);
+        if (k == escape) {
+            const int raw = (int)audio_flac_bits(b, 5);
+            for (; i < end; ++i) {
+                out[i] = audio_flac_signed(b, raw);
+            }
+            continue;
+        }
+        for (; i < end; ++i) {
+            uint32_t v = (audio_flac_unary(b) << k) | audio_flac_bits(b, (int)k);
+            out[i] = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+        }
+    }
+    return !b->error;
+}
+
+static void audio_flac_fixed(int32_t *s, uint32_t n, uint32_t order) {
+    switch (order) {
+        case 1:
+            for (uint32_t i = 1; i < n; ++i) {
+                s[i] += s[i - 1];
+            }
+            break;
+        case 2:
+            for (uint32_t i = 2; i < n; ++i) {
+                s[i] += 2 * s[i - 1] - s[i - 2];
+            }
+            break;
+        case 3:
+            for (uint32_t i = 3; i < n; ++i) {
+                s[i] += 3 * (s[i - 1] - s[i - 2]) + s[i - 3];
+            }
+            break;
+        case 4:
+            for (uint32_t i = 4; i < n; ++i) {
+                s[i] += 4 * (s[i - 1] + s[i - 3]) - 6 * s[i - 2] - s[i - 4];
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void audio_flac_lpc(int32_t *s, uint32_t n, const int32_t *coeffs, uint32_t order, int shift, bool wide) {
+    if (wide) {
+        for (uint32_t i = order; i < n; ++i) {
+            int64_t sum = 0;
+            for (uint32_t j = 0; j < order; ++j) {
+                sum += (int64_t)coeffs[j] * s[i - 1 - j];
+            }
+            s[i] += (int32_t)(sum >> shift);
+        }
+        return;
+    }
+    for (uint32_t i = order; i < n; ++i) {
+        int32_t sum = 0;
+        for (uint32_t j = 0; j < order; ++j) {
+            sum += coeffs[j] * s[i - 1 - j];
+        }
+        s[i] += sum >> shift;
+    }
+}
+
+static bool audio_flac_subframe(audio_flac_bits_t *b, int32_t *out, uint32_t n, int bps) {
+    if (audio_flac_bits(b, 1) != 0) {
+        return false;
+    }
+    const uint32_t type = audio_flac_bits(b, 6);
+    int wasted = 0;
+    if (audio_flac_bits(b, 1)) {
+        wasted = (int)audio_flac_unary(b) + 1;
+        if (wasted >= bps) {
+            return false;
+        }
+        bps -= wasted;
+    }
+
+    if (type == 0) {
+        const int32_t v = audio_flac_signed(b, bps);
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = v;
+        }
+    } else if (type == 1) {
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = audio_flac_signed(b, bps);
+        }
+    } else if (type >= 8 && type <= 12) {
+        const uint32_t order = type - 8;
+        if (order > n) {
+            return false;
+        }
+        for (uint32_t i = 0; i < order; ++i) {
+            out[i] = audio_flac_signed(b, bps);
+        }
+        if (!audio_flac_residual(b, out, n, order)) {
+            return false;
+        }
+        audio_flac_fixed(out, n, order);
+    } else if (type >= 32) {
+        const uint32_t order = type - 31;
+        if (order > n) {
+            return false;
+        }
+        for (uint32_t i = 0; i < order; ++i) {
+            out[i] = audio_flac_signed(b, bps);
+        }
+        const uint32_t precision = audio_flac_bits(b, 4) + 1;
+        const int shift = audio_flac_signed(b, 5);
+        if (precision == 16 || shift < 0) {
+            return false;
+        }
+        int32_t coeffs[32];
+        for (uint32_t i = 0; i < order; ++i) {
+            coeffs[i] = audio_flac_signed(b, (int)precision);
+        }
+        if (!audio_flac_residual(b, out, n, order)) {
+            return false;
+        }
+        // Same bound libFLAC uses to pick its 32-bit kernels.
+        const int order_bits = 31 - __builtin_clz(order);
+        audio_flac_lpc(out, n, coeffs, order, shift, bps + (int)precision + order_bits > 32);
+    } else {
+        return false;
+    }
+    if (wasted) {
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = (int32_t)((uint32_t)out[i] << wasted);
+        }
+    }
+    return !b->error;
+}
+
+static void audio_flac_decorrelate(audio_flac_t *dec, uint8_t assignment, uint32_t n) {
+    int32_t *a = dec->samples[0];
+    int32_t *c = dec->samples[1];
+    switch (assignment) {
+        case AUDIO_FLAC_LEFT_SIDE:
+            for (uint32_t i = 0; i < n; ++i) {
+                c[i] = a[i] - c[i];
+            }
+            break;
+        case AUDIO_FLAC_RIGHT_SIDE:
+            for (uint32_t i = 0; i < n; ++i) {
+                a[i] += c[i];
+            }
+            break;
+        case AUDIO_FLAC_MID_SIDE:
+            for (uint32_t i = 0; i < n; ++i) {
+                int32_t side = c[i];
+                int32_t mid = (int32_t)((uint32_t)a[i] << 1) | (side & 1);
+                a[i] = (mid + side) >> 1;
+                c[i] = (mid - side) >> 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Decodes the next frame into samples[]. A frame that fails to decode is
+// played as silence and the next header is searched for.
+static bool audio_flac_decode_frame(audio_flac_t *dec) {
+    audio_flac_bits_t *b = &dec->bits;
+    audio_flac_frame_t fh;
+    if (!audio_flac_sync(dec, &fh)) {
+        return false;
+    }
+    const int64_t start = esp_timer_get_time();
+    const uint32_t read_before = b->read_us;
+    bool ok = true;
+    for (uint8_t ch = 0; ch < dec->channels && ok; ++ch) {
+        // The side channel carries one more bit.
+        int bps = dec->bps;
+        if ((fh.assignment == AUDIO_FLAC_LEFT_SIDE && ch == 1) || (fh.assignment == AUDIO_FLAC_RIGHT_SIDE && ch == 0) ||
+            (fh.assignment == AUDIO_FLAC_MID_SIDE && ch == 1)) {
+            bps++;
+        }
+        ok = audio_flac_subframe(b, dec->samples[ch], fh.block_size, bps);
+    }
+    if (ok) {
+        audio_flac_decorrelate(dec, fh.assignment, fh.block_size);
+        audio_flac_align(b);
+        audio_flac_bits(b, 16); // CRC-16; the header CRC already vouched for sync
+    } else {
+        if (b->eof && b->bits == 0) {
+            return false;
+        }
+        ESP_LOGW(TAG, "Bad frame at sample %llu", (unsigned long long)fh.first_sample);
+        for (uint8_t ch = 0; ch < dec->channels; ++ch) {
+            memset(dec->samples[ch], 0, fh.block_size * sizeof(int32_t));
+        }
+        b->error = false;
+    }
+    dec->frame_first = fh.first_sample;
+    dec->frame_samples = fh.block_size;
+    dec->frame_pos = 0;
+
+    const uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start) - (b->read_us - read_before);
+    dec->base.frame_us = elapsed;
+    if (elapsed > dec->base.max_frame_us) {
+        dec->base.max_frame_us = elapsed;
+    }
+    return true;
+}
+
+static bool audio_flac_next_frame(audio_flac_t *dec) {
+    do {
+        if (!audio_flac_decode_frame(dec)) {
+            return false;
+        }
+    } while (dec->frame_first + dec->frame_samples <= dec->skip_to);
+    if (dec->skip_to > dec->frame_first) {
+        dec->frame_pos = (uint32_t)(dec->skip_to - dec->frame_first);
+    }
+    dec->skip_to = 0;
+    return true;
+}
+
+static size_t audio_flac_read(audio_decoder_t *decoder, uint8_t *dst, size_t bytes) {
+    audio_flac_t *dec = (audio_flac_t *)decoder;
+    int16_t *out = (int16_t *)dst;
+    const size_t want = bytes / (2 * sizeof(int16_t));
+    size_t done = 0;
+    while (done < want) {
+        if (dec->frame_pos == dec->frame_samples && !audio_flac_next_frame(dec)) {
+            break;
+        }
+        size_t n = dec->frame_samples - dec->frame_pos;
+        if (n > want - done) {
+            n = want - done;
+        }
+        const int32_t *left = dec->samples[0] + dec->frame_pos;
+        const int32_t *right = dec->samples[dec->channels - 1] + dec->frame_pos;
+        audio_convert_planar(out + done * 2, left, right, n, dec->bps, &dec->dither);
+        dec->frame_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+// Starts from the last seek point at or before frame, or without a
+// SEEKTABLE from a guess based on the file size, and decodes forward to it.
+static esp_err_t audio_flac_seek(audio_decoder_t *decoder, uint64_t frame) {
+    audio_flac_t *dec = (audio_flac_t *)decoder;
+    if (decoder->total_frames && frame >= decoder->total_frames) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t offset = 0;
+    for (uint16_t i = 0; i < dec->seekpoint_count && dec->seekpoints[i].sample <= frame; ++i) {
+        offset = dec->seekpoints[i].offset;
+    }
+    if (dec->seekpoint_count == 0 && frame > dec->max_block * 4u) {
+        // The guess needs the stream length; without it only decoding from
+        // the start would find the frame.
+        ESP_RETURN_ON_FALSE(decoder->total_frames, ESP_ERR_NOT_SUPPORTED, TAG, "Unknown length and no SEEKTABLE");
+        // Back off a block at a time until the first header after the guess
+        // is at or before frame.
+        const uint32_t back = dec->max_block * dec->channels * dec->bps / 8;
+        offset = (uint32_t)((uint64_t)(dec->stream_end - dec->first_frame) * frame / decoder->total_frames);
+        for (;;) {
+            audio_flac_frame_t fh;
+            ESP_RETURN_ON_FALSE(audio_flac_reposition(&dec->bits, dec->first_frame + offset), ESP_FAIL, TAG, "Seek failed");
+            if ((audio_flac_sync(dec, &fh) && fh.first_sample <= frame) || offset == 0) {
+                break;
+            }
+            offset = offset > back ? offset - back : 0;
+        }
+    }
+    ESP_RETURN_ON_FALSE(audio_flac_reposition(&dec->bits, dec->first_frame + offset), ESP_FAIL, TAG, "Seek failed");
+    dec->frame_samples = 0;
+    dec->frame_pos = 0;
+    dec->skip_to = frame;
+    return ESP_OK;
+}
+
+static void audio_flac_close(audio_decoder_t *decoder) {
+    heap_caps_free(decoder);
+}
+
+static esp_err_t audio_flac_streaminfo(audio_flac_t *dec, const uint8_t *p) {
+    dec->min_block = audio_flac_be(p, 2);
+    dec->max_block = audio_flac_be(p + 2, 2);
+    dec->base.sample_rate = audio_flac_be(p + 10, 3) >> 4;
+    dec->channels = (uint8_t)(((p[12] >> 1) & 0x07) + 1);
+    dec->bps = (uint8_t)((((p[12] & 1) << 4) | (p[13] >> 4)) + 1);
+    dec->base.total_frames = ((uint64_t)(p[13] & 0x0F) << 32) | audio_flac_be(p + 14, 4);
+    memcpy(dec->md5, p + 18, sizeof(dec->md5));
+    if (dec->channels > 2 || dec->bps < 8 || dec->bps > 24 || dec->max_block > AUDIO_FLAC_MAX_BLOCK ||
+        dec->min_block < 16 || dec->min_block > dec->max_block || dec->base.sample_rate == 0) {
+        ESP_LOGE(TAG, "Unsupported stream: %u ch, %u bits, %u max block", dec->channels, dec->bps, (unsigned)dec->max_block);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+static void audio_flac_seektable(audio_flac_t *dec, FILE *f, uint32_t size) {
+    const uint32_t total = size / AUDIO_FLAC_SEEKPOINT_BYTES;
+    const long start = ftell(f);
+    uint16_t kept = 0;
+    for (uint32_t i = 0; i < total && kept < AUDIO_FLAC_MAX_SEEKPOINTS; ++i) {
+        // Take every point, or an even spread when there are too many.
+        uint32_t index = total <= AUDIO_FLAC_MAX_SEEKPOINTS ? i : (uint32_t)((uint64_t)i * total / AUDIO_FLAC_MAX_SEEKPOINTS);
+        if (index >= total) {
+            break;
+        }
+        uint8_t point[AUDIO_FLAC_SEEKPOINT_BYTES];
+        if (fseek(f, start + (long)index * AUDIO_FLAC_SEEKPOINT_BYTES, SEEK_SET) != 0 ||
+            audio_source_read(f, point, sizeof(point)) != sizeof(point)) {
+            break;
+        }
+        uint64_t sample = ((uint64_t)audio_flac_be(point, 4) << 32) | audio_flac_be(point + 4, 4);
+        if (sample == AUDIO_FLAC_PLACEHOLDER || audio_flac_be(point + 8, 4) != 0) {
+            continue;
+        }
+        dec->seekpoints[kept].sample = sample;
+        dec->seekpoints[kept].offset = audio_flac_be(point + 12, 4);
+        kept++;
+    }
+    dec->seekpoint_count = kept;
+}
+
+// Skips an ID3v2 tag, which some taggers put in front of "fLaC".
+static esp_err_t audio_flac_skip_id3(FILE *f) {
+    uint8_t head[10];
+    if (audio_source_read(f, head, 4) != 4) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (memcmp(head, "ID3", 3) == 0) {
+        if (audio_source_read(f, head + 4, 6) != 6) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        uint32_t size = ((uint32_t)(head[6] & 0x7F) << 21) | ((head[7] & 0x7F) << 14) | ((head[8] & 0x7F) << 7) | (head[9] & 0x7F);
+        size += (head[5] & 0x10) ? 10 : 0; // footer
+        if (fseek(f, size, SEEK_CUR) != 0 || audio_source_read(f, head, 4) != 4) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return memcmp(head, "fLaC", 4) == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t audio_flac_open(FILE *f, audio_decoder_t **decoder) {
+    ESP_RETURN_ON_FALSE(f && decoder, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    ESP_RETURN_ON_ERROR(audio_flac_skip_id3(f), TAG, "Not a FLAC stream");
+
+    // STREAMINFO always comes first and sizes everything else.
+    uint8_t head[4];
+    uint8_t p[34];
+    ESP_RETURN_ON_FALSE(audio_source_read(f, head, sizeof(head)) == sizeof(head) && (head[0] & 0x7F) == AUDIO_FLAC_STREAMINFO &&
+                            audio_flac_be(head + 1, 3) == sizeof(p) && audio_source_read(f, p, sizeof(p)) == sizeof(p),
+                        ESP_ERR_INVALID_ARG, TAG, "No STREAMINFO");
+    const size_t channels = ((p[12] >> 1) & 0x07) + 1;
+    const size_t max_block = audio_flac_be(p + 2, 2);
+    ESP_RETURN_ON_FALSE(channels <= 2 && max_block <= AUDIO_FLAC_MAX_BLOCK, ESP_ERR_NOT_SUPPORTED, TAG, "Unsupported stream: %u ch, %u max block",
+                        (unsigned)channels, (unsigned)max_block);
+
+    // Everything playback needs, in one allocation for the whole track.
+    const size_t plane = max_block * sizeof(int32_t);
+    audio_flac_t *dec = heap_caps_calloc(1, sizeof(*dec) + plane * channels, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ESP_RETURN_ON_FALSE(dec, ESP_ERR_NO_MEM, TAG, "No memory for decoder");
+    esp_err_t ret = audio_flac_streaminfo(dec, p);
+    bool last = head[0] & 0x80;
+    while (ret == ESP_OK && !last) {
+        if (audio_source_read(f, head, sizeof(head)) != sizeof(head)) {
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        last = head[0] & 0x80;
+        const uint32_t size = audio_flac_be(head + 1, 3);
+        const long next = ftell(f) + (long)size;
+        if ((head[0] & 0x7F) == AUDIO_FLAC_SEEKTABLE) {
+            audio_flac_seektable(dec, f, size);
+        }
+        if (fseek(f, next, SEEK_SET) != 0) {
+            ret = ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Bad metadata");
+        heap_caps_free(dec);
+        return ret;
+    }
+    dec->first_frame = (uint32_t)ftell(f);
+    if (fseek(f, 0, SEEK_END) == 0) {
+        dec->stream_end = (uint32_t)ftell(f);
+    }
+    dec->samples[0] = (int32_t *)(dec + 1);
+    dec->samples[1] = (int32_t *)((uint8_t *)dec->samples[0] + plane * (channels - 1));
+    dec->bits.file = f;
+    audio_flac_reposition(&dec->bits, dec->first_frame);
+    dec->dither.state = 0x9E3779B9;
+    dec->base.read = audio_flac_read;
+    // Neither a SEEKTABLE nor a length to interpolate over: not seekable.
+    dec->base.seek = dec->seekpoint_count || dec->base.total_frames ? audio_flac_seek : NULL;
+    dec->base.close = audio_flac_close;
+    ESP_LOGI(TAG, "%u Hz, %u ch, %u bits, blocks %u..%u, %u seek points", (unsigned)dec->base.sample_rate, dec->channels, dec->bps,
+             (unsigned)dec->min_block, (unsigned)dec->max_block, dec->seekpoint_count);
+    *decoder = &dec->base;
+    return ESP_OK;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "audio_decoder.h"
+#include "esp_err.h"
+
+// Largest block size accepted; the streamable subset never exceeds it at
+// 48 kHz and below. Decoded samples for one block are the decoder's biggest
+// buffer, allocated once when the track is opened.
+#define AUDIO_FLAC_MAX_BLOCK 4608
+// Further SEEKTABLE points are thinned out evenly.
+#define AUDIO_FLAC_MAX_SEEKPOINTS 128
+
+// Reads the metadata at the start of f (after an ID3v2 tag, if any) and
+// leaves the file at the first frame. Mono or stereo, 8 to 24 bits.
+esp_err_t audio_flac_open(FILE *f, audio_decoder_t **decoder);
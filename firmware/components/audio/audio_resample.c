@@ -0,0 +1,143 @@
+#include "audio_resample.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+
+#define TAG "AUDIO_RS"
+#define AUDIO_RESAMPLE_CENTER (AUDIO_RESAMPLE_TAPS / 2 - 1)
+#define AUDIO_RESAMPLE_CUTOFF 0.92f
+#define AUDIO_RESAMPLE_KAISER_BETA 8.0f
+#define AUDIO_RESAMPLE_ONE 16384 // Q14
+
+static float audio_bessel_i0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; ++k) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void audio_resampler_build(int16_t *coeffs, float cutoff) {
+    const float norm = audio_bessel_i0(AUDIO_RESAMPLE_KAISER_BETA);
+    float row[AUDIO_RESAMPLE_TAPS];
+    for (int p = 0; p <= AUDIO_RESAMPLE_PHASES; ++p) {
+        const float phase = (float)p / AUDIO_RESAMPLE_PHASES;
+        float sum = 0.0f;
+        for (int k = 0; k < AUDIO_RESAMPLE_TAPS; ++k) {
+            float t = (float)(k - AUDIO_RESAMPLE_CENTER) - phase;
+            float x = cutoff * t * (float)M_PI;
+            float sinc = fabsf(x) < 1e-6f ? 1.0f : sinf(x) / x;
+            float r = t / (AUDIO_RESAMPLE_TAPS / 2);
+            float window = r * r < 1.0f ? audio_bessel_i0(AUDIO_RESAMPLE_KAISER_BETA * sqrtf(1.0f - r * r)) / norm : 0.0f;
+            row[k] = sinc * window;
+            sum += row[k];
+        }
+        // Each row sums to exactly one so DC passes unchanged at every phase.
+        int16_t *dst = coeffs + p * AUDIO_RESAMPLE_TAPS;
+        int32_t total = 0;
+        int peak = 0;
+        for (int k = 0; k < AUDIO_RESAMPLE_TAPS; ++k) {
+            dst[k] = (int16_t)lrintf(row[k] / sum * AUDIO_RESAMPLE_ONE);
+            total += dst[k];
+            if (abs(dst[k]) > abs(dst[peak])) {
+                peak = k;
+            }
+        }
+        dst[peak] += AUDIO_RESAMPLE_ONE - total;
+    }
+}
+
+esp_err_t audio_resampler_init(audio_resampler_t *rs, uint32_t in_rate_hz, uint32_t out_rate_hz) {
+    ESP_RETURN_ON_FALSE(rs && in_rate_hz && out_rate_hz, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    ESP_RETURN_ON_FALSE(in_rate_hz <= out_rate_hz * AUDIO_RESAMPLE_MAX_DOWN, ESP_ERR_NOT_SUPPORTED, TAG, "%lu Hz is too far above %lu Hz",
+                        (unsigned long)in_rate_hz, (unsigned long)out_rate_hz);
+    memset(rs, 0, sizeof(*rs));
+    rs->coeffs = heap_caps_malloc((AUDIO_RESAMPLE_PHASES + 1) * AUDIO_RESAMPLE_TAPS * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    rs->frames = heap_caps_malloc((AUDIO_RESAMPLE_TAPS + AUDIO_RESAMPLE_CHUNK_FRAMES) * 2 * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!rs->coeffs || !rs->frames) {
+        audio_resampler_deinit(rs);
+        return ESP_ERR_NO_MEM;
+    }
+    // Cut below whichever Nyquist is lower; downsampling must not alias.
+    float cutoff = AUDIO_RESAMPLE_CUTOFF;
+    if (out_rate_hz < in_rate_hz) {
+        cutoff *= (float)out_rate_hz / (float)in_rate_hz;
+    }
+    audio_resampler_build(rs->coeffs, cutoff);
+    rs->step = ((uint64_t)in_rate_hz << 32) / out_rate_hz;
+    audio_resampler_reset(rs);
+    return ESP_OK;
+}
+
+void audio_resampler_reset(audio_resampler_t *rs) {
+    // Leading silence puts the filter centre on the first input frame.
+    rs->pos = 0;
+    rs->fill = AUDIO_RESAMPLE_CENTER;
+    memset(rs->frames, 0, rs->fill * 2 * sizeof(int16_t));
+}
+
+void audio_resampler_deinit(audio_resampler_t *rs) {
+    if (!rs) {
+        return;
+    }
+    heap_caps_free(rs->coeffs);
+    heap_caps_free(rs->frames);
+    rs->coeffs = NULL;
+    rs->frames = NULL;
+}
+
+static inline int16_t audio_resample_sat(int32_t acc) {
+    acc = (acc + AUDIO_RESAMPLE_ONE / 2) >> 14;
+    return acc > INT16_MAX ? INT16_MAX : (acc < INT16_MIN ? INT16_MIN : (int16_t)acc);
+}
+
+size_t audio_resampler_process(audio_resampler_t *rs, const int16_t *in, size_t *in_frames, int16_t *out, size_t out_frames) {
+    const size_t capacity = AUDIO_RESAMPLE_TAPS + AUDIO_RESAMPLE_CHUNK_FRAMES;
+    size_t take = *in_frames < capacity - rs->fill ? *in_frames : capacity - rs->fill;
+    memcpy(rs->frames + rs->fill * 2, in, take * 2 * sizeof(int16_t));
+    rs->fill += take;
+    *in_frames = take;
+
+    size_t produced = 0;
+    while (produced < out_frames) {
+        size_t i = (size_t)(rs->pos >> 32);
+        if (i + AUDIO_RESAMPLE_TAPS > rs->fill) {
+            break;
+        }
+        uint32_t frac = (uint32_t)rs->pos;
+        const int16_t *h0 = rs->coeffs + (frac >> (32 - AUDIO_RESAMPLE_PHASE_BITS)) * AUDIO_RESAMPLE_TAPS;
+        const int16_t *h1 = h0 + AUDIO_RESAMPLE_TAPS;
+        const int32_t t = (frac >> (32 - AUDIO_RESAMPLE_PHASE_BITS - 15)) & 0x7FFF;
+        const int16_t *x = rs->frames + i * 2;
+        // Q14 taps keep the 24-term sums of full-scale input inside int32.
+        int32_t left = 0;
+        int32_t right = 0;
+        for (int k = 0; k < AUDIO_RESAMPLE_TAPS; ++k) {
+            int32_t h = h0[k] + (((h1[k] - h0[k]) * t) >> 15);
+            left += x[k * 2] * h;
+            right += x[k * 2 + 1] * h;
+        }
+        out[produced * 2] = audio_resample_sat(left);
+        out[produced * 2 + 1] = audio_resample_sat(right);
+        rs->pos += rs->step;
+        produced++;
+    }
+
+    // Drop the frames no later output can reach.
+    size_t drop = (size_t)(rs->pos >> 32);
+    if (drop > rs->fill) {
+        drop = rs->fill;
+    }
+    if (drop > 0) {
+        memmove(rs->frames, rs->frames + drop * 2, (rs->fill - drop) * 2 * sizeof(int16_t));
+        rs->fill -= drop;
+        rs->pos -= (uint64_t)drop << 32;
+    }
+    return produced;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Windowed-sinc polyphase filter over interleaved stereo int16. Coefficients
+// for AUDIO_RESAMPLE_PHASES fractional positions are interpolated linearly,
+// so any ratio works from one table.
+#define AUDIO_RESAMPLE_TAPS 24
+#define AUDIO_RESAMPLE_PHASE_BITS 7
+#define AUDIO_RESAMPLE_PHASES (1 << AUDIO_RESAMPLE_PHASE_BITS)
+// Input frames buffered per call; bounds the work done by one call.
+#define AUDIO_RESAMPLE_CHUNK_FRAMES 512
+// Downsampling further than this would need a longer filter.
+#define AUDIO_RESAMPLE_MAX_DOWN 4
+
+typedef struct {
+    uint64_t step;    // input frames per output frame, 32.32
+    uint64_t pos;     // position of the next output in frames, 32.32
+    size_t fill;      // frames in frames[]
+    int16_t *coeffs;  // (PHASES + 1) rows of TAPS, Q14
+    int16_t *frames;  // (TAPS + CHUNK_FRAMES) stereo frames of input
+} audio_resampler_t;
+
+esp_err_t audio_resampler_init(audio_resampler_t *rs, uint32_t in_rate_hz, uint32_t out_rate_hz);
+void audio_resampler_deinit(audio_resampler_t *rs);
+// Drops buffered input, as after a seek; the next output starts afresh.
+void audio_resampler_reset(audio_resampler_t *rs);
+// Takes up to *in_frames input frames (updated to the number consumed) and
+// writes at most out_frames output frames, returning how many it wrote.
+// Call again with the rest of the input until it is all consumed.
+size_t audio_resampler_process(audio_resampler_t *rs, const int16_t *in, size_t *in_frames, int16_t *out, size_t out_frames);
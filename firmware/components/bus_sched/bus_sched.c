@@ -0,0 +1,173 @@
+#include "bus_sched.h"
+
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#define TAG "BUS_SCHED"
+#define BUS_SCHED_MIN_SLICE_BYTES 64
+
+esp_err_t bus_sched_init(bus_sched_t *sched, const bus_sched_config_t *config) {
+    ESP_RETURN_ON_FALSE(sched && config && config->clock_hz, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    memset(sched, 0, sizeof(*sched));
+    sched->latency_us = config->latency_us ? config->latency_us : BUS_SCHED_DEFAULT_LATENCY_US;
+    // Three quarters of the bound is data on the wire; the rest covers
+    // per-transaction setup and the ISR handing the bus over. Two slices fit,
+    // so one can be queued while the other is clocked out.
+    sched->budget_bytes = (size_t)((uint64_t)sched->latency_us * config->clock_hz / 8 / 1000000 * 3 / 4);
+    sched->slice_bytes = (sched->budget_bytes / 2) & ~(size_t)3;
+    ESP_RETURN_ON_FALSE(sched->slice_bytes >= BUS_SCHED_MIN_SLICE_BYTES, ESP_ERR_INVALID_ARG, TAG, "Latency bound of %lu us is too tight",
+                        (unsigned long)sched->latency_us);
+    portMUX_INITIALIZE(&sched->lock);
+    sched->lcd_wake = xSemaphoreCreateBinary();
+    sched->sd_wake = xSemaphoreCreateBinary();
+    if (!sched->lcd_wake || !sched->sd_wake) {
+        if (sched->lcd_wake) {
+            vSemaphoreDelete(sched->lcd_wake);
+        }
+        if (sched->sd_wake) {
+            vSemaphoreDelete(sched->sd_wake);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    sched->init_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+size_t bus_sched_slice_bytes(const bus_sched_t *sched) {
+    return sched ? sched->slice_bytes : 0;
+}
+
+void bus_sched_get_stats(bus_sched_t *sched, bus_sched_client_t client, bus_sched_stats_t *stats) {
+    if (!sched || !stats || client >= BUS_SCHED_CLIENT_COUNT) {
+        return;
+    }
+    portENTER_CRITICAL(&sched->lock);
+    *stats = sched->stats[client];
+    portEXIT_CRITICAL(&sched->lock);
+    int64_t elapsed = esp_timer_get_time() - sched->init_us;
+    stats->occupancy_pct = elapsed > 0 ? (uint8_t)(stats->busy_us * 100 / (uint64_t)elapsed) : 0;
+}
+
+void bus_sched_lcd_queue(size_t bytes, void *user_data) {
+    bus_sched_t *sched = user_data;
+    int64_t start = esp_timer_get_time();
+    for (;;) {
+        portENTER_CRITICAL(&sched->lock);
+        // A slice longer than the budget still goes out on an idle bus, or
+        // the display could never make progress.
+        bool go = !sched->sd_claimed && (sched->lcd_queued == 0 || sched->lcd_queued + bytes <= sched->budget_bytes);
+        if (go) {
+            sched->lcd_queued += bytes;
+        } else {
+            sched->lcd_blocked = true;
+        }
+        portEXIT_CRITICAL(&sched->lock);
+        if (go) {
+            break;
+        }
+        xSemaphoreTake(sched->lcd_wake, portMAX_DELAY);
+    }
+    uint32_t waited = (uint32_t)(esp_timer_get_time() - start);
+    portENTER_CRITICAL(&sched->lock);
+    if (waited > sched->stats[BUS_SCHED_CLIENT_LCD].max_wait_us) {
+        sched->stats[BUS_SCHED_CLIENT_LCD].max_wait_us = waited;
+    }
+    portEXIT_CRITICAL(&sched->lock);
+}
+
+// Takes back bytes from bus_sched_lcd_queue that never went on the wire, so
+// an SD claim does not wait for a done that will not come.
+void bus_sched_lcd_cancel(size_t bytes, void *user_data) {
+    bus_sched_t *sched = user_data;
+    portENTER_CRITICAL(&sched->lock);
+    sched->lcd_queued -= bytes;
+    bool wake_sd = sched->sd_blocked && sched->lcd_queued == 0;
+    if (wake_sd) {
+        sched->sd_blocked = false;
+    }
+    bool wake_lcd = sched->lcd_blocked && !sched->sd_claimed;
+    if (wake_lcd) {
+        sched->lcd_blocked = false;
+    }
+    portEXIT_CRITICAL(&sched->lock);
+    if (wake_sd) {
+        xSemaphoreGive(sched->sd_wake);
+    }
+    if (wake_lcd) {
+        xSemaphoreGive(sched->lcd_wake);
+    }
+}
+
+void IRAM_ATTR bus_sched_lcd_start(void *user_data) {
+    bus_sched_t *sched = user_data;
+    sched->lcd_started = esp_timer_get_time();
+}
+
+void IRAM_ATTR bus_sched_lcd_done(size_t bytes, void *user_data) {
+    bus_sched_t *sched = user_data;
+    int64_t now = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    portENTER_CRITICAL_ISR(&sched->lock);
+    sched->lcd_queued -= bytes;
+    sched->stats[BUS_SCHED_CLIENT_LCD].busy_us += now - sched->lcd_started;
+    sched->stats[BUS_SCHED_CLIENT_LCD].transfers++;
+    bool wake_sd = sched->sd_blocked && sched->lcd_queued == 0;
+    if (wake_sd) {
+        sched->sd_blocked = false;
+    }
+    bool wake_lcd = sched->lcd_blocked && !sched->sd_claimed;
+    if (wake_lcd) {
+        sched->lcd_blocked = false;
+    }
+    portEXIT_CRITICAL_ISR(&sched->lock);
+    if (wake_sd) {
+        xSemaphoreGiveFromISR(sched->sd_wake, &woken);
+    }
+    if (wake_lcd) {
+        xSemaphoreGiveFromISR(sched->lcd_wake, &woken);
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void bus_sched_sd_begin(bus_sched_t *sched) {
+    int64_t start = esp_timer_get_time();
+    portENTER_CRITICAL(&sched->lock);
+    sched->sd_claimed = true;
+    bool wait = sched->lcd_queued > 0;
+    sched->sd_blocked = wait;
+    portEXIT_CRITICAL(&sched->lock);
+    if (wait) {
+        xSemaphoreTake(sched->sd_wake, portMAX_DELAY);
+    }
+    int64_t granted = esp_timer_get_time();
+    uint32_t waited = (uint32_t)(granted - start);
+    bus_sched_stats_t *stats = &sched->stats[BUS_SCHED_CLIENT_SD];
+    portENTER_CRITICAL(&sched->lock);
+    if (waited > stats->max_wait_us) {
+        stats->max_wait_us = waited;
+    }
+    if (waited > sched->latency_us) {
+        stats->over_bound++;
+    }
+    sched->sd_started = granted;
+    portEXIT_CRITICAL(&sched->lock);
+}
+
+void bus_sched_sd_end(bus_sched_t *sched) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&sched->lock);
+    sched->stats[BUS_SCHED_CLIENT_SD].busy_us += now - sched->sd_started;
+    sched->stats[BUS_SCHED_CLIENT_SD].transfers++;
+    sched->sd_claimed = false;
+    bool wake_lcd = sched->lcd_blocked;
+    sched->lcd_blocked = false;
+    portEXIT_CRITICAL(&sched->lock);
+    if (wake_lcd) {
+        xSemaphoreGive(sched->lcd_wake);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define BUS_SCHED_DEFAULT_LATENCY_US 2000
+
+// Arbitrates SPI2 between the display's queued DMA transfers and SD reads
+// for audio. The display is held to slices short enough that the bytes it
+// may have queued always clear the wire within the latency bound; an SD
+// claim stops it queueing more and waits only for what is already queued.
+typedef enum {
+    BUS_SCHED_CLIENT_LCD = 0,
+    BUS_SCHED_CLIENT_SD,
+    BUS_SCHED_CLIENT_COUNT,
+} bus_sched_client_t;
+
+typedef struct {
+    uint32_t clock_hz;   // display SPI clock
+    uint32_t latency_us; // longest an SD claim may wait, 0 = BUS_SCHED_DEFAULT_LATENCY_US
+} bus_sched_config_t;
+
+typedef struct {
+    uint64_t busy_us;      // time on the bus
+    uint32_t transfers;
+    uint32_t max_wait_us;  // longest wait for the bus
+    uint32_t over_bound;   // SD claims that waited longer than latency_us
+    uint8_t occupancy_pct; // busy_us over the time since init
+} bus_sched_stats_t;
+
+typedef struct {
+    uint32_t latency_us;
+    size_t budget_bytes; // display bytes that may be queued at once
+    size_t slice_bytes;
+    portMUX_TYPE lock;
+    size_t lcd_queued;
+    bool lcd_blocked;
+    bool sd_claimed;
+    bool sd_blocked;
+    int64_t lcd_started;
+    int64_t sd_started;
+    int64_t init_us;
+    SemaphoreHandle_t lcd_wake;
+    SemaphoreHandle_t sd_wake;
+    bus_sched_stats_t stats[BUS_SCHED_CLIENT_COUNT];
+} bus_sched_t;
+
+esp_err_t bus_sched_init(bus_sched_t *sched, const bus_sched_config_t *config);
+// Longest display transaction; use it as the panel's max_transfer_bytes.
+size_t bus_sched_slice_bytes(const bus_sched_t *sched);
+void bus_sched_get_stats(bus_sched_t *sched, bus_sched_client_t client, bus_sched_stats_t *stats);
+
+// ili9488_bus_hooks_t callbacks; user_data is the scheduler. start and done
+// run from the SPI ISR.
+void bus_sched_lcd_queue(size_t bytes, void *user_data);
+void bus_sched_lcd_cancel(size_t bytes, void *user_data);
+void bus_sched_lcd_start(void *user_data);
+void bus_sched_lcd_done(size_t bytes, void *user_data);
+
+// Bracket SD access from one task at a time. begin returns once the display
+// has nothing left on the wire; the display waits until end.
+void bus_sched_sd_begin(bus_sched_t *sched);
+void bus_sched_sd_end(bus_sched_t *sched);
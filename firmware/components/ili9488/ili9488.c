@@ -16,8 +16,8 @@
 #define ILI9488_CMD_PIXFMT 0x3A
 #define ILI9488_CMD_SLPOUT 0x11
 #define ILI9488_CMD_DISPON 0x29
-
-#define ILI9488_CHUNK_PIXELS 1024
+#define ILI9488_CMD_VSCRDEF 0x33
+#define ILI9488_CMD_VSCRSADD 0x37
 
 typedef struct {
     uint8_t cmd;
@@ -45,7 +45,52 @@ static const ili9488_init_cmd_t init_cmds[] = {
     {ILI9488_CMD_DISPON, {0}, 0, 20},
 };
 
+static uint8_t ili9488_bytes_per_pixel(ili9488_pixel_format_t format) {
+    return format == ILI9488_PIXEL_FORMAT_RGB666 ? 3 : 2;
+}
+
+static uint8_t ili9488_pixfmt_value(ili9488_pixel_format_t format) {
+    return format == ILI9488_PIXEL_FORMAT_RGB666 ? 0x66 : 0x55;
+}
+
+static inline void ili9488_rgb666_pixel(uint8_t *dst, uint8_t hi, uint8_t lo) {
+    // Each channel's MSB is repeated into the spare sixth bit so full-scale
+    // red and blue stay full-scale.
+    dst[0] = (hi & 0xF8) | ((hi >> 5) & 0x04);
+    dst[1] = (uint8_t)(hi << 5) | ((lo >> 3) & 0x1C);
+    dst[2] = (uint8_t)(lo << 3) | ((lo >> 2) & 0x04);
+}
+
+void ili9488_rgb565_to_rgb666(uint8_t *dst, const uint16_t *src, size_t pixels) {
+    size_t i = 0;
+    if ((((uintptr_t)dst | (uintptr_t)src) & 3) == 0) {
+        // Four pixels per step: two word loads, three word stores. Each
+        // channel is computed for a pixel pair at once, one pixel per
+        // half-word (hi byte in bits 0-7, lo byte in bits 8-15).
+        const uint32_t *in = (const uint32_t *)src;
+        uint32_t *out = (uint32_t *)dst;
+        for (; i + 4 <= pixels; i += 4) {
+            uint32_t a = *in++;
+            uint32_t b = *in++;
+            uint32_t ra = (a & 0x00F800F8) | ((a >> 5) & 0x00040004);
+            uint32_t ga = ((a << 5) & 0x00E000E0) | ((a >> 11) & 0x001C001C);
+            uint32_t ba = ((a >> 5) & 0x00F800F8) | ((a >> 10) & 0x00040004);
+            uint32_t rb = (b & 0x00F800F8) | ((b >> 5) & 0x00040004);
+            uint32_t gb = ((b << 5) & 0x00E000E0) | ((b >> 11) & 0x001C001C);
+            uint32_t bb = ((b >> 5) & 0x00F800F8) | ((b >> 10) & 0x00040004);
+            *out++ = (ra & 0xFF) | ((ga & 0xFF) << 8) | ((ba & 0xFF) << 16) | ((ra & 0xFF0000) << 8);
+            *out++ = (ga >> 16) | ((ba >> 16) << 8) | ((rb & 0xFF) << 16) | ((gb & 0xFF) << 24);
+            *out++ = (bb & 0xFF) | ((rb >> 16) << 8) | (gb & 0xFF0000) | ((bb >> 16) << 24);
+        }
+    }
+    const uint8_t *bytes = (const uint8_t *)src;
+    for (; i < pixels; ++i) {
+        ili9488_rgb666_pixel(dst + i * 3, bytes[i * 2], bytes[i * 2 + 1]);
+    }
+}
+
 static esp_err_t ili9488_send_cmd(ili9488_t *lcd, uint8_t cmd, const uint8_t *data, size_t len) {
+    ESP_RETURN_ON_ERROR(ili9488_wait_idle(lcd), TAG, "Queue drain failed");
     spi_transaction_t t = {
         .flags = SPI_TRANS_USE_TXDATA,
         .length = 8,
@@ -67,16 +112,6 @@ static esp_err_t ili9488_send_cmd(ili9488_t *lcd, uint8_t cmd, const uint8_t *da
     return ret;
 }
 
-static esp_err_t ili9488_write_reg16(ili9488_t *lcd, uint8_t cmd, uint16_t start, uint16_t end) {
-    uint8_t data[4] = {
-        (uint8_t)(start >> 8),
-        (uint8_t)(start & 0xFF),
-        (uint8_t)(end >> 8),
-        (uint8_t)(end & 0xFF),
-    };
-    return ili9488_send_cmd(lcd, cmd, data, sizeof(data));
-}
-
 void ili9488_delay_ms(uint32_t ms) {
     vTaskDelay(pdMS_TO_TICKS(ms));
 }
@@ -112,10 +147,43 @@ static void ili9488_config_pins(ili9488_t *lcd) {
     }
 }
 
+static void ili9488_pool_free(ili9488_t *lcd) {
+    for (size_t i = 0; i < ILI9488_DMA_POOL_MAX; ++i) {
+        if (lcd->tx_slots[i].buffer) {
+            heap_caps_free(lcd->tx_slots[i].buffer);
+            lcd->tx_slots[i].buffer = NULL;
+        }
+    }
+    lcd->tx_count = 0;
+}
+
+static esp_err_t ili9488_pool_alloc(ili9488_t *lcd, uint8_t count, size_t chunk_pixels) {
+    size_t chunk_bytes = chunk_pixels * ili9488_bytes_per_pixel(lcd->pixel_format);
+    for (uint8_t i = 0; i < count; ++i) {
+        ili9488_tx_slot_t *slot = &lcd->tx_slots[i];
+        slot->buffer = heap_caps_malloc(chunk_bytes, MALLOC_CAP_DMA);
+        if (!slot->buffer) {
+            ESP_LOGE(TAG, "Failed to allocate DMA chunk %u of %u", i + 1, count);
+            ili9488_pool_free(lcd);
+            return ESP_ERR_NO_MEM;
+        }
+        slot->lcd = lcd;
+    }
+    lcd->tx_count = count;
+    lcd->chunk_bytes = chunk_bytes;
+    lcd->chunk_pixels = chunk_pixels;
+    return ESP_OK;
+}
+
 esp_err_t ili9488_init(ili9488_t *lcd, const ili9488_config_t *config) {
     if (!lcd || !config) {
         return ESP_ERR_INVALID_ARG;
     }
+    uint8_t buffer_count = config->dma_buffer_count ? config->dma_buffer_count : ILI9488_DEFAULT_DMA_BUFFERS;
+    size_t chunk_pixels = config->dma_chunk_pixels ? config->dma_chunk_pixels : ILI9488_DEFAULT_CHUNK_PIXELS;
+    if (buffer_count > ILI9488_DMA_POOL_MAX || config->pixel_format > ILI9488_PIXEL_FORMAT_RGB666) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
     *lcd = (ili9488_t) {
         .spi = config->spi,
@@ -123,14 +191,38 @@ esp_err_t ili9488_init(ili9488_t *lcd, const ili9488_config_t *config) {
         .reset_pin = config->reset_pin,
         .backlight_pin = config->backlight_pin,
         .backlight_active_high = config->backlight_active_high,
+        .done_callback = config->done_callback,
+        .done_user_data = config->done_user_data,
+        .bus_hooks = config->bus_hooks,
+        .max_transfer_bytes = config->max_transfer_bytes ? config->max_transfer_bytes : ILI9488_DEFAULT_MAX_TRANSFER_BYTES,
+        .queue_size = config->spi_queue_size ? config->spi_queue_size : ILI9488_DEFAULT_QUEUE_SIZE,
+        .pixel_format = config->pixel_format,
+        .scroll_height = ILI9488_HEIGHT,
     };
+    for (size_t i = 0; i < ILI9488_CMD_SLOTS; ++i) {
+        lcd->cmd_slots[i].lcd = lcd;
+    }
+
+    // A chunk is one transaction, so it can be no longer than the limit.
+    const size_t max_chunk_pixels = lcd->max_transfer_bytes / ili9488_bytes_per_pixel(lcd->pixel_format);
+    if (chunk_pixels > max_chunk_pixels) {
+        chunk_pixels = max_chunk_pixels;
+    }
+    ESP_RETURN_ON_ERROR(ili9488_pool_alloc(lcd, buffer_count, chunk_pixels), TAG, "DMA pool alloc failed");
 
     ili9488_config_pins(lcd);
     ili9488_hw_reset(lcd);
 
+    const uint8_t pixfmt = ili9488_pixfmt_value(lcd->pixel_format);
     for (size_t i = 0; i < sizeof(init_cmds) / sizeof(init_cmds[0]); ++i) {
         const ili9488_init_cmd_t *entry = &init_cmds[i];
-        ESP_RETURN_ON_ERROR(ili9488_send_cmd(lcd, entry->cmd, entry->data_len ? entry->data : NULL, entry->data_len), TAG, "Init cmd failed");
+        const uint8_t *data = entry->cmd == ILI9488_CMD_PIXFMT ? &pixfmt : entry->data;
+        esp_err_t ret = ili9488_send_cmd(lcd, entry->cmd, entry->data_len ? data : NULL, entry->data_len);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Init cmd 0x%02X failed", entry->cmd);
+            ili9488_pool_free(lcd);
+            return ret;
+        }
         if (entry->delay_ms) {
             ili9488_delay_ms(entry->delay_ms);
         }
@@ -143,81 +235,417 @@ esp_err_t ili9488_init(ili9488_t *lcd, const ili9488_config_t *config) {
     return ESP_OK;
 }
 
+void ili9488_deinit(ili9488_t *lcd) {
+    if (!lcd) {
+        return;
+    }
+    ili9488_wait_idle(lcd);
+    ili9488_pool_free(lcd);
+}
+
 esp_err_t ili9488_set_window(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
     uint16_t x_end = x + width - 1;
     uint16_t y_end = y + height - 1;
-    ESP_RETURN_ON_ERROR(ili9488_write_reg16(lcd, ILI9488_CMD_CASET, x, x_end), TAG, "CASET failed");
-    ESP_RETURN_ON_ERROR(ili9488_write_reg16(lcd, ILI9488_CMD_PASET, y, y_end), TAG, "PASET failed");
-    return ili9488_send_cmd(lcd, ILI9488_CMD_RAMWR, NULL, 0);
+    const ili9488_cmd_t cmds[] = {
+        {ILI9488_CMD_CASET, {x >> 8, x & 0xFF, x_end >> 8, x_end & 0xFF}, 4},
+        {ILI9488_CMD_PASET, {y >> 8, y & 0xFF, y_end >> 8, y_end & 0xFF}, 4},
+        {ILI9488_CMD_RAMWR, {0}, 0},
+    };
+    return ili9488_queue_cmds(lcd, cmds, sizeof(cmds) / sizeof(cmds[0]));
 }
 
-esp_err_t ili9488_draw_rgb565_bitmap(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap) {
-    if (!lcd || !bitmap) {
+esp_err_t ili9488_set_scroll_area(ili9488_t *lcd, uint16_t top_fixed, uint16_t bottom_fixed) {
+    if (!lcd || top_fixed + bottom_fixed >= ILI9488_HEIGHT) {
         return ESP_ERR_INVALID_ARG;
     }
+    uint16_t height = ILI9488_HEIGHT - top_fixed - bottom_fixed;
+    const ili9488_cmd_t cmd = {
+        ILI9488_CMD_VSCRDEF,
+        {top_fixed >> 8, top_fixed & 0xFF, height >> 8, height & 0xFF, bottom_fixed >> 8, bottom_fixed & 0xFF},
+        6,
+    };
+    ESP_RETURN_ON_ERROR(ili9488_queue_cmds(lcd, &cmd, 1), TAG, "Scroll area failed");
+    lcd->scroll_top = top_fixed;
+    lcd->scroll_height = height;
+    return ESP_OK;
+}
 
-    size_t total_pixels = width * height;
+esp_err_t ili9488_set_scroll_start(ili9488_t *lcd, uint16_t line) {
+    if (!lcd || line < lcd->scroll_top || line >= lcd->scroll_top + lcd->scroll_height) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const ili9488_cmd_t cmd = {ILI9488_CMD_VSCRSADD, {line >> 8, line & 0xFF}, 2};
+    return ili9488_queue_cmds(lcd, &cmd, 1);
+}
+
+void IRAM_ATTR ili9488_spi_pre_transfer_cb(spi_transaction_t *trans) {
+    ili9488_tx_slot_t *slot = (ili9488_tx_slot_t *)trans->user;
+    if (slot) {
+        gpio_set_level(slot->lcd->dc_pin, slot->dc);
+        if (slot->lcd->bus_hooks.start) {
+            slot->lcd->bus_hooks.start(slot->lcd->bus_hooks.user_data);
+        }
+    }
+}
+
+void IRAM_ATTR ili9488_spi_post_transfer_cb(spi_transaction_t *trans) {
+    ili9488_tx_slot_t *slot = (ili9488_tx_slot_t *)trans->user;
+    if (!slot) {
+        return;
+    }
+    ili9488_t *lcd = slot->lcd;
+    if (lcd->bus_hooks.done) {
+        lcd->bus_hooks.done(trans->length / 8, lcd->bus_hooks.user_data);
+    }
+    if (slot->last && lcd->done_callback) {
+        lcd->done_callback(lcd->done_user_data);
+    }
+}
+
+static esp_err_t ili9488_reap_one(ili9488_t *lcd) {
+    spi_transaction_t *done = NULL;
+    esp_err_t ret = spi_device_get_trans_result(lcd->spi, &done, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ili9488_tx_slot_t *slot = (ili9488_tx_slot_t *)done->user;
+    slot->in_flight = false;
+    lcd->tx_pending--;
+    lcd->seq_done++;
+    if (slot->buffer) {
+        lcd->pool_pending--;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ili9488_reserve_queue(ili9488_t *lcd) {
+    while (lcd->tx_pending >= lcd->queue_size) {
+        ESP_RETURN_ON_ERROR(ili9488_reap_one(lcd), TAG, "Transfer result failed");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ili9488_queue_trans(ili9488_t *lcd, ili9488_tx_slot_t *slot) {
+    ESP_RETURN_ON_ERROR(ili9488_reserve_queue(lcd), TAG, "Queue full");
+    if (lcd->bus_hooks.queue) {
+        lcd->bus_hooks.queue(slot->trans.length / 8, lcd->bus_hooks.user_data);
+    }
+    esp_err_t ret = spi_device_queue_trans(lcd->spi, &slot->trans, portMAX_DELAY);
+    if (ret != ESP_OK && lcd->bus_hooks.cancel) {
+        // Nothing will reach the wire, so nothing would ever report done.
+        lcd->bus_hooks.cancel(slot->trans.length / 8, lcd->bus_hooks.user_data);
+    }
+    return ret;
+}
+
+static esp_err_t ili9488_queue_one_cmd(ili9488_t *lcd, uint8_t dc, const uint8_t *bytes, size_t len) {
+    ili9488_tx_slot_t *slot = &lcd->cmd_slots[lcd->cmd_next];
+    while (slot->in_flight) {
+        ESP_RETURN_ON_ERROR(ili9488_reap_one(lcd), TAG, "Transfer result failed");
+    }
+    slot->trans = (spi_transaction_t) {
+        .flags = SPI_TRANS_USE_TXDATA,
+        .length = len * 8,
+        .user = slot,
+    };
+    memcpy(slot->trans.tx_data, bytes, len);
+    slot->dc = dc;
+    slot->last = false;
+    ESP_RETURN_ON_ERROR(ili9488_queue_trans(lcd, slot), TAG, "Queue cmd failed");
+    slot->in_flight = true;
+    lcd->tx_pending++;
+    lcd->seq_queued++;
+    lcd->cmd_next = (lcd->cmd_next + 1) % ILI9488_CMD_SLOTS;
+    return ESP_OK;
+}
+
+esp_err_t ili9488_queue_cmds(ili9488_t *lcd, const ili9488_cmd_t *cmds, size_t count) {
+    if (!lcd || (!cmds && count)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (cmds[i].data_len > ILI9488_CMD_MAX_DATA) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        ESP_RETURN_ON_ERROR(ili9488_queue_one_cmd(lcd, 0, &cmds[i].cmd, 1), TAG, "Cmd 0x%02X failed", cmds[i].cmd);
+        // Parameters go out in TXDATA-sized pieces; the panel keeps
+        // collecting them until the next command.
+        for (uint8_t sent = 0; sent < cmds[i].data_len; sent += 4) {
+            uint8_t len = cmds[i].data_len - sent < 4 ? cmds[i].data_len - sent : 4;
+            ESP_RETURN_ON_ERROR(ili9488_queue_one_cmd(lcd, 1, cmds[i].data + sent, len), TAG, "Cmd 0x%02X data failed", cmds[i].cmd);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ili9488_wait_idle(ili9488_t *lcd) {
+    if (!lcd) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (lcd->tx_pending > 0) {
+        ESP_RETURN_ON_ERROR(ili9488_reap_one(lcd), TAG, "Transfer result failed");
+    }
+    return ESP_OK;
+}
+
+ili9488_fence_t ili9488_fence(const ili9488_t *lcd) {
+    return lcd ? lcd->seq_queued : 0;
+}
+
+esp_err_t ili9488_wait_fence(ili9488_t *lcd, ili9488_fence_t fence) {
+    if (!lcd) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while ((int32_t)(lcd->seq_done - fence) < 0 && lcd->tx_pending > 0) {
+        ESP_RETURN_ON_ERROR(ili9488_reap_one(lcd), TAG, "Transfer result failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t ili9488_write_begin(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!lcd || width == 0 || height == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (lcd->tx_count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
     ESP_RETURN_ON_ERROR(ili9488_set_window(lcd, x, y, width, height), TAG, "Set window failed");
+    lcd->tx_acquired = false;
+    return ESP_OK;
+}
 
-    uint8_t *chunk = heap_caps_malloc(ILI9488_CHUNK_PIXELS * 2, MALLOC_CAP_DMA);
-    if (!chunk) {
-        ESP_LOGE(TAG, "Failed to allocate DMA chunk");
+static esp_err_t ili9488_next_slot(ili9488_t *lcd, ili9488_tx_slot_t **out) {
+    if (lcd->tx_count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ili9488_tx_slot_t *slot = &lcd->tx_slots[lcd->tx_next];
+    if (slot->in_flight) {
+        lcd->pool_stalls++;
+    }
+    while (slot->in_flight) {
+        ESP_RETURN_ON_ERROR(ili9488_reap_one(lcd), TAG, "Transfer result failed");
+    }
+    if (lcd->pool_pending + 1 > lcd->pool_high_water) {
+        lcd->pool_high_water = lcd->pool_pending + 1;
+    }
+    *out = slot;
+    return ESP_OK;
+}
+
+static esp_err_t ili9488_queue_slot(ili9488_t *lcd, const void *data, size_t bytes, bool last) {
+    ili9488_tx_slot_t *slot = &lcd->tx_slots[lcd->tx_next];
+    slot->trans = (spi_transaction_t) {
+        .length = bytes * 8,
+        .tx_buffer = data,
+        .user = slot,
+    };
+    slot->dc = 1;
+    slot->last = last;
+    ESP_RETURN_ON_ERROR(ili9488_queue_trans(lcd, slot), TAG, "Queue chunk failed");
+    slot->in_flight = true;
+    lcd->tx_pending++;
+    lcd->seq_queued++;
+    lcd->pool_pending++;
+    lcd->tx_next = (lcd->tx_next + 1) % lcd->tx_count;
+    return ESP_OK;
+}
+
+esp_err_t ili9488_write_acquire(ili9488_t *lcd, uint8_t **buffer, size_t *max_pixels) {
+    if (!lcd || !buffer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ili9488_tx_slot_t *slot = NULL;
+    ESP_RETURN_ON_ERROR(ili9488_next_slot(lcd, &slot), TAG, "No free chunk");
+    lcd->tx_acquired = true;
+    *buffer = slot->buffer;
+    if (max_pixels) {
+        *max_pixels = lcd->chunk_pixels;
+    }
+    return ESP_OK;
+}
+
+// Queues the acquired chunk as-is; bytes are already in the wire format.
+static esp_err_t ili9488_submit_native(ili9488_t *lcd, size_t bytes, bool last) {
+    lcd->tx_acquired = false;
+    return ili9488_queue_slot(lcd, lcd->tx_slots[lcd->tx_next].buffer, bytes, last);
+}
+
+esp_err_t ili9488_write_submit(ili9488_t *lcd, size_t pixels, bool last) {
+    if (!lcd || pixels == 0 || pixels > lcd->chunk_pixels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!lcd->tx_acquired) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t *buffer = lcd->tx_slots[lcd->tx_next].buffer;
+    if (lcd->pixel_format == ILI9488_PIXEL_FORMAT_RGB666) {
+        // Back to front: pixel i only overwrites source bytes of pixels >= i.
+        for (size_t i = pixels; i-- > 0;) {
+            ili9488_rgb666_pixel(buffer + i * 3, buffer[i * 2], buffer[i * 2 + 1]);
+        }
+    }
+    return ili9488_submit_native(lcd, pixels * ili9488_bytes_per_pixel(lcd->pixel_format), last);
+}
+
+esp_err_t ili9488_set_pixel_format(ili9488_t *lcd, ili9488_pixel_format_t format) {
+    if (!lcd || format > ILI9488_PIXEL_FORMAT_RGB666) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (lcd->tx_acquired) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const ili9488_cmd_t cmd = {ILI9488_CMD_PIXFMT, {ili9488_pixfmt_value(format)}, 1};
+    ESP_RETURN_ON_ERROR(ili9488_queue_cmds(lcd, &cmd, 1), TAG, "Pixel format failed");
+    lcd->pixel_format = format;
+    lcd->chunk_pixels = lcd->chunk_bytes / ili9488_bytes_per_pixel(format);
+    return ESP_OK;
+}
+
+esp_err_t ili9488_surface_create(ili9488_surface_t *surface, uint16_t width, uint16_t height) {
+    if (!surface || width == 0 || height == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint16_t *pixels = heap_caps_malloc((size_t)width * height * sizeof(uint16_t), MALLOC_CAP_DMA);
+    if (!pixels) {
         return ESP_ERR_NO_MEM;
     }
+    *surface = (ili9488_surface_t) {
+        .width = width,
+        .height = height,
+        .pixels = pixels,
+    };
+    return ESP_OK;
+}
+
+void ili9488_surface_destroy(ili9488_surface_t *surface) {
+    if (!surface || !surface->pixels) {
+        return;
+    }
+    heap_caps_free(surface->pixels);
+    surface->pixels = NULL;
+    surface->width = 0;
+    surface->height = 0;
+}
+
+esp_err_t ili9488_blit_panel_pixels(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels) {
+    if (!lcd || !pixels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_RETURN_ON_ERROR(ili9488_write_begin(lcd, x, y, width, height), TAG, "Write begin failed");
+
+    if (lcd->pixel_format == ILI9488_PIXEL_FORMAT_RGB666) {
+        // Each chunk is expanded while the previous one is on the wire.
+        size_t total = (size_t)width * height;
+        size_t done = 0;
+        while (done < total) {
+            uint8_t *chunk = NULL;
+            size_t max_pixels = 0;
+            ESP_RETURN_ON_ERROR(ili9488_write_acquire(lcd, &chunk, &max_pixels), TAG, "Acquire chunk failed");
+            size_t count = total - done > max_pixels ? max_pixels : total - done;
+            ili9488_rgb565_to_rgb666(chunk, pixels + done, count);
+            done += count;
+            ESP_RETURN_ON_ERROR(ili9488_submit_native(lcd, count * 3, done == total), TAG, "Blit chunk failed");
+        }
+        return ESP_OK;
+    }
+
+    const uint8_t *data = (const uint8_t *)pixels;
+    size_t remaining = (size_t)width * height * sizeof(uint16_t);
+    const size_t max_bytes = lcd->max_transfer_bytes & ~(size_t)3;
+    while (remaining > 0) {
+        size_t bytes = remaining > max_bytes ? max_bytes : remaining;
+        ili9488_tx_slot_t *slot = NULL;
+        ESP_RETURN_ON_ERROR(ili9488_next_slot(lcd, &slot), TAG, "No free slot");
+        remaining -= bytes;
+        ESP_RETURN_ON_ERROR(ili9488_queue_slot(lcd, data, bytes, remaining == 0), TAG, "Blit segment failed");
+        data += bytes;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ili9488_blit_surface(ili9488_t *lcd, uint16_t x, uint16_t y, const ili9488_surface_t *surface) {
+    if (!surface) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ili9488_blit_panel_pixels(lcd, x, y, surface->width, surface->height, surface->pixels);
+}
+
+void ili9488_get_pool_stats(const ili9488_t *lcd, ili9488_pool_stats_t *stats) {
+    if (!lcd || !stats) {
+        return;
+    }
+    *stats = (ili9488_pool_stats_t) {
+        .buffer_count = lcd->tx_count,
+        .chunk_bytes = lcd->chunk_bytes,
+        .in_use = lcd->pool_pending + (lcd->tx_acquired ? 1 : 0),
+        .high_water = lcd->pool_high_water,
+        .stalls = lcd->pool_stalls,
+    };
+}
+
+esp_err_t ili9488_draw_rgb565_bitmap(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap) {
+    if (!lcd || !bitmap) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t total_pixels = width * height;
+    ESP_RETURN_ON_ERROR(ili9488_write_begin(lcd, x, y, width, height), TAG, "Write begin failed");
 
     size_t offset = 0;
     while (offset < total_pixels) {
+        uint8_t *chunk = NULL;
+        size_t max_pixels = 0;
+        ESP_RETURN_ON_ERROR(ili9488_write_acquire(lcd, &chunk, &max_pixels), TAG, "Acquire chunk failed");
         size_t chunk_pixels = total_pixels - offset;
-        if (chunk_pixels > ILI9488_CHUNK_PIXELS) {
-            chunk_pixels = ILI9488_CHUNK_PIXELS;
+        if (chunk_pixels > max_pixels) {
+            chunk_pixels = max_pixels;
         }
+        const uint8_t bpp = ili9488_bytes_per_pixel(lcd->pixel_format);
         for (size_t i = 0; i < chunk_pixels; ++i) {
             uint16_t color = bitmap[offset + i];
-            chunk[i * 2] = color >> 8;
-            chunk[i * 2 + 1] = color & 0xFF;
+            if (bpp == 3) {
+                ili9488_rgb666_pixel(chunk + i * 3, color >> 8, color & 0xFF);
+            } else {
+                chunk[i * 2] = color >> 8;
+                chunk[i * 2 + 1] = color & 0xFF;
+            }
         }
-        spi_transaction_t trans = {
-            .length = chunk_pixels * 16,
-            .tx_buffer = chunk,
-        };
-        gpio_set_level(lcd->dc_pin, 1);
-        ESP_RETURN_ON_ERROR(spi_device_polling_transmit(lcd->spi, &trans), TAG, "RAMWR chunk failed");
         offset += chunk_pixels;
+        ESP_RETURN_ON_ERROR(ili9488_submit_native(lcd, chunk_pixels * bpp, offset == total_pixels), TAG, "RAMWR chunk failed");
     }
 
-    heap_caps_free(chunk);
     return ESP_OK;
 }
 
 esp_err_t ili9488_fill_color(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color) {
     size_t total_pixels = width * height;
-    ESP_RETURN_ON_ERROR(ili9488_set_window(lcd, x, y, width, height), TAG, "Set window failed");
+    ESP_RETURN_ON_ERROR(ili9488_write_begin(lcd, x, y, width, height), TAG, "Write begin failed");
 
-    uint8_t *chunk = heap_caps_malloc(ILI9488_CHUNK_PIXELS * 2, MALLOC_CAP_DMA);
-    if (!chunk) {
-        return ESP_ERR_NO_MEM;
+    // One pixel in wire format, repeated across each chunk.
+    uint8_t pattern[3] = {color >> 8, color & 0xFF, 0};
+    const uint8_t bpp = ili9488_bytes_per_pixel(lcd->pixel_format);
+    if (bpp == 3) {
+        ili9488_rgb666_pixel(pattern, color >> 8, color & 0xFF);
     }
-
-    const uint8_t hi = color >> 8;
-    const uint8_t lo = color & 0xFF;
-    size_t max_pixels = ILI9488_CHUNK_PIXELS;
+    size_t prepared = 0;
 
     while (total_pixels > 0) {
+        uint8_t *chunk = NULL;
+        size_t max_pixels = 0;
+        ESP_RETURN_ON_ERROR(ili9488_write_acquire(lcd, &chunk, &max_pixels), TAG, "Acquire chunk failed");
         size_t chunk_pixels = total_pixels > max_pixels ? max_pixels : total_pixels;
-        for (size_t i = 0; i < chunk_pixels; ++i) {
-            chunk[i * 2] = hi;
-            chunk[i * 2 + 1] = lo;
+        // Buffers are handed out round-robin, so once each has been painted
+        // the remaining chunks only cost a queue operation.
+        if (prepared < lcd->tx_count) {
+            for (size_t i = 0; i < max_pixels; ++i) {
+                memcpy(chunk + i * bpp, pattern, bpp);
+            }
+            prepared++;
         }
-        spi_transaction_t trans = {
-            .length = chunk_pixels * 16,
-            .tx_buffer = chunk,
-        };
-        gpio_set_level(lcd->dc_pin, 1);
-        ESP_RETURN_ON_ERROR(spi_device_polling_transmit(lcd->spi, &trans), TAG, "Fill chunk failed");
         total_pixels -= chunk_pixels;
+        ESP_RETURN_ON_ERROR(ili9488_submit_native(lcd, chunk_pixels * bpp, total_pixels == 0), TAG, "Fill chunk failed");
     }
 
-    heap_caps_free(chunk);
     return ESP_OK;
 }
 
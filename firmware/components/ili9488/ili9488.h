@@ -10,14 +10,85 @@
 
 #define ILI9488_WIDTH 320
 #define ILI9488_HEIGHT 480
+#define ILI9488_DMA_POOL_MAX 8
+#define ILI9488_DEFAULT_DMA_BUFFERS 2
+#define ILI9488_DEFAULT_CHUNK_PIXELS 1024
+#define ILI9488_DEFAULT_QUEUE_SIZE 7
+#define ILI9488_CMD_SLOTS 8
+#define ILI9488_CMD_MAX_DATA 6
+#define ILI9488_DEFAULT_MAX_TRANSFER_BYTES (ILI9488_WIDTH * 40 * 2)
+
+// Sequence number of a queued transaction; waiting on it is a per-draw fence.
+typedef uint32_t ili9488_fence_t;
+
+// Called from the SPI ISR once the last chunk of a draw has been clocked out.
+typedef void (*ili9488_done_callback_t)(void *user_data);
+
+typedef struct ili9488_s ili9488_t;
+
+// Lets a bus arbiter pace and account for the panel's queued transfers.
+// queue runs in the drawing task before each transaction is queued and may
+// block; cancel follows it if the SPI driver then refuses the transaction.
+// start and done run from the SPI ISR around it. Any may be NULL.
+typedef struct {
+    void (*queue)(size_t bytes, void *user_data);
+    void (*cancel)(size_t bytes, void *user_data);
+    void (*start)(void *user_data);
+    void (*done)(size_t bytes, void *user_data);
+    void *user_data;
+} ili9488_bus_hooks_t;
+
+// What goes over the wire. Callers always hand the driver panel-order RGB565;
+// in RGB666 mode it is expanded to three bytes per pixel on the way out.
+typedef enum {
+    ILI9488_PIXEL_FORMAT_RGB565 = 0, // not an SPI mode in the datasheet, but most panels take it
+    ILI9488_PIXEL_FORMAT_RGB666,
+} ili9488_pixel_format_t;
+
+typedef struct {
+    spi_transaction_t trans;
+    ili9488_t *lcd;
+    uint8_t *buffer;
+    uint8_t dc;
+    bool in_flight;
+    bool last;
+} ili9488_tx_slot_t;
 
 typedef struct {
+    uint8_t cmd;
+    uint8_t data[ILI9488_CMD_MAX_DATA];
+    uint8_t data_len;
+} ili9488_cmd_t;
+
+struct ili9488_s {
     spi_device_handle_t spi;
     gpio_num_t dc_pin;
     gpio_num_t reset_pin;
     gpio_num_t backlight_pin;
     bool backlight_active_high;
-} ili9488_t;
+    ili9488_done_callback_t done_callback;
+    void *done_user_data;
+    ili9488_bus_hooks_t bus_hooks;
+    ili9488_tx_slot_t tx_slots[ILI9488_DMA_POOL_MAX];
+    uint8_t tx_count;
+    uint8_t tx_next;
+    uint8_t tx_pending;
+    uint8_t pool_pending;
+    bool tx_acquired;
+    ili9488_tx_slot_t cmd_slots[ILI9488_CMD_SLOTS];
+    uint8_t cmd_next;
+    ili9488_fence_t seq_queued;
+    ili9488_fence_t seq_done;
+    ili9488_pixel_format_t pixel_format;
+    size_t chunk_bytes;
+    size_t chunk_pixels;
+    size_t max_transfer_bytes;
+    uint8_t queue_size;
+    uint8_t pool_high_water;
+    uint32_t pool_stalls;
+    uint16_t scroll_top;
+    uint16_t scroll_height;
+};
 
 typedef struct {
     spi_device_handle_t spi;
@@ -25,12 +96,86 @@ typedef struct {
     gpio_num_t reset_pin;
     gpio_num_t backlight_pin;
     bool backlight_active_high;
+    ili9488_done_callback_t done_callback;
+    void *done_user_data;
+    uint8_t dma_buffer_count;   // 0 = ILI9488_DEFAULT_DMA_BUFFERS
+    size_t dma_chunk_pixels;    // 0 = ILI9488_DEFAULT_CHUNK_PIXELS
+    size_t max_transfer_bytes;  // longest queued transaction, 0 = ILI9488_DEFAULT_MAX_TRANSFER_BYTES
+    uint8_t spi_queue_size;     // device queue_size, 0 = ILI9488_DEFAULT_QUEUE_SIZE
+    ili9488_pixel_format_t pixel_format;
+    ili9488_bus_hooks_t bus_hooks;
 } ili9488_config_t;
 
+// Pixels are stored in panel byte order (big-endian RGB565) in DMA-capable
+// memory, so an RGB565 blit hands them to the SPI DMA without touching them.
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint16_t *pixels;
+} ili9488_surface_t;
+
+typedef struct {
+    uint8_t buffer_count;
+    size_t chunk_bytes;
+    uint8_t in_use;
+    uint8_t high_water;
+    uint32_t stalls;
+} ili9488_pool_stats_t;
+
 esp_err_t ili9488_init(ili9488_t *lcd, const ili9488_config_t *config);
+void ili9488_deinit(ili9488_t *lcd);
 esp_err_t ili9488_set_window(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
 esp_err_t ili9488_fill_color(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color);
 esp_err_t ili9488_draw_rgb565_bitmap(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap);
 esp_err_t ili9488_set_backlight(ili9488_t *lcd, bool enable);
 
+// Streaming pixel writes. write_begin opens a window, then each acquired
+// buffer is filled with big-endian RGB565 and queued with write_submit while
+// the previous one is still being clocked out (in RGB666 mode write_submit
+// first expands it in place). Nothing blocks until a buffer is reused; call
+// ili9488_wait_idle() as a fence.
+esp_err_t ili9488_write_begin(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+esp_err_t ili9488_write_acquire(ili9488_t *lcd, uint8_t **buffer, size_t *max_pixels);
+esp_err_t ili9488_write_submit(ili9488_t *lcd, size_t pixels, bool last);
+esp_err_t ili9488_wait_idle(ili9488_t *lcd);
+ili9488_fence_t ili9488_fence(const ili9488_t *lcd);
+esp_err_t ili9488_wait_fence(ili9488_t *lcd, ili9488_fence_t fence);
+void ili9488_get_pool_stats(const ili9488_t *lcd, ili9488_pool_stats_t *stats);
+// Queued behind pending pixel data. Pool chunks keep their size in bytes, so
+// they hold a third fewer pixels in RGB666 mode.
+esp_err_t ili9488_set_pixel_format(ili9488_t *lcd, ili9488_pixel_format_t format);
+// Expands panel-order RGB565 into R, G, B bytes whose top six bits the panel
+// uses. Word-aligned buffers take a four-pixel path.
+void ili9488_rgb565_to_rgb666(uint8_t *dst, const uint16_t *src, size_t pixels);
+
+static inline uint16_t ili9488_panel_color(uint16_t rgb565) {
+    return (uint16_t)((rgb565 << 8) | (rgb565 >> 8));
+}
+
+esp_err_t ili9488_surface_create(ili9488_surface_t *surface, uint16_t width, uint16_t height);
+void ili9488_surface_destroy(ili9488_surface_t *surface);
+// RGB565 blits are queued straight from the source memory: it must be
+// DMA-capable and must not be modified until ili9488_wait_idle() returns.
+// RGB666 blits are expanded into pool chunks, so the source is free as soon
+// as the call returns.
+esp_err_t ili9488_blit_panel_pixels(ili9488_t *lcd, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t *pixels);
+esp_err_t ili9488_blit_surface(ili9488_t *lcd, uint16_t x, uint16_t y, const ili9488_surface_t *surface);
+
+// Hardware vertical scroll. The panel is split into a fixed top area, a
+// scrolling area and a fixed bottom area; set_scroll_start picks which frame
+// memory line is shown at the top of the scrolling area, wrapping within it.
+// Both are queued in order with pixel data. Fixed areas of 0 with start 0
+// restore the unscrolled mapping.
+esp_err_t ili9488_set_scroll_area(ili9488_t *lcd, uint16_t top_fixed, uint16_t bottom_fixed);
+esp_err_t ili9488_set_scroll_start(ili9488_t *lcd, uint16_t line);
+
+// Queues a short command list (each command with up to 6 parameter bytes)
+// behind any pending pixel data, without waiting for the bus.
+esp_err_t ili9488_queue_cmds(ili9488_t *lcd, const ili9488_cmd_t *cmds, size_t count);
+
+// Hooks for spi_device_interface_config_t. pre_cb drives the DC pin for
+// queued transactions and is required; post_cb makes done_callback fire.
+void ili9488_spi_pre_transfer_cb(spi_transaction_t *trans);
+void ili9488_spi_post_transfer_cb(spi_transaction_t *trans);
+
 void ili9488_delay_ms(uint32_t ms);
@@ -0,0 +1,638 @@
+#include "jpeg_decoder.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define TAG "JPEG"
+
+#define JPEG_MARKER_SOF0 0xC0
+#define JPEG_MARKER_SOF1 0xC1
+#define JPEG_MARKER_DHT 0xC4
+#define JPEG_MARKER_RST0 0xD0
+#define JPEG_MARKER_SOI 0xD8
+#define JPEG_MARKER_EOI 0xD9
+#define JPEG_MARKER_SOS 0xDA
+#define JPEG_MARKER_DQT 0xDB
+#define JPEG_MARKER_DRI 0xDD
+
+#define JPEG_MAX_COMPONENTS 3
+#define JPEG_HUFF_FAST_BITS 8
+#define JPEG_IDCT_BITS 12
+
+typedef struct {
+    // Codes up to 8 bits resolve in one lookup: symbol | length << 8.
+    uint16_t fast[1 << JPEG_HUFF_FAST_BITS];
+    int32_t maxcode[18];
+    int32_t valoffset[17];
+    uint8_t values[256];
+    bool defined;
+} jpeg_huffman_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t h;
+    uint8_t v;
+    uint8_t quant;
+    uint8_t dc_table;
+    uint8_t ac_table;
+    int32_t dc_pred;
+} jpeg_component_t;
+
+struct jpeg_decoder_s {
+    jpeg_decoder_config_t config;
+    jpeg_info_t info;
+    jpeg_component_t components[JPEG_MAX_COMPONENTS];
+    uint8_t max_h;
+    uint8_t max_v;
+    uint16_t quant[4][64]; // zigzag order, as stored in DQT
+    jpeg_huffman_t dc_tables[2];
+    jpeg_huffman_t ac_tables[2];
+    uint16_t restart_interval;
+    bool header_done;
+
+    uint8_t input[JPEG_DECODER_INPUT_BLOCK];
+    size_t input_pos;
+    size_t input_len;
+    bool input_eof;
+
+    uint32_t bits;
+    int32_t bit_count;
+    uint8_t marker;
+
+    int32_t idct_table[8][8];
+    int32_t coef[64];
+    int32_t idct_tmp[64];
+    // Scaled samples of one MCU: Y up to 2x2 blocks, chroma one block each.
+    uint8_t samples[JPEG_MAX_COMPONENTS][16 * 16];
+
+    jpeg_decoder_stats_t stats;
+};
+
+static const uint8_t jpeg_zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+static int jpeg_next_byte(jpeg_decoder_t *dec) {
+    if (dec->input_pos == dec->input_len) {
+        if (dec->input_eof) {
+            return -1;
+        }
+        int got = dec->config.read(dec->config.user_data, dec->input, sizeof(dec->input));
+        if (got <= 0) {
+            dec->input_eof = true;
+            return -1;
+        }
+        dec->input_pos = 0;
+        dec->input_len = (size_t)got;
+    }
+    return dec->input[dec->input_pos++];
+}
+
+static esp_err_t jpeg_read_u8(jpeg_decoder_t *dec, uint8_t *out) {
+    int byte = jpeg_next_byte(dec);
+    if (byte < 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out = (uint8_t)byte;
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_read_u16(jpeg_decoder_t *dec, uint16_t *out) {
+    uint8_t hi, lo;
+    ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &hi), TAG, "Truncated file");
+    ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &lo), TAG, "Truncated file");
+    *out = (uint16_t)((hi << 8) | lo);
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_skip(jpeg_decoder_t *dec, size_t len) {
+    uint8_t dummy;
+    while (len--) {
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &dummy), TAG, "Truncated file");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_next_marker(jpeg_decoder_t *dec, uint8_t *marker) {
+    uint8_t byte = 0;
+    // Skip anything up to a 0xFF, then any fill bytes.
+    while (byte != 0xFF) {
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &byte), TAG, "Truncated file");
+    }
+    while (byte == 0xFF) {
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &byte), TAG, "Truncated file");
+    }
+    *marker = byte;
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_parse_dqt(jpeg_decoder_t *dec, uint16_t len) {
+    while (len > 0) {
+        uint8_t pq_tq;
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &pq_tq), TAG, "Truncated DQT");
+        uint8_t precision = pq_tq >> 4;
+        uint8_t id = pq_tq & 0x0F;
+        size_t size = 1 + 64 * (precision ? 2 : 1);
+        if (id > 3 || precision > 1 || len < size) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int k = 0; k < 64; ++k) {
+            if (precision) {
+                ESP_RETURN_ON_ERROR(jpeg_read_u16(dec, &dec->quant[id][k]), TAG, "Truncated DQT");
+            } else {
+                uint8_t q;
+                ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &q), TAG, "Truncated DQT");
+                dec->quant[id][k] = q;
+            }
+        }
+        len -= size;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_build_huffman(jpeg_huffman_t *table, const uint8_t counts[16]) {
+    // Canonical codes: within a length they count up, and each new length
+    // starts at the previous code shifted left.
+    int32_t code = 0;
+    int32_t index = 0;
+    memset(table->fast, 0, sizeof(table->fast));
+    for (int len = 1; len <= 16; ++len) {
+        table->valoffset[len] = index - code;
+        // An oversubscribed length would run off the end of fast[].
+        if (code + counts[len - 1] > (1 << len)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int i = 0; i < counts[len - 1]; ++i, ++index, ++code) {
+            if (len <= JPEG_HUFF_FAST_BITS) {
+                int shift = JPEG_HUFF_FAST_BITS - len;
+                for (int fill = 0; fill < (1 << shift); ++fill) {
+                    table->fast[(code << shift) | fill] = table->values[index] | (len << 8);
+                }
+            }
+        }
+        table->maxcode[len] = counts[len - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+    table->maxcode[17] = INT32_MAX;
+    table->defined = true;
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_parse_dht(jpeg_decoder_t *dec, uint16_t len) {
+    while (len > 0) {
+        uint8_t tc_th;
+        uint8_t counts[16];
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &tc_th), TAG, "Truncated DHT");
+        size_t total = 0;
+        for (int i = 0; i < 16; ++i) {
+            ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &counts[i]), TAG, "Truncated DHT");
+            total += counts[i];
+        }
+        uint8_t cls = tc_th >> 4;
+        uint8_t id = tc_th & 0x0F;
+        if (cls > 1 || id > 1 || total > 256 || len < 17 + total) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        jpeg_huffman_t *table = cls ? &dec->ac_tables[id] : &dec->dc_tables[id];
+        for (size_t i = 0; i < total; ++i) {
+            ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &table->values[i]), TAG, "Truncated DHT");
+        }
+        ESP_RETURN_ON_ERROR(jpeg_build_huffman(table, counts), TAG, "Bad Huffman table");
+        len -= 17 + total;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_parse_sof(jpeg_decoder_t *dec, uint16_t len) {
+    uint8_t precision, count;
+    ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &precision), TAG, "Truncated SOF");
+    ESP_RETURN_ON_ERROR(jpeg_read_u16(dec, &dec->info.height), TAG, "Truncated SOF");
+    ESP_RETURN_ON_ERROR(jpeg_read_u16(dec, &dec->info.width), TAG, "Truncated SOF");
+    ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &count), TAG, "Truncated SOF");
+    if (precision != 8 || (count != 1 && count != 3) || len != 6 + count * 3 ||
+        dec->info.width == 0 || dec->info.height == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    dec->info.components = count;
+    dec->max_h = 1;
+    dec->max_v = 1;
+    for (int i = 0; i < count; ++i) {
+        jpeg_component_t *comp = &dec->components[i];
+        uint8_t sampling;
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &comp->id), TAG, "Truncated SOF");
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &sampling), TAG, "Truncated SOF");
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &comp->quant), TAG, "Truncated SOF");
+        comp->h = sampling >> 4;
+        comp->v = sampling & 0x0F;
+        if (comp->h < 1 || comp->h > 2 || comp->v < 1 || comp->v > 2 || comp->quant > 3) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        dec->max_h = comp->h > dec->max_h ? comp->h : dec->max_h;
+        dec->max_v = comp->v > dec->max_v ? comp->v : dec->max_v;
+    }
+    if (count == 1) {
+        // A single-component scan is never interleaved: one block per MCU.
+        dec->components[0].h = dec->components[0].v = 1;
+        dec->max_h = dec->max_v = 1;
+    } else if (dec->components[1].h != 1 || dec->components[1].v != 1 ||
+               dec->components[2].h != 1 || dec->components[2].v != 1) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    dec->info.mcu_width = 8 * dec->max_h;
+    dec->info.mcu_height = 8 * dec->max_v;
+    return ESP_OK;
+}
+
+static esp_err_t jpeg_parse_sos(jpeg_decoder_t *dec, uint16_t len) {
+    uint8_t count;
+    ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &count), TAG, "Truncated SOS");
+    if (count != dec->info.components || len != 4 + count * 2) {
+        // Non-interleaved colour scans are a progressive-style layout.
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    for (int i = 0; i < count; ++i) {
+        uint8_t id, tables;
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &id), TAG, "Truncated SOS");
+        ESP_RETURN_ON_ERROR(jpeg_read_u8(dec, &tables), TAG, "Truncated SOS");
+        jpeg_component_t *comp = NULL;
+        for (int c = 0; c < dec->info.components; ++c) {
+            if (dec->components[c].id == id) {
+                comp = &dec->components[c];
+            }
+        }
+        if (!comp || (tables >> 4) > 1 || (tables & 0x0F) > 1) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        comp->dc_table = tables >> 4;
+        comp->ac_table = tables & 0x0F;
+        if (!dec->dc_tables[comp->dc_table].defined || !dec->ac_tables[comp->ac_table].defined) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    // Spectral selection and approximation are fixed for baseline.
+    return jpeg_skip(dec, 3);
+}
+
+esp_err_t jpeg_decoder_read_header(jpeg_decoder_t *dec, jpeg_info_t *info) {
+    ESP_RETURN_ON_FALSE(dec && info, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    uint8_t marker;
+    ESP_RETURN_ON_ERROR(jpeg_next_marker(dec, &marker), TAG, "No SOI");
+    ESP_RETURN_ON_FALSE(marker == JPEG_MARKER_SOI, ESP_ERR_INVALID_ARG, TAG, "Not a JPEG");
+    bool have_frame = false;
+    while (true) {
+        ESP_RETURN_ON_ERROR(jpeg_next_marker(dec, &marker), TAG, "Truncated header");
+        if (marker == JPEG_MARKER_EOI || (marker >= JPEG_MARKER_RST0 && marker < JPEG_MARKER_RST0 + 8)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        uint16_t len;
+        ESP_RETURN_ON_ERROR(jpeg_read_u16(dec, &len), TAG, "Truncated header");
+        ESP_RETURN_ON_FALSE(len >= 2, ESP_ERR_INVALID_ARG, TAG, "Bad segment length");
+        len -= 2;
+        switch (marker) {
+            case JPEG_MARKER_SOF0:
+            case JPEG_MARKER_SOF1:
+                ESP_RETURN_ON_ERROR(jpeg_parse_sof(dec, len), TAG, "Unsupported frame");
+                have_frame = true;
+                break;
+            case JPEG_MARKER_DHT:
+                ESP_RETURN_ON_ERROR(jpeg_parse_dht(dec, len), TAG, "Bad DHT");
+                break;
+            case JPEG_MARKER_DQT:
+                ESP_RETURN_ON_ERROR(jpeg_parse_dqt(dec, len), TAG, "Bad DQT");
+                break;
+            case JPEG_MARKER_DRI:
+                ESP_RETURN_ON_FALSE(len == 2, ESP_ERR_INVALID_ARG, TAG, "Bad DRI");
+                ESP_RETURN_ON_ERROR(jpeg_read_u16(dec, &dec->restart_interval), TAG, "Truncated DRI");
+                break;
+            case JPEG_MARKER_SOS:
+                ESP_RETURN_ON_FALSE(have_frame, ESP_ERR_INVALID_ARG, TAG, "SOS before SOF");
+                ESP_RETURN_ON_ERROR(jpeg_parse_sos(dec, len), TAG, "Unsupported scan");
+                dec->header_done = true;
+                *info = dec->info;
+                return ESP_OK;
+            default:
+                if ((marker & 0xF0) == 0xC0 && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+                    // Progressive, lossless and arithmetic-coded frames.
+                    ESP_LOGW(TAG, "Unsupported frame type 0x%02X", marker);
+                    return ESP_ERR_NOT_SUPPORTED;
+                }
+                ESP_RETURN_ON_ERROR(jpeg_skip(dec, len), TAG, "Truncated segment");
+                break;
+        }
+    }
+}
+
+static void jpeg_fill_bits(jpeg_decoder_t *dec) {
+    while (dec->bit_count <= 24) {
+        int byte = 0;
+        if (!dec->marker) {
+            byte = jpeg_next_byte(dec);
+            if (byte == 0xFF) {
+                int next = jpeg_next_byte(dec);
+                while (next == 0xFF) {
+                    next = jpeg_next_byte(dec);
+                }
+                if (next != 0) {
+                    // A marker ends the entropy data; feed zeros past it.
+                    dec->marker = next < 0 ? JPEG_MARKER_EOI : (uint8_t)next;
+                    byte = 0;
+                }
+            } else if (byte < 0) {
+                dec->marker = JPEG_MARKER_EOI;
+                byte = 0;
+            }
+        }
+        dec->bits |= (uint32_t)byte << (24 - dec->bit_count);
+        dec->bit_count += 8;
+    }
+}
+
+static inline int32_t jpeg_get_bits(jpeg_decoder_t *dec, int n) {
+    if (n == 0) {
+        return 0;
+    }
+    if (dec->bit_count < n) {
+        jpeg_fill_bits(dec);
+    }
+    int32_t value = (int32_t)(dec->bits >> (32 - n));
+    dec->bits <<= n;
+    dec->bit_count -= n;
+    return value;
+}
+
+static inline int32_t jpeg_extend(int32_t value, int n) {
+    return value < (1 << (n - 1)) ? value - (1 << n) + 1 : value;
+}
+
+static int jpeg_decode_huffman(jpeg_decoder_t *dec, const jpeg_huffman_t *table) {
+    if (dec->bit_count < 16) {
+        jpeg_fill_bits(dec);
+    }
+    uint16_t fast = table->fast[dec->bits >> (32 - JPEG_HUFF_FAST_BITS)];
+    if (fast) {
+        int len = fast >> 8;
+        dec->bits <<= len;
+        dec->bit_count -= len;
+        return fast & 0xFF;
+    }
+    for (int len = JPEG_HUFF_FAST_BITS + 1; len <= 16; ++len) {
+        int32_t code = (int32_t)(dec->bits >> (32 - len));
+        if (code <= table->maxcode[len]) {
+            dec->bits <<= len;
+            dec->bit_count -= len;
+            return table->values[code + table->valoffset[len]];
+        }
+    }
+    return -1;
+}
+
+static inline int32_t jpeg_clamp16(int32_t value) {
+    return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+// Decodes one block into dec->coef (natural order, dequantised) and returns
+// the zigzag index of the last coded coefficient, or -1 on corrupt data.
+static int jpeg_decode_block(jpeg_decoder_t *dec, jpeg_component_t *comp) {
+    const uint16_t *quant = dec->quant[comp->quant];
+    int32_t *coef = dec->coef;
+    memset(coef, 0, sizeof(dec->coef));
+
+    int s = jpeg_decode_huffman(dec, &dec->dc_tables[comp->dc_table]);
+    if (s < 0 || s > 11) {
+        return -1;
+    }
+    comp->dc_pred += s ? jpeg_extend(jpeg_get_bits(dec, s), s) : 0;
+    coef[0] = jpeg_clamp16(comp->dc_pred * quant[0]);
+
+    const jpeg_huffman_t *ac = &dec->ac_tables[comp->ac_table];
+    int last = 0;
+    for (int k = 1; k < 64;) {
+        int rs = jpeg_decode_huffman(dec, ac);
+        if (rs < 0) {
+            return -1;
+        }
+        int run = rs >> 4;
+        s = rs & 0x0F;
+        if (s == 0) {
+            if (run != 15) {
+                break;
+            }
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) {
+            return -1;
+        }
+        coef[jpeg_zigzag[k]] = jpeg_clamp16(jpeg_extend(jpeg_get_bits(dec, s), s) * quant[k]);
+        last = k++;
+    }
+    return last;
+}
+
+static void jpeg_build_idct(jpeg_decoder_t *dec, int n) {
+    // n-point IDCT on the n lowest-frequency coefficients: the 8-point
+    // basis sampled at the centres of the reduced pixels.
+    const double pi = 3.14159265358979323846;
+    for (int x = 0; x < n; ++x) {
+        for (int u = 0; u < n; ++u) {
+            double c = u == 0 ? sqrt(0.5) : 1.0;
+            double w = c / 2.0 * cos((2 * x + 1) * u * pi / (2.0 * n));
+            dec->idct_table[x][u] = (int32_t)lround(w * (1 << JPEG_IDCT_BITS));
+        }
+    }
+}
+
+static inline uint8_t jpeg_clamp8(int32_t value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+static void jpeg_idct_block(jpeg_decoder_t *dec, int last, int n, uint8_t *out, size_t stride) {
+    const int32_t round = 1 << (JPEG_IDCT_BITS - 1);
+    const int32_t *coef = dec->coef;
+    if (last == 0) {
+        int32_t dc = (coef[0] * dec->idct_table[0][0] + round) >> JPEG_IDCT_BITS;
+        uint8_t value = jpeg_clamp8(((dc * dec->idct_table[0][0] + round) >> JPEG_IDCT_BITS) + 128);
+        for (int y = 0; y < n; ++y) {
+            memset(out + y * stride, value, n);
+        }
+        return;
+    }
+    int32_t *tmp = dec->idct_tmp;
+    for (int v = 0; v < n; ++v) {
+        const int32_t *row = coef + v * 8;
+        for (int x = 0; x < n; ++x) {
+            int32_t sum = 0;
+            for (int u = 0; u < n; ++u) {
+                sum += dec->idct_table[x][u] * row[u];
+            }
+            tmp[v * 8 + x] = jpeg_clamp16((sum + round) >> JPEG_IDCT_BITS);
+        }
+    }
+    for (int x = 0; x < n; ++x) {
+        for (int y = 0; y < n; ++y) {
+            int32_t sum = 0;
+            for (int v = 0; v < n; ++v) {
+                sum += dec->idct_table[y][v] * tmp[v * 8 + x];
+            }
+            out[y * stride + x] = jpeg_clamp8(((sum + round) >> JPEG_IDCT_BITS) + 128);
+        }
+    }
+}
+
+static inline uint16_t jpeg_panel_pixel(int32_t y, int32_t cb, int32_t cr) {
+    // JFIF YCbCr to RGB in 16.16 fixed point.
+    int32_t r = jpeg_clamp8(y + ((91881 * cr + 32768) >> 16));
+    int32_t g = jpeg_clamp8(y + ((-22554 * cb - 46802 * cr + 32768) >> 16));
+    int32_t b = jpeg_clamp8(y + ((116130 * cb + 32768) >> 16));
+    uint16_t px = (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+    return (uint16_t)((px << 8) | (px >> 8));
+}
+
+static esp_err_t jpeg_restart(jpeg_decoder_t *dec) {
+    if (!dec->marker) {
+        // The RST marker has not been reached yet; drop padding up to it.
+        int byte;
+        do {
+            byte = jpeg_next_byte(dec);
+            while (byte == 0xFF) {
+                byte = jpeg_next_byte(dec);
+                if (byte > 0) {
+                    dec->marker = (uint8_t)byte;
+                }
+            }
+        } while (!dec->marker && byte >= 0);
+    }
+    if (dec->marker < JPEG_MARKER_RST0 || dec->marker >= JPEG_MARKER_RST0 + 8) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    dec->marker = 0;
+    dec->bits = 0;
+    dec->bit_count = 0;
+    for (int c = 0; c < dec->info.components; ++c) {
+        dec->components[c].dc_pred = 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t jpeg_decoder_decode(jpeg_decoder_t *dec, jpeg_scale_t scale) {
+    ESP_RETURN_ON_FALSE(dec && dec->header_done && scale <= JPEG_SCALE_1_8, ESP_ERR_INVALID_STATE, TAG, "Header not read");
+    int64_t start_us = esp_timer_get_time();
+    const int n = 8 >> scale;
+    const uint16_t out_width = jpeg_scaled_size(dec->info.width, scale);
+    const uint16_t out_height = jpeg_scaled_size(dec->info.height, scale);
+    const uint16_t mcu_out_w = dec->info.mcu_width >> scale;
+    const uint16_t mcu_out_h = dec->info.mcu_height >> scale;
+    const uint16_t mcus_x = (dec->info.width + dec->info.mcu_width - 1) / dec->info.mcu_width;
+    const uint16_t mcus_y = (dec->info.height + dec->info.mcu_height - 1) / dec->info.mcu_height;
+    const bool color = dec->info.components == 3;
+    jpeg_build_idct(dec, n);
+
+    dec->bits = 0;
+    dec->bit_count = 0;
+    dec->marker = 0;
+    for (int c = 0; c < dec->info.components; ++c) {
+        dec->components[c].dc_pred = 0;
+    }
+
+    uint32_t mcus_left = dec->restart_interval;
+    esp_err_t ret = ESP_OK;
+    for (uint16_t my = 0; my < mcus_y && ret == ESP_OK; ++my) {
+        uint16_t y0 = my * mcu_out_h;
+        uint16_t rows = out_height - y0 < mcu_out_h ? out_height - y0 : mcu_out_h;
+        uint16_t *strip = dec->config.strip_begin(dec->config.user_data, y0, rows);
+        if (!strip) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        size_t strip_bytes = (size_t)out_width * rows * sizeof(uint16_t);
+        if (strip_bytes > dec->stats.strip_bytes) {
+            dec->stats.strip_bytes = strip_bytes;
+        }
+        for (uint16_t mx = 0; mx < mcus_x; ++mx) {
+            if (dec->restart_interval) {
+                if (mcus_left == 0) {
+                    ESP_RETURN_ON_ERROR(jpeg_restart(dec), TAG, "Missing restart marker");
+                    mcus_left = dec->restart_interval;
+                }
+                mcus_left--;
+            }
+            for (int c = 0; c < dec->info.components; ++c) {
+                jpeg_component_t *comp = &dec->components[c];
+                const size_t stride = comp->h * n;
+                for (int by = 0; by < comp->v; ++by) {
+                    for (int bx = 0; bx < comp->h; ++bx) {
+                        int last = jpeg_decode_block(dec, comp);
+                        if (last < 0) {
+                            ESP_LOGE(TAG, "Corrupt data at MCU %u,%u", mx, my);
+                            return ESP_ERR_INVALID_RESPONSE;
+                        }
+                        jpeg_idct_block(dec, last, n, &dec->samples[c][by * n * stride + bx * n], stride);
+                    }
+                }
+            }
+            // Colour-convert the visible part of the MCU; chroma is
+            // replicated up to the luma resolution.
+            uint16_t x0 = mx * mcu_out_w;
+            uint16_t cols = out_width - x0 < mcu_out_w ? out_width - x0 : mcu_out_w;
+            const size_t y_stride = dec->max_h * n;
+            for (uint16_t y = 0; y < rows; ++y) {
+                uint16_t *dst = strip + (size_t)y * out_width + x0;
+                const uint8_t *luma = &dec->samples[0][y * y_stride];
+                if (!color) {
+                    for (uint16_t x = 0; x < cols; ++x) {
+                        dst[x] = jpeg_panel_pixel(luma[x], 0, 0);
+                    }
+                    continue;
+                }
+                const size_t chroma_row = (y / dec->max_v) * n;
+                const uint8_t *cb = &dec->samples[1][chroma_row];
+                const uint8_t *cr = &dec->samples[2][chroma_row];
+                for (uint16_t x = 0; x < cols; ++x) {
+                    uint16_t cx = x / dec->max_h;
+                    dst[x] = jpeg_panel_pixel(luma[x], cb[cx] - 128, cr[cx] - 128);
+                }
+            }
+        }
+        ret = dec->config.strip_end(dec->config.user_data, y0, rows);
+    }
+    dec->stats.decode_us = (uint32_t)(esp_timer_get_time() - start_us);
+    return ret;
+}
+
+jpeg_scale_t jpeg_pick_scale(const jpeg_info_t *info, uint16_t max_width, uint16_t max_height) {
+    jpeg_scale_t scale = JPEG_SCALE_1_1;
+    while (scale < JPEG_SCALE_1_8 &&
+           (jpeg_scaled_size(info->width, scale) > max_width || jpeg_scaled_size(info->height, scale) > max_height)) {
+        scale++;
+    }
+    return scale;
+}
+
+esp_err_t jpeg_decoder_create(jpeg_decoder_t **handle, const jpeg_decoder_config_t *config) {
+    ESP_RETURN_ON_FALSE(handle && config && config->read && config->strip_begin && config->strip_end,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    jpeg_decoder_t *dec = calloc(1, sizeof(jpeg_decoder_t));
+    ESP_RETURN_ON_FALSE(dec, ESP_ERR_NO_MEM, TAG, "No memory for decoder");
+    dec->config = *config;
+    dec->stats.context_bytes = sizeof(jpeg_decoder_t);
+    *handle = dec;
+    return ESP_OK;
+}
+
+void jpeg_decoder_destroy(jpeg_decoder_t *dec) {
+    free(dec);
+}
+
+void jpeg_decoder_get_stats(const jpeg_decoder_t *dec, jpeg_decoder_stats_t *stats) {
+    if (dec && stats) {
+        *stats = dec->stats;
+    }
+}
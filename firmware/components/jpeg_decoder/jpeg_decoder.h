@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define JPEG_DECODER_INPUT_BLOCK 512
+
+// Output is reduced during the IDCT, so 1/8 only ever computes the DC term.
+typedef enum {
+    JPEG_SCALE_1_1 = 0,
+    JPEG_SCALE_1_2,
+    JPEG_SCALE_1_4,
+    JPEG_SCALE_1_8,
+} jpeg_scale_t;
+
+// Returns the number of bytes read, 0 at end of input or -1 on error.
+typedef int (*jpeg_read_callback_t)(void *user_data, uint8_t *buffer, size_t len);
+// Returns a buffer for output rows [y, y + rows) of the scaled image, with a
+// stride of the scaled width. Pixels are written in panel byte order
+// (big-endian RGB565). Return NULL to abort the decode.
+typedef uint16_t *(*jpeg_strip_begin_callback_t)(void *user_data, uint16_t y, uint16_t rows);
+// The strip from the matching strip_begin is complete.
+typedef esp_err_t (*jpeg_strip_end_callback_t)(void *user_data, uint16_t y, uint16_t rows);
+
+typedef struct {
+    jpeg_read_callback_t read;
+    jpeg_strip_begin_callback_t strip_begin;
+    jpeg_strip_end_callback_t strip_end;
+    void *user_data;
+} jpeg_decoder_config_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t components;
+    uint8_t mcu_width;
+    uint8_t mcu_height;
+} jpeg_info_t;
+
+typedef struct {
+    size_t context_bytes; // everything the decoder allocates
+    size_t strip_bytes;   // largest strip handed to strip_begin
+    uint32_t decode_us;
+} jpeg_decoder_stats_t;
+
+typedef struct jpeg_decoder_s jpeg_decoder_t;
+
+esp_err_t jpeg_decoder_create(jpeg_decoder_t **handle, const jpeg_decoder_config_t *config);
+void jpeg_decoder_destroy(jpeg_decoder_t *handle);
+// Parses markers up to the first scan. Baseline (SOF0/SOF1) greyscale or
+// YCbCr with 4:4:4, 4:2:2, 4:4:0 or 4:2:0 sampling is supported; progressive
+// and arithmetic-coded files return ESP_ERR_NOT_SUPPORTED.
+esp_err_t jpeg_decoder_read_header(jpeg_decoder_t *handle, jpeg_info_t *info);
+// Decodes the scan one MCU row at a time. Each strip is scaled width x
+// (MCU height >> scale) pixels, clipped at the bottom edge.
+esp_err_t jpeg_decoder_decode(jpeg_decoder_t *handle, jpeg_scale_t scale);
+void jpeg_decoder_get_stats(const jpeg_decoder_t *handle, jpeg_decoder_stats_t *stats);
+
+static inline uint16_t jpeg_scaled_size(uint16_t size, jpeg_scale_t scale) {
+    return (uint16_t)((size + (1 << scale) - 1) >> scale);
+}
+
+// Smallest reduction that fits the image inside max_width x max_height;
+// 1/8 if none does.
+jpeg_scale_t jpeg_pick_scale(const jpeg_info_t *info, uint16_t max_width, uint16_t max_height);
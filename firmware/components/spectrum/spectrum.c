@@ -0,0 +1,122 @@
+#include "spectrum.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#define TAG "SPECTRUM"
+#define SPECTRUM_LOW_HZ 40.0f
+#define SPECTRUM_HIGH_HZ 16000.0f
+#define SPECTRUM_FLOOR_DB 60.0f
+#define SPECTRUM_FALL 12 // per frame, about 0.7 s from full scale at 30 fps
+
+esp_err_t spectrum_init(spectrum_t *spectrum, uint32_t sample_rate_hz, uint8_t band_count) {
+    ESP_RETURN_ON_FALSE(spectrum && sample_rate_hz > 0 && band_count > 0 && band_count <= SPECTRUM_MAX_BANDS, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    memset(spectrum, 0, sizeof(*spectrum));
+    spectrum->band_count = band_count;
+    for (size_t i = 0; i < SPECTRUM_FFT_SIZE / 2; ++i) {
+        float phase = 2.0f * (float)M_PI * i / SPECTRUM_FFT_SIZE;
+        spectrum->window[i] = (int16_t)(32767.0f * 0.5f * (1.0f - cosf(phase)));
+        spectrum->cos_table[i] = (int16_t)(32767.0f * cosf(phase));
+        spectrum->sin_table[i] = (int16_t)(32767.0f * sinf(phase));
+    }
+
+    const float nyquist = sample_rate_hz / 2.0f;
+    const float high = SPECTRUM_HIGH_HZ < nyquist ? SPECTRUM_HIGH_HZ : nyquist;
+    const float bin_hz = (float)sample_rate_hz / SPECTRUM_FFT_SIZE;
+    uint16_t edge = 1; // bin 0 is DC
+    for (uint8_t i = 0; i <= band_count; ++i) {
+        float hz = SPECTRUM_LOW_HZ * powf(high / SPECTRUM_LOW_HZ, (float)i / band_count);
+        uint16_t bin = (uint16_t)lroundf(hz / bin_hz);
+        // Low bands are narrower than a bin; give each one of its own.
+        edge = bin > edge ? bin : edge;
+        spectrum->band_edges[i] = edge++;
+    }
+    ESP_RETURN_ON_FALSE(spectrum->band_edges[band_count] <= SPECTRUM_FFT_SIZE / 2, ESP_ERR_INVALID_SIZE, TAG, "Too many bands for the FFT size");
+    return ESP_OK;
+}
+
+// Radix-2 decimation in time. Every stage halves its outputs, so a Q15
+// input can never overflow and the result is the DFT scaled by 1/N.
+static void spectrum_fft(spectrum_t *spectrum) {
+    int16_t *re = spectrum->re;
+    int16_t *im = spectrum->im;
+    for (size_t i = 1, j = 0; i < SPECTRUM_FFT_SIZE; ++i) {
+        size_t bit = SPECTRUM_FFT_SIZE >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (size_t half = 1, step = SPECTRUM_FFT_SIZE / 2; half < SPECTRUM_FFT_SIZE; half <<= 1, step >>= 1) {
+        for (size_t k = 0; k < half; ++k) {
+            const int32_t wr = spectrum->cos_table[k * step];
+            const int32_t wi = -spectrum->sin_table[k * step];
+            for (size_t a = k; a < SPECTRUM_FFT_SIZE; a += half * 2) {
+                size_t b = a + half;
+                int32_t tr = (re[b] * wr - im[b] * wi) >> 15;
+                int32_t ti = (re[b] * wi + im[b] * wr) >> 15;
+                int32_t ar = re[a];
+                int32_t ai = im[a];
+                re[b] = (int16_t)((ar - tr) >> 1);
+                im[b] = (int16_t)((ai - ti) >> 1);
+                re[a] = (int16_t)((ar + tr) >> 1);
+                im[a] = (int16_t)((ai + ti) >> 1);
+            }
+        }
+    }
+}
+
+bool spectrum_process(spectrum_t *spectrum, const int16_t *samples) {
+    int64_t start_us = esp_timer_get_time();
+    uint8_t fresh[SPECTRUM_MAX_BANDS] = {0};
+    if (samples) {
+        for (size_t i = 0; i < SPECTRUM_FFT_SIZE / 2; ++i) {
+            const int32_t w = spectrum->window[i];
+            spectrum->re[i] = (int16_t)((samples[i] * w) >> 15);
+            spectrum->re[SPECTRUM_FFT_SIZE - 1 - i] = (int16_t)((samples[SPECTRUM_FFT_SIZE - 1 - i] * w) >> 15);
+        }
+        memset(spectrum->im, 0, sizeof(spectrum->im));
+        spectrum_fft(spectrum);
+
+        // A full-scale sine puts 1/4 of full scale in its bin after the
+        // Hann window and the 1/N scaling, so that power is 0 dB.
+        const float reference = (32767.0f / 4) * (32767.0f / 4);
+        for (uint8_t band = 0; band < spectrum->band_count; ++band) {
+            uint64_t power = 0;
+            for (uint16_t bin = spectrum->band_edges[band]; bin < spectrum->band_edges[band + 1]; ++bin) {
+                power += (uint32_t)(spectrum->re[bin] * spectrum->re[bin]) + (uint32_t)(spectrum->im[bin] * spectrum->im[bin]);
+            }
+            if (power == 0) {
+                continue;
+            }
+            float db = 10.0f * log10f((float)power / reference) + SPECTRUM_FLOOR_DB;
+            fresh[band] = db <= 0.0f ? 0 : db >= SPECTRUM_FLOOR_DB ? 255 : (uint8_t)(db * 255.0f / SPECTRUM_FLOOR_DB);
+        }
+    }
+
+    bool active = false;
+    for (uint8_t band = 0; band < spectrum->band_count; ++band) {
+        uint8_t fallen = spectrum->levels[band] > SPECTRUM_FALL ? spectrum->levels[band] - SPECTRUM_FALL : 0;
+        spectrum->levels[band] = fresh[band] > fallen ? fresh[band] : fallen;
+        active |= spectrum->levels[band] != 0;
+    }
+
+    spectrum_stats_t *stats = &spectrum->stats;
+    stats->frames++;
+    stats->fft_us = (uint32_t)(esp_timer_get_time() - start_us);
+    if (stats->fft_us > stats->max_fft_us) {
+        stats->max_fft_us = stats->fft_us;
+    }
+    return active;
+}
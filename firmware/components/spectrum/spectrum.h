@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define SPECTRUM_FFT_BITS 10
+#define SPECTRUM_FFT_SIZE (1 << SPECTRUM_FFT_BITS)
+#define SPECTRUM_MAX_BANDS 32
+
+typedef struct {
+    uint32_t frames;
+    uint32_t fft_us; // last window: windowing, FFT and band levels
+    uint32_t max_fft_us;
+} spectrum_stats_t;
+
+// Everything is preallocated, so processing a window never touches the heap.
+typedef struct {
+    uint8_t band_count;
+    uint16_t band_edges[SPECTRUM_MAX_BANDS + 1]; // first FFT bin of each band
+    uint8_t levels[SPECTRUM_MAX_BANDS];          // 0..255 over SPECTRUM_FLOOR_DB..0 dBFS
+    int16_t window[SPECTRUM_FFT_SIZE / 2];        // Hann, Q15, mirrored
+    int16_t cos_table[SPECTRUM_FFT_SIZE / 2];
+    int16_t sin_table[SPECTRUM_FFT_SIZE / 2];
+    int16_t re[SPECTRUM_FFT_SIZE];
+    int16_t im[SPECTRUM_FFT_SIZE];
+    spectrum_stats_t stats;
+} spectrum_t;
+
+// Bands are log-spaced from 40 Hz to 16 kHz (or Nyquist), at least one FFT
+// bin each.
+esp_err_t spectrum_init(spectrum_t *spectrum, uint32_t sample_rate_hz, uint8_t band_count);
+// Transforms SPECTRUM_FFT_SIZE mono samples into band levels. Levels rise
+// at once and fall at a fixed rate; NULL samples only lets them fall.
+// Returns false once every level has fallen to zero.
+bool spectrum_process(spectrum_t *spectrum, const int16_t *samples);
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Pack PNG images into the UI asset partition image.
+
+Each --asset NAME:SOURCE adds one image. Pixels are converted to panel
+order (big-endian RGB565) at build time; alpha below 128 is transparent.
+
+Layout (little-endian):
+
+    header   magic "UIA1", uint16 count, uint16 reserved
+    entries  count x {char name[16]; uint16 width, height;
+                      uint8 encoding, reserved[3]; uint32 offset, size}
+    data     4-byte aligned; offset is relative to the entry itself
+
+Encoding 0 is raw pixels, used for opaque images RLE does not shrink by at
+least a quarter. Encoding 1 starts with a uint32 offset per row (relative to
+the end of the table), then per-row packets that never cross a row: a control
+byte whose top two bits are 0 literal, 1 run, 2 transparent and whose low six
+bits are count - 1, followed by count pixels, one pixel or nothing.
+"""
+
+import argparse
+import os
+import struct
+import zlib
+
+MAGIC = b'UIA1'
+ENTRY_SIZE = 32
+NAME_LEN = 16
+ENCODING_RAW = 0
+ENCODING_RLE = 1
+MAX_PACKET = 64
+
+
+def read_png(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('%s: not a PNG file' % path)
+    pos = 8
+    idat = b''
+    palette = []
+    transparency = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', body)
+        elif kind == b'PLTE':
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b'tRNS':
+            transparency = body
+        elif kind == b'IDAT':
+            idat += body
+        elif kind == b'IEND':
+            break
+    if interlace:
+        raise ValueError('%s: interlaced PNGs are not supported' % path)
+    if depth != 8 and not (color == 3 and depth in (1, 2, 4)):
+        raise ValueError('%s: unsupported bit depth %d' % (path, depth))
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    bpp = max(1, channels * depth // 8)
+    stride = (width * channels * depth + 7) // 8
+    raw = zlib.decompress(idat)
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = bytearray(raw[start + 1:start + 1 + stride])
+        for i in range(stride):
+            left = line[i - bpp] if i >= bpp else 0
+            up = prev[i]
+            corner = prev[i - bpp] if i >= bpp else 0
+            if kind == 1:
+                line[i] = (line[i] + left) & 0xFF
+            elif kind == 2:
+                line[i] = (line[i] + up) & 0xFF
+            elif kind == 3:
+                line[i] = (line[i] + ((left + up) >> 1)) & 0xFF
+            elif kind == 4:
+                p = left + up - corner
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - corner)
+                line[i] = (line[i] + (left if pa <= pb and pa <= pc else up if pb <= pc else corner)) & 0xFF
+        rows.append(line)
+        prev = line
+
+    pixels = []
+    for line in rows:
+        row = []
+        for x in range(width):
+            if color == 3:
+                bit = x * depth
+                index = (line[bit // 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1)
+                r, g, b = palette[index]
+                a = transparency[index] if index < len(transparency) else 255
+            elif color == 0:
+                r = g = b = line[x]
+                a = 255
+            elif color == 4:
+                r = g = b = line[x * 2]
+                a = line[x * 2 + 1]
+            elif color == 2:
+                r, g, b = line[x * 3:x * 3 + 3]
+                a = 255
+            else:
+                r, g, b, a = line[x * 4:x * 4 + 4]
+            row.append(None if a < 128 else ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+        pixels.append(row)
+    return width, height, pixels
+
+
+def panel(px):
+    return struct.pack('>H', px)
+
+
+def encode_row(row):
+    out = bytearray()
+    x = 0
+    while x < len(row):
+        n = 1
+        while x + n < len(row) and n < MAX_PACKET and row[x + n] == row[x]:
+            n += 1
+        if row[x] is None:
+            out.append(0x80 | (n - 1))
+        elif n >= 2:
+            out.append(0x40 | (n - 1))
+            out += panel(row[x])
+        else:
+            # Literal until the next pair of equal or transparent pixels.
+            n = 0
+            while x + n < len(row) and n < MAX_PACKET and row[x + n] is not None and \
+                    not (x + n + 1 < len(row) and row[x + n + 1] == row[x + n]):
+                n += 1
+            out.append(n - 1)
+            for px in row[x:x + n]:
+                out += panel(px)
+        x += n
+    return out
+
+
+def encode(width, height, pixels):
+    raw = b''.join(panel(px) for row in pixels for px in row if px is not None)
+    opaque = len(raw) == width * height * 2
+    table = bytearray()
+    body = bytearray()
+    for row in pixels:
+        table += struct.pack('<I', len(body))
+        body += encode_row(row)
+    rle = bytes(table + body)
+    if opaque and len(rle) * 4 > len(raw) * 3:
+        return ENCODING_RAW, raw
+    return ENCODING_RLE, rle
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--output', required=True)
+    parser.add_argument('--base-dir', default='.')
+    parser.add_argument('--asset', action='append', required=True)
+    args = parser.parse_args()
+
+    assets = []
+    for arg in args.asset:
+        name, source = arg.split(':', 1)
+        if len(name) >= NAME_LEN:
+            raise ValueError('asset name %s is too long' % name)
+        width, height, pixels = read_png(os.path.join(args.base_dir, source))
+        encoding, data = encode(width, height, pixels)
+        assets.append((name, width, height, encoding, data))
+        print('assetgen: %s: %dx%d %s, %d bytes (raw %d)' % (name, width, height, ('raw', 'rle')[encoding], len(data), width * height * 2))
+
+    blob = bytearray(MAGIC + struct.pack('<HH', len(assets), 0))
+    data_start = len(blob) + ENTRY_SIZE * len(assets)
+    payload = bytearray()
+    for index, (name, width, height, encoding, data) in enumerate(assets):
+        entry_pos = len(blob)
+        offset = data_start + len(payload) - entry_pos
+        blob += struct.pack('<16sHHB3xII', name.encode(), width, height, encoding, offset, len(data))
+        payload += data
+        payload += bytes(-len(payload) % 4)
+    blob += payload
+
+    # Only touch the output when it changes so the flash step is skipped.
+    if os.path.exists(args.output):
+        with open(args.output, 'rb') as f:
+            if f.read() == blob:
+                return
+    with open(args.output, 'wb') as f:
+        f.write(blob)
+
+
+if __name__ == '__main__':
+    main()
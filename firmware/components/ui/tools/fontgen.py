@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+"""Compile BDF (or TTF at a pixel size) fonts into packed glyph tables.
+
+Each --font produces one ui_font_t in the output C file:
+
+    --font NAME:SOURCE[:scale=N][:bpp=N][:size=N][:smooth=1][:range=LO-HI]
+
+scale pre-multiplies the bitmaps so the renderer never scales at runtime,
+bpp picks 1, 2 or 4 bits of coverage per pixel and size selects the pixel
+size for TTF/OTF sources (which need the freetype-py module). smooth scales
+bitmap glyphs with EPX to twice the target size and averages each 2x2 block,
+so diagonals come out as coverage the renderer blends instead of stairs. Glyph rows
+are packed MSB first and padded to a whole byte.
+"""
+
+import argparse
+import os
+import sys
+
+
+class Glyph:
+    def __init__(self, codepoint, width, height, x_offset, top, advance, coverage):
+        self.codepoint = codepoint
+        self.width = width
+        self.height = height
+        self.x_offset = x_offset
+        self.top = top  # rows from the top of the line box
+        self.advance = advance
+        self.coverage = coverage  # rows of 0..255 values
+
+
+class Font:
+    def __init__(self, ascent, descent, default_char, glyphs):
+        self.ascent = ascent
+        self.descent = descent
+        self.default_char = default_char
+        self.glyphs = glyphs
+
+
+def load_bdf(path):
+    ascent = descent = None
+    default_char = ord('?')
+    glyphs = {}
+    with open(path, encoding='latin-1') as f:
+        lines = iter(f.read().splitlines())
+    for line in lines:
+        key, _, value = line.partition(' ')
+        if key == 'FONT_ASCENT':
+            ascent = int(value)
+        elif key == 'FONT_DESCENT':
+            descent = int(value)
+        elif key == 'DEFAULT_CHAR':
+            default_char = int(value)
+        elif key == 'STARTCHAR':
+            codepoint = advance = None
+            bbx = (0, 0, 0, 0)
+            for line in lines:
+                key, _, value = line.partition(' ')
+                if key == 'ENCODING':
+                    codepoint = int(value.split()[0])
+                elif key == 'DWIDTH':
+                    advance = int(value.split()[0])
+                elif key == 'BBX':
+                    bbx = tuple(int(v) for v in value.split())
+                elif key == 'BITMAP':
+                    break
+            width, height, x_offset, y_offset = bbx
+            coverage = []
+            for _ in range(height):
+                bits = int(next(lines), 16)
+                nbits = ((width + 7) // 8) * 8
+                coverage.append([255 if bits & (1 << (nbits - 1 - x)) else 0 for x in range(width)])
+            if codepoint is not None and codepoint >= 0:
+                glyphs[codepoint] = (width, height, x_offset, y_offset, advance, coverage)
+    if ascent is None or descent is None:
+        sys.exit('%s: missing FONT_ASCENT/FONT_DESCENT' % path)
+    out = {}
+    for cp, (width, height, x_offset, y_offset, advance, coverage) in glyphs.items():
+        out[cp] = Glyph(cp, width, height, x_offset, ascent - (y_offset + height), advance, coverage)
+    return Font(ascent, descent, default_char, out)
+
+
+def load_ttf(path, size, codepoints, bpp):
+    try:
+        import freetype
+    except ImportError:
+        sys.exit('%s: TTF sources need the freetype-py module' % path)
+    face = freetype.Face(path)
+    face.set_pixel_sizes(0, size)
+    ascent = face.size.ascender >> 6
+    descent = -face.size.descender >> 6
+    flags = freetype.FT_LOAD_RENDER
+    if bpp == 1:
+        flags |= freetype.FT_LOAD_TARGET_MONO
+    glyphs = {}
+    for cp in codepoints:
+        if face.get_char_index(cp) == 0:
+            continue
+        face.load_char(chr(cp), flags)
+        slot = face.glyph
+        bitmap = slot.bitmap
+        coverage = []
+        for y in range(bitmap.rows):
+            row = bitmap.buffer[y * bitmap.pitch:(y + 1) * bitmap.pitch]
+            if bpp == 1:
+                coverage.append([255 if row[x >> 3] & (0x80 >> (x & 7)) else 0 for x in range(bitmap.width)])
+            else:
+                coverage.append(list(row[:bitmap.width]))
+        glyphs[cp] = Glyph(cp, bitmap.width, bitmap.rows, slot.bitmap_left,
+                           ascent - slot.bitmap_top, slot.advance.x >> 6, coverage)
+    return Font(ascent, descent, ord('?'), glyphs)
+
+
+def scale_glyph(glyph, scale):
+    if scale == 1:
+        return glyph
+    coverage = []
+    for row in glyph.coverage:
+        wide = [v for v in row for _ in range(scale)]
+        coverage.extend([list(wide) for _ in range(scale)])
+    return Glyph(glyph.codepoint, glyph.width * scale, glyph.height * scale, glyph.x_offset * scale,
+                 glyph.top * scale, glyph.advance * scale, coverage)
+
+
+def epx(coverage, width, height):
+    def at(x, y):
+        return coverage[y][x] if 0 <= x < width and 0 <= y < height else 0
+    out = [[0] * (width * 2) for _ in range(height * 2)]
+    for y in range(height):
+        for x in range(width):
+            p, a, b, c, d = at(x, y), at(x, y - 1), at(x + 1, y), at(x - 1, y), at(x, y + 1)
+            out[y * 2][x * 2] = a if c == a and c != d and a != b else p
+            out[y * 2][x * 2 + 1] = b if a == b and a != c and b != d else p
+            out[y * 2 + 1][x * 2] = c if d == c and d != b and c != a else p
+            out[y * 2 + 1][x * 2 + 1] = d if b == d and b != a and d != c else p
+    return out
+
+
+def smooth_glyph(glyph, scale):
+    coverage, width, height = glyph.coverage, glyph.width, glyph.height
+    for _ in range((scale * 2).bit_length() - 1):
+        coverage = epx(coverage, width, height)
+        width, height = width * 2, height * 2
+    coverage = [[(row[x] + row[x + 1] + below[x] + below[x + 1] + 2) // 4 for x in range(0, width, 2)]
+                for row, below in zip(coverage[0::2], coverage[1::2])]
+    return Glyph(glyph.codepoint, glyph.width * scale, glyph.height * scale, glyph.x_offset * scale,
+                 glyph.top * scale, glyph.advance * scale, coverage)
+
+
+def crop_glyph(glyph):
+    # Drop blank edge rows and columns so the renderer only walks ink.
+    rows = glyph.coverage
+    lit_rows = [y for y, row in enumerate(rows) if any(row)]
+    if not lit_rows:
+        return Glyph(glyph.codepoint, 0, 0, 0, 0, glyph.advance, [])
+    lit_cols = [x for x in range(glyph.width) if any(row[x] for row in rows)]
+    y0, y1 = lit_rows[0], lit_rows[-1] + 1
+    x0, x1 = lit_cols[0], lit_cols[-1] + 1
+    coverage = [row[x0:x1] for row in rows[y0:y1]]
+    return Glyph(glyph.codepoint, x1 - x0, y1 - y0, glyph.x_offset + x0, glyph.top + y0, glyph.advance, coverage)
+
+
+def pack_glyph(glyph, bpp):
+    levels = (1 << bpp) - 1
+    per_byte = 8 // bpp
+    out = []
+    for row in glyph.coverage:
+        packed = [0] * ((glyph.width + per_byte - 1) // per_byte)
+        for x, value in enumerate(row):
+            level = (value * levels + 127) // 255
+            shift = 8 - bpp * (x % per_byte + 1)
+            packed[x // per_byte] |= level << shift
+        out.extend(packed)
+    return out
+
+
+def parse_font_arg(arg):
+    fields = arg.split(':')
+    if len(fields) < 2:
+        sys.exit('bad --font %r: expected NAME:SOURCE[:key=value...]' % arg)
+    spec = {'name': fields[0], 'source': fields[1], 'scale': 1, 'bpp': 1, 'size': 0, 'smooth': 0, 'range': (0x20, 0xFF)}
+    for field in fields[2:]:
+        key, _, value = field.partition('=')
+        if key in ('scale', 'bpp', 'size', 'smooth'):
+            spec[key] = int(value, 0)
+        elif key == 'range':
+            lo, _, hi = value.partition('-')
+            spec['range'] = (int(lo, 0), int(hi, 0))
+        else:
+            sys.exit('bad --font option %r' % key)
+    if spec['bpp'] not in (1, 2, 4):
+        sys.exit('%s: bpp must be 1, 2 or 4' % spec['name'])
+    if spec['scale'] < 1:
+        sys.exit('%s: scale must be at least 1' % spec['name'])
+    if spec['smooth'] and (spec['bpp'] == 1 or spec['scale'] & (spec['scale'] - 1)):
+        sys.exit('%s: smooth needs bpp of 2 or 4 and a power-of-two scale' % spec['name'])
+    return spec
+
+
+def emit_bytes(values, indent='    ', per_line=16):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append(indent + ', '.join('0x%02X' % v for v in values[i:i + per_line]) + ',')
+    return '\n'.join(lines)
+
+
+def compile_font(spec, base_dir):
+    source = spec['source']
+    if not os.path.isabs(source):
+        source = os.path.join(base_dir, source)
+    lo, hi = spec['range']
+    if source.lower().endswith(('.ttf', '.otf')):
+        if not spec['size']:
+            sys.exit('%s: TTF sources need size=N' % spec['name'])
+        font = load_ttf(source, spec['size'], range(lo, hi + 1), spec['bpp'])
+    else:
+        font = load_bdf(source)
+    scale = smooth_glyph if spec['smooth'] else scale_glyph
+    glyphs = [crop_glyph(scale(font.glyphs[cp], spec['scale']))
+              for cp in sorted(font.glyphs) if lo <= cp <= hi and cp <= 0xFFFF]
+    index = {g.codepoint: i for i, g in enumerate(glyphs)}
+    fallback = index.get(font.default_char, index.get(ord('?')))
+    if fallback is None:
+        sys.exit('%s: no default glyph' % spec['name'])
+    if len(glyphs) > 0xFFFF:
+        sys.exit('%s: too many glyphs' % spec['name'])
+
+    name = spec['name']
+    bitmap = []
+    rows = []
+    for g in glyphs:
+        if g.x_offset < -128 or g.x_offset > 127 or g.top < 0 or g.top > 255 or g.width > 255 or g.advance > 255:
+            sys.exit('%s: glyph U+%04X does not fit the table' % (name, g.codepoint))
+        rows.append('    {0x%04X, %d, %d, %d, %d, %d, %d},' %
+                    (g.codepoint, len(bitmap), g.width, g.height, g.x_offset, g.top, g.advance))
+        bitmap.extend(pack_glyph(g, spec['bpp']))
+    ascii_map = [index.get(cp, fallback) for cp in range(128)]
+
+    text = []
+    text.append('static const uint8_t %s_bitmap[] = {\n%s\n};\n' % (name, emit_bytes(bitmap or [0])))
+    text.append('static const ui_font_glyph_t %s_glyphs[] = {\n%s\n};\n' % (name, '\n'.join(rows)))
+    text.append('static const uint16_t %s_ascii[128] = {\n%s\n};\n' %
+                (name, '\n'.join('    ' + ', '.join(str(v) for v in ascii_map[i:i + 16]) + ','
+                                 for i in range(0, 128, 16))))
+    text.append('const ui_font_t %s = {\n'
+                '    .bitmap = %s_bitmap,\n'
+                '    .glyphs = %s_glyphs,\n'
+                '    .ascii = %s_ascii,\n'
+                '    .glyph_count = %d,\n'
+                '    .fallback = %d,\n'
+                '    .bpp = %d,\n'
+                '    .ascent = %d,\n'
+                '    .line_height = %d,\n'
+                '};\n' % (name, name, name, name, len(glyphs), fallback, spec['bpp'],
+                          font.ascent * spec['scale'], (font.ascent + font.descent) * spec['scale']))
+    return '\n'.join(text), len(bitmap), len(glyphs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--output', required=True)
+    parser.add_argument('--base-dir', default='.')
+    parser.add_argument('--font', action='append', required=True)
+    args = parser.parse_args()
+
+    parts = ['// Generated by fontgen.py; do not edit.\n', '#include "ui_font.h"\n']
+    for arg in args.font:
+        spec = parse_font_arg(arg)
+        text, size, count = compile_font(spec, args.base_dir)
+        parts.append(text)
+        print('fontgen: %s: %d glyphs, %d bitmap bytes' % (spec['name'], count, size))
+    data = '\n'.join(parts)
+    # Only touch the output when it changes so dependents are not rebuilt.
+    if os.path.exists(args.output):
+        with open(args.output) as f:
+            if f.read() == data:
+                return
+    with open(args.output, 'w') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    main()
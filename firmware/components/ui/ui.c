@@ -1,169 +1,586 @@
 #include "ui.h"
 
-#include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "jpeg_decoder.h"
 
 #define TAG "UI"
-#define UI_FONT_WIDTH 5
-#define UI_FONT_HEIGHT 7
-#define UI_FONT_MAX_SCALE 3
 #define UI_PADDING 16
 #define UI_VOLUME_BAR_WIDTH 220
 #define UI_VOLUME_BAR_HEIGHT 20
+#define UI_VOLUME_RADIUS (UI_VOLUME_BAR_HEIGHT / 2)
 #define UI_PLAY_ICON_SIZE 48
-
-typedef struct {
-    char ch;
-    uint8_t rows[UI_FONT_HEIGHT];
-} ui_glyph_t;
-
-#define ROW(a, b, c, d, e) ((a << 4) | (b << 3) | (c << 2) | (d << 1) | (e))
-
-static const ui_glyph_t font_map[] = {
-    {' ', {0, 0, 0, 0, 0, 0, 0}},
-    {'-', {0, 0, 0, ROW(0,1,1,1,0), 0, 0, 0}},
-    {'.', {0,0,0,0,0, ROW(0,1,1,0,0), ROW(0,1,1,0,0)}},
-    {'0', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,1,1), ROW(1,0,1,0,1), ROW(1,1,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'1', {ROW(0,0,1,0,0), ROW(0,1,1,0,0), ROW(1,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(1,1,1,1,1)}},
-    {'2', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(0,0,0,0,1), ROW(0,0,0,1,0), ROW(0,0,1,0,0), ROW(0,1,0,0,0), ROW(1,1,1,1,1)}},
-    {'3', {ROW(1,1,1,1,0), ROW(0,0,0,0,1), ROW(0,0,0,1,0), ROW(0,0,1,1,0), ROW(0,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'4', {ROW(0,0,0,1,0), ROW(0,0,1,1,0), ROW(0,1,0,1,0), ROW(1,0,0,1,0), ROW(1,1,1,1,1), ROW(0,0,0,1,0), ROW(0,0,0,1,0)}},
-    {'5', {ROW(1,1,1,1,1), ROW(1,0,0,0,0), ROW(1,1,1,1,0), ROW(0,0,0,0,1), ROW(0,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'6', {ROW(0,0,1,1,0), ROW(0,1,0,0,0), ROW(1,0,0,0,0), ROW(1,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'7', {ROW(1,1,1,1,1), ROW(0,0,0,0,1), ROW(0,0,0,1,0), ROW(0,0,1,0,0), ROW(0,1,0,0,0), ROW(0,1,0,0,0), ROW(0,1,0,0,0)}},
-    {'8', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'9', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,1), ROW(0,0,0,0,1), ROW(0,0,0,1,0), ROW(0,1,1,0,0)}},
-    {'A', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,1,1,1,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1)}},
-    {'B', {ROW(1,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,1,1,1,0)}},
-    {'C', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'D', {ROW(1,1,1,0,0), ROW(1,0,0,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,1,0), ROW(1,1,1,0,0)}},
-    {'E', {ROW(1,1,1,1,1), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,1,1,1,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,1,1,1,1)}},
-    {'F', {ROW(1,1,1,1,1), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,1,1,1,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0)}},
-    {'G', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,0), ROW(1,0,1,1,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'H', {ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,1,1,1,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1)}},
-    {'I', {ROW(0,1,1,1,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,1,1,1,0)}},
-    {'J', {ROW(0,0,0,1,1), ROW(0,0,0,0,1), ROW(0,0,0,0,1), ROW(0,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'K', {ROW(1,0,0,0,1), ROW(1,0,0,1,0), ROW(1,0,1,0,0), ROW(1,1,0,0,0), ROW(1,0,1,0,0), ROW(1,0,0,1,0), ROW(1,0,0,0,1)}},
-    {'L', {ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,1,1,1,1)}},
-    {'M', {ROW(1,0,0,0,1), ROW(1,1,0,1,1), ROW(1,0,1,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1)}},
-    {'N', {ROW(1,0,0,0,1), ROW(1,1,0,0,1), ROW(1,0,1,0,1), ROW(1,0,0,1,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1)}},
-    {'O', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'P', {ROW(1,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,1,1,1,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0), ROW(1,0,0,0,0)}},
-    {'Q', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,1,1), ROW(1,0,0,0,1), ROW(0,1,1,1,1)}},
-    {'R', {ROW(1,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,1,1,1,0), ROW(1,0,1,0,0), ROW(1,0,0,1,0), ROW(1,0,0,0,1)}},
-    {'S', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(1,0,0,0,0), ROW(0,1,1,1,0), ROW(0,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'T', {ROW(1,1,1,1,1), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0)}},
-    {'U', {ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,1,1,0)}},
-    {'V', {ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(0,1,0,1,0), ROW(0,1,0,1,0), ROW(0,0,1,0,0)}},
-    {'W', {ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,0,0,1), ROW(1,0,1,0,1), ROW(1,0,1,0,1), ROW(1,0,1,0,1), ROW(0,1,0,1,0)}},
-    {'X', {ROW(1,0,0,0,1), ROW(0,1,0,1,0), ROW(0,1,0,1,0), ROW(0,0,1,0,0), ROW(0,1,0,1,0), ROW(0,1,0,1,0), ROW(1,0,0,0,1)}},
-    {'Y', {ROW(1,0,0,0,1), ROW(0,1,0,1,0), ROW(0,1,0,1,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0), ROW(0,0,1,0,0)}},
-    {'Z', {ROW(1,1,1,1,1), ROW(0,0,0,0,1), ROW(0,0,0,1,0), ROW(0,0,1,0,0), ROW(0,1,0,0,0), ROW(1,0,0,0,0), ROW(1,1,1,1,1)}},
-    {'?', {ROW(0,1,1,1,0), ROW(1,0,0,0,1), ROW(0,0,0,0,1), ROW(0,0,0,1,0), ROW(0,0,0,1,0), ROW(0,0,0,0,0), ROW(0,0,0,1,0)}},
-};
+#define UI_TEXT_FONT (&ui_font_large)
+#define UI_TRACK_Y (UI_PADDING + 40)
+#define UI_ART_SIZE 256
+#define UI_ART_Y 104
+#define UI_PROGRESS_HEIGHT 8
+#define UI_PROGRESS_RADIUS (UI_PROGRESS_HEIGHT / 2)
+#define UI_PROGRESS_Y (UI_ART_Y + UI_ART_SIZE + 8)
+#define UI_SPECTRUM_BAR_WIDTH 7
+#define UI_SPECTRUM_GAP 2
+#define UI_BROWSER_HEADER 48
+#define UI_BROWSER_ROW_HEIGHT 24
+#define UI_BROWSER_ROWS ((ILI9488_HEIGHT - UI_BROWSER_HEADER) / UI_BROWSER_ROW_HEIGHT)
 
 static uint16_t ui_color(uint8_t r, uint8_t g, uint8_t b) {
     return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
 
-static const ui_glyph_t *ui_find_glyph(char input) {
-    char target = (char)toupper((int)input);
-    size_t count = sizeof(font_map) / sizeof(font_map[0]);
-    for (size_t i = 0; i < count; ++i) {
-        if (font_map[i].ch == target) {
-            return &font_map[i];
-        }
-    }
-    return &font_map[count - 1]; // '?' fallback
-}
-
-static void ui_draw_char(ui_context_t *ctx, int x, int y, char c, uint8_t scale, uint16_t fg, uint16_t bg) {
-    const ui_glyph_t *glyph = ui_find_glyph(c);
-    const int width = UI_FONT_WIDTH * scale;
-    const int height = UI_FONT_HEIGHT * scale;
-    uint16_t bitmap[UI_FONT_WIDTH * UI_FONT_HEIGHT * UI_FONT_MAX_SCALE * UI_FONT_MAX_SCALE];
-    for (int row = 0; row < UI_FONT_HEIGHT; ++row) {
-        for (int col = 0; col < UI_FONT_WIDTH; ++col) {
-            bool pixel = glyph->rows[row] & (1 << (UI_FONT_WIDTH - 1 - col));
-            uint16_t color = pixel ? fg : bg;
-            for (uint8_t ys = 0; ys < scale; ++ys) {
-                for (uint8_t xs = 0; xs < scale; ++xs) {
-                    int dst_row = row * scale + ys;
-                    int dst_col = col * scale + xs;
-                    bitmap[dst_row * width + dst_col] = color;
-                }
+static ui_rect_t ui_title_rect(void) {
+    return (ui_rect_t) {UI_PADDING, UI_PADDING, ILI9488_WIDTH - UI_PADDING, UI_TEXT_FONT->line_height};
+}
+
+static ui_rect_t ui_track_rect(void) {
+    return (ui_rect_t) {UI_PADDING, UI_TRACK_Y, ILI9488_WIDTH - UI_PADDING, UI_TEXT_FONT->line_height};
+}
+
+static ui_rect_t ui_art_rect(void) {
+    return (ui_rect_t) {(ILI9488_WIDTH - UI_ART_SIZE) / 2, UI_ART_Y, UI_ART_SIZE, UI_ART_SIZE};
+}
+
+static ui_rect_t ui_volume_bar_rect(void) {
+    int16_t y = ILI9488_HEIGHT - UI_PADDING - UI_VOLUME_BAR_HEIGHT;
+    return (ui_rect_t) {UI_PADDING - 2, y - 2, UI_VOLUME_BAR_WIDTH + 4, UI_VOLUME_BAR_HEIGHT + 4};
+}
+
+static ui_rect_t ui_progress_rect(void) {
+    return (ui_rect_t) {UI_PADDING, UI_PROGRESS_Y, ILI9488_WIDTH - 2 * UI_PADDING, UI_PROGRESS_HEIGHT};
+}
+
+static ui_rect_t ui_play_icon_rect(void) {
+    int16_t x = ILI9488_WIDTH - UI_PADDING - UI_PLAY_ICON_SIZE;
+    int16_t y = ILI9488_HEIGHT - UI_PADDING - UI_PLAY_ICON_SIZE - UI_VOLUME_BAR_HEIGHT - 12;
+    return (ui_rect_t) {x, y, UI_PLAY_ICON_SIZE, UI_PLAY_ICON_SIZE};
+}
+
+// Left of the play icon and the same height.
+static ui_rect_t ui_spectrum_rect(void) {
+    ui_rect_t icon = ui_play_icon_rect();
+    int16_t width = UI_SPECTRUM_BANDS * (UI_SPECTRUM_BAR_WIDTH + UI_SPECTRUM_GAP) - UI_SPECTRUM_GAP;
+    return (ui_rect_t) {UI_PADDING, icon.y, width, icon.height};
+}
+
+static int16_t ui_volume_fill_width(uint8_t volume_percent) {
+    return (volume_percent * UI_VOLUME_BAR_WIDTH) / 100;
+}
+
+static int16_t ui_progress_fill_width(uint32_t position_ms, uint32_t duration_ms) {
+    const int16_t width = ui_progress_rect().width;
+    if (duration_ms == 0) {
+        return 0;
+    }
+    if (position_ms >= duration_ms) {
+        return width;
+    }
+    return (int16_t)((uint64_t)position_ms * width / duration_ms);
+}
+
+// Drops a multi-byte sequence cut short by truncation so its lead byte is
+// not drawn as a Latin-1 character.
+static void ui_utf8_truncate(char *str, size_t source_len) {
+    size_t len = strlen(str);
+    if (len == source_len) {
+        return;
+    }
+    size_t start = len;
+    while (start > 0 && ((uint8_t)str[start - 1] & 0xC0) == 0x80) {
+        start--;
+    }
+    if (start == 0 || ((uint8_t)str[start - 1] & 0xC0) != 0xC0) {
+        return;
+    }
+    uint8_t lead = (uint8_t)str[start - 1];
+    size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+    if (len - (start - 1) < need) {
+        str[start - 1] = '\0';
+    }
+}
+
+static int32_t ui_rect_area(const ui_rect_t *r) {
+    return (int32_t)r->width * r->height;
+}
+
+static void ui_damage_add(ui_context_t *ctx, ui_rect_t rect) {
+    // Fold the new rect into any existing one it can join without repainting
+    // pixels neither of them covered; repeat since the result may now join
+    // another entry.
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < ctx->damage_count; ++i) {
+            ui_rect_t joined = ui_rect_union(&ctx->damage[i], &rect);
+            if (ui_rect_area(&joined) <= ui_rect_area(&ctx->damage[i]) + ui_rect_area(&rect)) {
+                rect = joined;
+                ctx->damage[i] = ctx->damage[--ctx->damage_count];
+                merged = true;
+                break;
             }
         }
     }
-    ili9488_draw_rgb565_bitmap(ctx->display, x, y, width, height, bitmap);
+    if (ctx->damage_count < UI_MAX_DAMAGE_RECTS) {
+        ctx->damage[ctx->damage_count++] = rect;
+        return;
+    }
+    size_t best = 0;
+    int32_t best_growth = INT32_MAX;
+    for (size_t i = 0; i < ctx->damage_count; ++i) {
+        ui_rect_t joined = ui_rect_union(&ctx->damage[i], &rect);
+        int32_t growth = ui_rect_area(&joined) - ui_rect_area(&ctx->damage[i]);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    ctx->damage[best] = ui_rect_union(&ctx->damage[best], &rect);
 }
 
-static void ui_draw_text(ui_context_t *ctx, int x, int y, const char *text, uint8_t scale, uint16_t fg, uint16_t bg) {
-    if (!text) {
+static void ui_widget_invalidate(ui_context_t *ctx, ui_widget_id_t id, const ui_rect_t *part) {
+    ui_widget_t *widget = &ctx->widgets[id];
+    ui_rect_t clipped;
+    if (!ui_rect_intersect(part ? part : &widget->bounds, &widget->bounds, &clipped)) {
         return;
     }
-    int cursor_x = x;
-    for (const char *p = text; *p; ++p) {
-        if (*p == '\n') {
-            cursor_x = x;
-            y += (UI_FONT_HEIGHT + 2) * scale;
-            continue;
+    widget->damage = widget->dirty ? ui_rect_union(&widget->damage, &clipped) : clipped;
+    widget->dirty = true;
+}
+
+static void ui_build_volume_bar(ui_context_t *ctx, ui_scene_t *scene) {
+    ui_rect_t r = ui_volume_bar_rect();
+    int16_t x = r.x + 2;
+    int16_t y = r.y + 2;
+    int16_t filled = ui_volume_fill_width(ctx->volume_percent);
+    // A 2 px accent outline around a dark trough, with the level drawn as a
+    // pill of its own so its end stays round.
+    ui_scene_add_round_rect(scene, r.x, r.y, r.width, r.height, UI_VOLUME_RADIUS + 2, ctx->accent_color);
+    ui_scene_add_round_rect(scene, x, y, UI_VOLUME_BAR_WIDTH, UI_VOLUME_BAR_HEIGHT, UI_VOLUME_RADIUS, ui_color(30, 30, 30));
+    ui_scene_add_round_rect(scene, x, y, filled, UI_VOLUME_BAR_HEIGHT, UI_VOLUME_RADIUS, ctx->accent_color);
+}
+
+static void ui_build_progress_bar(ui_context_t *ctx, ui_scene_t *scene) {
+    ui_rect_t r = ui_progress_rect();
+    int16_t filled = ui_progress_fill_width(ctx->position_ms, ctx->duration_ms);
+    uint16_t color = ctx->scrubbing ? ui_color(255, 255, 255) : ctx->accent_color;
+    ui_scene_add_round_rect(scene, r.x, r.y, r.width, r.height, UI_PROGRESS_RADIUS, ui_color(30, 30, 30));
+    ui_scene_add_round_rect(scene, r.x, r.y, filled, r.height, UI_PROGRESS_RADIUS, color);
+}
+
+static void ui_build_play_pause_icon(ui_context_t *ctx, ui_scene_t *scene) {
+    ui_rect_t r = ui_play_icon_rect();
+    if (ui_scene_add_image(scene, r.x, r.y, ctx->is_playing ? ctx->pause_icon : ctx->play_icon)) {
+        return;
+    }
+    // Drawn from primitives when the asset partition is missing.
+    if (ctx->is_playing) {
+        ui_scene_add_round_rect(scene, r.x + 10, r.y + 8, 8, UI_PLAY_ICON_SIZE - 16, 2, ctx->accent_color);
+        ui_scene_add_round_rect(scene, r.x + 24, r.y + 8, 8, UI_PLAY_ICON_SIZE - 16, 2, ctx->accent_color);
+    } else {
+        const int16_t xs[3] = {r.x + 12, r.x + 12, r.x + 38};
+        const int16_t ys[3] = {r.y + 8, r.y + UI_PLAY_ICON_SIZE - 9, r.y + UI_PLAY_ICON_SIZE / 2 - 1};
+        ui_scene_add_triangle(scene, xs, ys, ctx->accent_color);
+    }
+}
+
+static void ui_build_scene(ui_context_t *ctx) {
+    ui_scene_t *scene = &ctx->scene;
+    ui_scene_clear(scene);
+    ui_scene_add_rect(scene, 0, 0, ILI9488_WIDTH, ILI9488_HEIGHT, ctx->background_color);
+    ui_scene_add_text(scene, UI_PADDING, UI_PADDING, "NOW PLAYING", UI_TEXT_FONT, ctx->accent_color);
+    ui_scene_add_text(scene, UI_PADDING, UI_TRACK_Y, ctx->track_name, UI_TEXT_FONT, ui_color(200, 200, 200));
+    // Placeholder for the art area; only visible when there is no cover or
+    // around one smaller than the box.
+    ui_rect_t art = ui_art_rect();
+    ui_scene_add_rect(scene, art.x, art.y, art.width, art.height, ui_color(30, 30, 30));
+    ui_build_volume_bar(ctx, scene);
+    ui_build_progress_bar(ctx, scene);
+    ui_build_play_pause_icon(ctx, scene);
+    ui_rect_t spectrum = ui_spectrum_rect();
+    ui_scene_add_bars(scene, spectrum.x, spectrum.y, spectrum.height, ctx->spectrum.heights, UI_SPECTRUM_BANDS,
+                      UI_SPECTRUM_BAR_WIDTH, UI_SPECTRUM_GAP, ctx->accent_color);
+}
+
+static uint16_t ui_browser_slot_y(size_t index) {
+    return UI_BROWSER_HEADER + (index % UI_BROWSER_ROWS) * UI_BROWSER_ROW_HEIGHT;
+}
+
+static ui_rect_t ui_browser_marker_rect(size_t index) {
+    return (ui_rect_t) {4, ui_browser_slot_y(index) + 4, 6, UI_BROWSER_ROW_HEIGHT - 8};
+}
+
+static bool ui_browser_visible(const ui_browser_t *browser, size_t index) {
+    return index >= browser->shown_first && index < browser->shown_first + UI_BROWSER_ROWS;
+}
+
+static void ui_browser_build_row(ui_context_t *ctx, ui_scene_t *scene, size_t index) {
+    const ui_browser_t *browser = &ctx->browser;
+    if (index >= browser->count) {
+        return;
+    }
+    uint16_t y = ui_browser_slot_y(index);
+    if (index == browser->selected) {
+        ui_rect_t marker = ui_browser_marker_rect(index);
+        ui_scene_add_round_rect(scene, marker.x, marker.y, marker.width, marker.height, marker.width / 2, ctx->accent_color);
+    }
+    ui_scene_add_text(scene, UI_PADDING + 4, y + (UI_BROWSER_ROW_HEIGHT - UI_TEXT_FONT->line_height) / 2,
+                      browser->names[index], UI_TEXT_FONT, ui_color(200, 200, 200));
+}
+
+static void ui_browser_render_row(ui_context_t *ctx, size_t index, const ui_rect_t *part) {
+    ui_scene_t *scene = &ctx->scene;
+    ui_rect_t row = {0, ui_browser_slot_y(index), ILI9488_WIDTH, UI_BROWSER_ROW_HEIGHT};
+    ui_scene_clear(scene);
+    ui_scene_add_rect(scene, row.x, row.y, row.width, row.height, ctx->background_color);
+    ui_browser_build_row(ctx, scene, index);
+    if (ui_band_render(&ctx->renderer, scene, part ? part : &row) != ESP_OK) {
+        ESP_LOGW(TAG, "Browser row render failed");
+    }
+}
+
+static void ui_browser_paint(ui_context_t *ctx) {
+    ui_browser_t *browser = &ctx->browser;
+    ui_scene_t *scene = &ctx->scene;
+    ili9488_set_scroll_area(ctx->display, UI_BROWSER_HEADER, ILI9488_HEIGHT - UI_BROWSER_HEADER - UI_BROWSER_ROWS * UI_BROWSER_ROW_HEIGHT);
+    ili9488_set_scroll_start(ctx->display, ui_browser_slot_y(browser->first));
+    browser->scrolled = true;
+    browser->shown_first = browser->first;
+    browser->shown_selected = browser->selected;
+
+    ui_scene_clear(scene);
+    ui_scene_add_rect(scene, 0, 0, ILI9488_WIDTH, ILI9488_HEIGHT, ctx->background_color);
+    ui_scene_add_text(scene, UI_PADDING, (UI_BROWSER_HEADER - UI_TEXT_FONT->line_height) / 2, "TRACKS", UI_TEXT_FONT, ctx->accent_color);
+    ui_scene_add_rect(scene, 0, UI_BROWSER_HEADER - 2, ILI9488_WIDTH, 2, ui_color(30, 30, 30));
+    for (size_t i = browser->first; i < browser->first + UI_BROWSER_ROWS; ++i) {
+        ui_browser_build_row(ctx, scene, i);
+    }
+    ui_rect_t screen = {0, 0, ILI9488_WIDTH, ILI9488_HEIGHT};
+    if (ui_band_render(&ctx->renderer, scene, &screen) != ESP_OK) {
+        ESP_LOGW(TAG, "Browser render failed");
+    }
+}
+
+static bool ui_browser_flush(ui_context_t *ctx) {
+    ui_browser_t *browser = &ctx->browser;
+    size_t distance = browser->first > browser->shown_first ? browser->first - browser->shown_first : browser->shown_first - browser->first;
+    if (browser->repaint || distance >= UI_BROWSER_ROWS) {
+        browser->repaint = false;
+        ui_browser_paint(ctx);
+        return true;
+    }
+    bool drew = false;
+    size_t old_selected = browser->shown_selected;
+    browser->shown_selected = browser->selected;
+    // One row per step: move the scroll start onto the next slot, then send
+    // the row that just came into view.
+    while (browser->shown_first != browser->first) {
+        size_t exposed;
+        if (browser->first > browser->shown_first) {
+            browser->shown_first++;
+            exposed = browser->shown_first + UI_BROWSER_ROWS - 1;
+        } else {
+            exposed = --browser->shown_first;
+        }
+        ili9488_set_scroll_start(ctx->display, ui_browser_slot_y(browser->shown_first));
+        ui_browser_render_row(ctx, exposed, NULL);
+        drew = true;
+    }
+    if (old_selected != browser->selected) {
+        if (ui_browser_visible(browser, old_selected)) {
+            ui_rect_t marker = ui_browser_marker_rect(old_selected);
+            ui_browser_render_row(ctx, old_selected, &marker);
         }
-        ui_draw_char(ctx, cursor_x, y, *p, scale, fg, bg);
-        cursor_x += (UI_FONT_WIDTH + 1) * scale;
+        ui_rect_t marker = ui_browser_marker_rect(browser->selected);
+        ui_browser_render_row(ctx, browser->selected, &marker);
+        drew = true;
     }
+    return drew;
 }
 
-static void ui_draw_volume_bar(ui_context_t *ctx) {
-    int x = UI_PADDING;
-    int y = ILI9488_HEIGHT - UI_PADDING - UI_VOLUME_BAR_HEIGHT;
-    uint16_t border_color = ctx->accent_color;
-    uint16_t bar_bg = ui_color(30, 30, 30);
-    ili9488_fill_color(ctx->display, x - 2, y - 2, UI_VOLUME_BAR_WIDTH + 4, UI_VOLUME_BAR_HEIGHT + 4, border_color);
-    ili9488_fill_color(ctx->display, x, y, UI_VOLUME_BAR_WIDTH, UI_VOLUME_BAR_HEIGHT, bar_bg);
-    int filled = (ctx->volume_percent * UI_VOLUME_BAR_WIDTH) / 100;
-    if (filled > 0) {
-        ili9488_fill_color(ctx->display, x, y, filled, UI_VOLUME_BAR_HEIGHT, ctx->accent_color);
+typedef struct {
+    ui_context_t *ctx;
+    FILE *file;
+    ui_rect_t box;
+    ui_rect_t image; // scaled image centred on the box; may overhang it
+    ui_art_cache_writer_t writer;
+} ui_art_decode_t;
+
+static int ui_art_read(void *user_data, uint8_t *buffer, size_t len) {
+    ui_art_decode_t *art = user_data;
+    size_t got = fread(buffer, 1, len, art->file);
+    return got == 0 && ferror(art->file) ? -1 : (int)got;
+}
+
+static uint16_t *ui_art_strip_begin(void *user_data, uint16_t y, uint16_t rows) {
+    ui_art_decode_t *art = user_data;
+    uint16_t *pixels;
+    if ((int32_t)art->image.width * rows > UI_BAND_PIXELS || ui_band_acquire(&art->ctx->renderer, &pixels) != ESP_OK) {
+        return NULL;
     }
+    return pixels;
 }
 
-static void ui_draw_play_pause_icon(ui_context_t *ctx) {
-    int x = ILI9488_WIDTH - UI_PADDING - UI_PLAY_ICON_SIZE;
-    int y = ILI9488_HEIGHT - UI_PADDING - UI_PLAY_ICON_SIZE - UI_VOLUME_BAR_HEIGHT - 12;
-    uint16_t bg = ctx->background_color;
-    uint16_t fg = ctx->accent_color;
-    uint16_t icon[UI_PLAY_ICON_SIZE * UI_PLAY_ICON_SIZE];
-    for (int i = 0; i < UI_PLAY_ICON_SIZE * UI_PLAY_ICON_SIZE; ++i) {
-        icon[i] = bg;
+static esp_err_t ui_art_strip_end(void *user_data, uint16_t y, uint16_t rows) {
+    ui_art_decode_t *art = user_data;
+    ui_rect_t strip = {art->image.x, art->image.y + y, art->image.width, rows};
+    ui_rect_t shown;
+    if (!ui_rect_intersect(&strip, &art->box, &shown)) {
+        return ESP_OK;
+    }
+    uint16_t *pixels;
+    ESP_RETURN_ON_ERROR(ui_band_acquire(&art->ctx->renderer, &pixels), TAG, "Art fence failed");
+    if (shown.width != strip.width || shown.y != strip.y) {
+        // Crop in place; every row moves towards the start of the buffer.
+        for (int16_t row = 0; row < shown.height; ++row) {
+            memmove(pixels + row * shown.width, pixels + (shown.y - strip.y + row) * strip.width + (shown.x - strip.x),
+                    shown.width * sizeof(uint16_t));
+        }
     }
+    ESP_RETURN_ON_ERROR(ui_band_submit(&art->ctx->renderer, &shown), TAG, "Art blit failed");
+    // The cache gets exactly what went to the panel, cropped rows and all.
+    ui_art_cache_write(&art->writer, pixels, (size_t)shown.width * shown.height);
+    return ESP_OK;
+}
 
-    if (ctx->is_playing) {
-        for (int row = 8; row < UI_PLAY_ICON_SIZE - 8; ++row) {
-            for (int col = 10; col < 18; ++col) {
-                icon[row * UI_PLAY_ICON_SIZE + col] = fg;
-            }
-            for (int col = 24; col < 32; ++col) {
-                icon[row * UI_PLAY_ICON_SIZE + col] = fg;
-            }
+static void ui_render_scene_around(ui_context_t *ctx, const ui_rect_t *region, const ui_rect_t *hole) {
+    ui_rect_t parts[4];
+    size_t count = ui_rect_subtract(region, hole, parts);
+    for (size_t i = 0; i < count; ++i) {
+        if (ui_band_render(&ctx->renderer, &ctx->scene, &parts[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "Band render failed");
         }
-    } else {
-        for (int row = 8; row < UI_PLAY_ICON_SIZE - 8; ++row) {
-            int width = (row - 8) * (UI_PLAY_ICON_SIZE - 16) / (UI_PLAY_ICON_SIZE - 16);
-            for (int col = 8; col < 8 + width; ++col) {
-                icon[row * UI_PLAY_ICON_SIZE + col] = fg;
-            }
+    }
+}
+
+static esp_err_t ui_art_decode(ui_context_t *ctx, FILE *file) {
+    ui_art_decode_t art = {.ctx = ctx, .file = file, .box = ui_art_rect()};
+    jpeg_decoder_config_t config = {
+        .read = ui_art_read,
+        .strip_begin = ui_art_strip_begin,
+        .strip_end = ui_art_strip_end,
+        .user_data = &art,
+    };
+    jpeg_decoder_t *decoder;
+    ESP_RETURN_ON_ERROR(jpeg_decoder_create(&decoder, &config), TAG, "Art decoder create failed");
+    jpeg_info_t info;
+    esp_err_t ret = jpeg_decoder_read_header(decoder, &info);
+    if (ret == ESP_OK) {
+        jpeg_scale_t scale = jpeg_pick_scale(&info, art.box.width, art.box.height);
+        art.image.width = jpeg_scaled_size(info.width, scale);
+        art.image.height = jpeg_scaled_size(info.height, scale);
+        art.image.x = art.box.x + (art.box.width - art.image.width) / 2;
+        art.image.y = art.box.y + (art.box.height - art.image.height) / 2;
+        // The letterbox goes out first so the decode only ever writes
+        // pixels the scene does not.
+        ui_render_scene_around(ctx, &art.box, &art.image);
+        ui_rect_t shown;
+        ui_rect_intersect(&art.image, &art.box, &shown);
+        bool caching = ui_art_cache_enabled(&ctx->art_cache) &&
+                       ui_art_cache_write_begin(&ctx->art_cache, ctx->art_path, shown.width, shown.height, &art.writer) == ESP_OK;
+        ret = jpeg_decoder_decode(decoder, scale);
+        if (caching && ui_art_cache_write_end(&ctx->art_cache, &art.writer, ret == ESP_OK) != ESP_OK && ret == ESP_OK) {
+            ESP_LOGW(TAG, "Could not cache %s", ctx->art_path);
+        }
+        if (ret == ESP_OK) {
+            jpeg_decoder_stats_t stats;
+            jpeg_decoder_get_stats(decoder, &stats);
+            ESP_LOGI(TAG, "Album art %ux%u at 1/%u: %lu us, %u bytes decoder, %u bytes largest strip", info.width, info.height,
+                     1u << scale, (unsigned long)stats.decode_us, (unsigned)stats.context_bytes, (unsigned)stats.strip_bytes);
+        }
+    }
+    jpeg_decoder_destroy(decoder);
+    return ret;
+}
+
+// Cache entries are already cropped to the box and in panel order, so each
+// band buffer is filled by one read and handed straight to the panel.
+static esp_err_t ui_art_stream_cached(ui_context_t *ctx, FILE *file, uint16_t width, uint16_t height) {
+    ui_rect_t box = ui_art_rect();
+    ESP_RETURN_ON_FALSE(width <= box.width && height <= box.height, ESP_ERR_INVALID_SIZE, TAG, "Cached art %ux%u too big", width, height);
+    ui_rect_t image = {box.x + (box.width - width) / 2, box.y + (box.height - height) / 2, width, height};
+    ui_render_scene_around(ctx, &box, &image);
+    int16_t rows_per_chunk = UI_BAND_PIXELS / width;
+    for (int16_t y = 0; y < image.height; y += rows_per_chunk) {
+        ui_rect_t chunk = {image.x, image.y + y, image.width, image.height - y < rows_per_chunk ? image.height - y : rows_per_chunk};
+        size_t count = (size_t)chunk.width * chunk.height;
+        uint16_t *pixels;
+        ESP_RETURN_ON_ERROR(ui_band_acquire(&ctx->renderer, &pixels), TAG, "Art fence failed");
+        ESP_RETURN_ON_FALSE(fread(pixels, sizeof(uint16_t), count, file) == count, ESP_ERR_INVALID_SIZE, TAG, "Cached art truncated");
+        ESP_RETURN_ON_ERROR(ui_band_submit(&ctx->renderer, &chunk), TAG, "Art blit failed");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ui_art_show(ui_context_t *ctx) {
+    uint16_t width, height;
+    FILE *file = ui_art_cache_open(&ctx->art_cache, ctx->art_path, &width, &height);
+    if (file) {
+        esp_err_t ret = ui_art_stream_cached(ctx, file, width, height);
+        fclose(file);
+        if (ret == ESP_OK) {
+            return ESP_OK;
+        }
+        // Fall through and decode again, which also rewrites the entry.
+    }
+    file = fopen(ctx->art_path, "rb");
+    if (!file) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = ui_art_decode(ctx, file);
+    fclose(file);
+    return ret;
+}
+
+static void ui_render_art(ui_context_t *ctx) {
+    if (ctx->art_path[0]) {
+        int64_t start_us = esp_timer_get_time();
+        uint32_t hits = ctx->art_cache.stats.hits;
+        esp_err_t ret = ui_art_show(ctx);
+        if (ret == ESP_OK) {
+            const ui_art_cache_stats_t *stats = &ctx->art_cache.stats;
+            ESP_LOGI(TAG, "Album art %s in %lu us (cache: %lu hits, %lu misses, %lu evictions, %lu bytes)",
+                     stats->hits != hits ? "streamed" : "decoded", (unsigned long)(esp_timer_get_time() - start_us),
+                     (unsigned long)stats->hits, (unsigned long)stats->misses, (unsigned long)stats->evictions, (unsigned long)stats->bytes);
+            return;
         }
+        // Forget the file so later repaints do not retry it.
+        ESP_LOGW(TAG, "Album art %s: %s", ctx->art_path, esp_err_to_name(ret));
+        ctx->art_path[0] = '\0';
     }
+    ui_rect_t box = ui_art_rect();
+    if (ui_band_render(&ctx->renderer, &ctx->scene, &box) != ESP_OK) {
+        ESP_LOGW(TAG, "Art placeholder render failed");
+    }
+}
 
-    ili9488_draw_rgb565_bitmap(ctx->display, x, y, UI_PLAY_ICON_SIZE, UI_PLAY_ICON_SIZE, icon);
+// Moves the pending bar heights on screen and returns the rect each changed
+// bar needs repainted.
+static size_t ui_spectrum_apply(ui_context_t *ctx, ui_rect_t *deltas) {
+    ui_spectrum_t *spectrum = &ctx->spectrum;
+    if (!spectrum->dirty) {
+        return 0;
+    }
+    spectrum->dirty = false;
+    ui_rect_t area = ui_spectrum_rect();
+    int16_t bottom = area.y + area.height;
+    size_t count = 0;
+    for (size_t i = 0; i < UI_SPECTRUM_BANDS; ++i) {
+        uint8_t from = spectrum->heights[i];
+        uint8_t to = spectrum->pending[i];
+        if (from == to) {
+            continue;
+        }
+        spectrum->heights[i] = to;
+        int16_t x = area.x + i * (UI_SPECTRUM_BAR_WIDTH + UI_SPECTRUM_GAP);
+        int16_t top = bottom - (from > to ? from : to);
+        deltas[count++] = (ui_rect_t) {x, top, UI_SPECTRUM_BAR_WIDTH, from > to ? from - to : to - from};
+    }
+    return count;
+}
+
+static void ui_flush_spectrum(ui_context_t *ctx, const ui_rect_t *deltas, size_t count) {
+    int64_t start_us = esp_timer_get_time();
+    uint32_t pixels = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bool covered = false;
+        for (size_t j = 0; j < ctx->damage_count && !covered; ++j) {
+            ui_rect_t inside;
+            covered = ui_rect_intersect(&deltas[i], &ctx->damage[j], &inside) && ui_rect_area(&inside) == ui_rect_area(&deltas[i]);
+        }
+        if (covered) {
+            continue;
+        }
+        if (ui_band_render(&ctx->renderer, &ctx->scene, &deltas[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "Spectrum render failed");
+        }
+        pixels += ui_rect_area(&deltas[i]);
+    }
+    ctx->stats.spectrum_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ctx->stats.spectrum_px = pixels;
 }
 
-static void ui_draw_labels(ui_context_t *ctx) {
-    ui_draw_text(ctx, UI_PADDING, UI_PADDING, "NOW PLAYING", 2, ctx->accent_color, ctx->background_color);
-    ui_draw_text(ctx, UI_PADDING, UI_PADDING + 40, ctx->track_name, 2, ui_color(200, 200, 200), ctx->background_color);
+static bool ui_flush_damage(ui_context_t *ctx) {
+    for (size_t i = 0; i < UI_WIDGET_COUNT; ++i) {
+        if (ctx->widgets[i].dirty) {
+            ui_damage_add(ctx, ctx->widgets[i].damage);
+            ctx->widgets[i].dirty = false;
+        }
+    }
+    ui_rect_t deltas[UI_SPECTRUM_BANDS];
+    size_t delta_count = ui_spectrum_apply(ctx, deltas);
+    if (ctx->damage_count == 0 && delta_count == 0) {
+        return false;
+    }
+    if (ctx->browser.scrolled) {
+        ili9488_set_scroll_area(ctx->display, 0, 0);
+        ili9488_set_scroll_start(ctx->display, 0);
+        ctx->browser.scrolled = false;
+    }
+    ui_build_scene(ctx);
+    // The art area is never rasterised from the scene when a cover is set;
+    // any damage touching it repaints the whole box from the file.
+    ui_rect_t art = ui_art_rect();
+    bool art_damaged = false;
+    uint32_t pixels = 0;
+    for (size_t i = 0; i < ctx->damage_count; ++i) {
+        ui_render_scene_around(ctx, &ctx->damage[i], &art);
+        pixels += ui_rect_area(&ctx->damage[i]);
+        art_damaged |= ui_rect_intersect(&ctx->damage[i], &art, NULL);
+    }
+    if (art_damaged) {
+        ui_render_art(ctx);
+    }
+    ui_flush_spectrum(ctx, deltas, delta_count);
+    ESP_LOGD(TAG, "Flushed %u rects, %lu px", (unsigned)ctx->damage_count, (unsigned long)pixels);
+    ctx->damage_count = 0;
+    return true;
+}
+
+void ui_flush(ui_context_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+    int64_t start_us = esp_timer_get_time();
+    bool drew = ctx->screen == UI_SCREEN_TRACKS ? ui_browser_flush(ctx) : ui_flush_damage(ctx);
+    if (!drew) {
+        return;
+    }
+    ili9488_wait_idle(ctx->display);
+    uint32_t frame_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    ui_frame_stats_t *stats = &ctx->stats;
+    stats->frames++;
+    if (stats->pending_updates > 1) {
+        stats->coalesced += stats->pending_updates - 1;
+    }
+    stats->pending_updates = 0;
+    stats->last_frame_us = frame_us;
+    if (frame_us > stats->max_frame_us) {
+        stats->max_frame_us = frame_us;
+    }
+}
+
+bool ui_needs_flush(const ui_context_t *ctx) {
+    if (!ctx) {
+        return false;
+    }
+    if (ctx->screen == UI_SCREEN_TRACKS) {
+        const ui_browser_t *browser = &ctx->browser;
+        return browser->repaint || browser->shown_first != browser->first || browser->shown_selected != browser->selected;
+    }
+    if (ctx->damage_count > 0 || ctx->spectrum.dirty) {
+        return true;
+    }
+    for (size_t i = 0; i < UI_WIDGET_COUNT; ++i) {
+        if (ctx->widgets[i].dirty) {
+            return true;
+        }
+    }
+    return false;
 }
 
 esp_err_t ui_init(ui_context_t *ctx, const ui_config_t *config) {
@@ -176,30 +593,67 @@ esp_err_t ui_init(ui_context_t *ctx, const ui_config_t *config) {
     ctx->accent_color = config->accent_color ? config->accent_color : ui_color(0, 180, 255);
     ctx->volume_percent = 50;
     ctx->is_playing = false;
-    strcpy(ctx->track_name, "TRACK NAME");
-    return ESP_OK;
+    strcpy(ctx->track_name, "Track name");
+    ui_art_cache_init(&ctx->art_cache, config->art_cache_dir, config->art_cache_max_bytes);
+    if (ui_assets_init(&ctx->assets, UI_ASSET_PARTITION) == ESP_OK) {
+        ctx->play_icon = ui_asset_find(&ctx->assets, "play");
+        ctx->pause_icon = ui_asset_find(&ctx->assets, "pause");
+        ctx->splash = ui_asset_find(&ctx->assets, "splash");
+    }
+
+    ctx->widgets[UI_WIDGET_TITLE].bounds = ui_title_rect();
+    ctx->widgets[UI_WIDGET_TRACK].bounds = ui_track_rect();
+    ctx->widgets[UI_WIDGET_VOLUME].bounds = ui_volume_bar_rect();
+    ctx->widgets[UI_WIDGET_PLAY_STATE].bounds = ui_play_icon_rect();
+    ctx->widgets[UI_WIDGET_PROGRESS].bounds = ui_progress_rect();
+    ctx->widgets[UI_WIDGET_ART].bounds = ui_art_rect();
+
+    return ui_band_init(&ctx->renderer, ctx->display);
+}
+
+void ui_draw_splash(ui_context_t *ctx) {
+    if (!ctx || !ctx->display) {
+        return;
+    }
+    ui_scene_t *scene = &ctx->scene;
+    ui_scene_clear(scene);
+    ui_scene_add_rect(scene, 0, 0, ILI9488_WIDTH, ILI9488_HEIGHT, ctx->background_color);
+    if (ctx->splash) {
+        ui_scene_add_image(scene, (ILI9488_WIDTH - ctx->splash->width) / 2, (ILI9488_HEIGHT - ctx->splash->height) / 2, ctx->splash);
+    }
+    ui_rect_t screen = {0, 0, ILI9488_WIDTH, ILI9488_HEIGHT};
+    if (ui_band_render(&ctx->renderer, scene, &screen) != ESP_OK) {
+        ESP_LOGW(TAG, "Splash render failed");
+    }
+    ili9488_wait_idle(ctx->display);
 }
 
 void ui_draw_boot_screen(ui_context_t *ctx) {
     if (!ctx || !ctx->display) {
         return;
     }
-    ili9488_fill_color(ctx->display, 0, 0, ILI9488_WIDTH, ILI9488_HEIGHT, ctx->background_color);
-    ui_draw_labels(ctx);
-    ui_draw_volume_bar(ctx);
-    ui_draw_play_pause_icon(ctx);
+    for (size_t i = 0; i < UI_WIDGET_COUNT; ++i) {
+        ctx->widgets[i].dirty = false;
+    }
+    ctx->damage_count = 0;
+    ui_damage_add(ctx, (ui_rect_t) {0, 0, ILI9488_WIDTH, ILI9488_HEIGHT});
+    ctx->stats.pending_updates = 0;
+    ui_flush(ctx);
 }
 
 void ui_set_track(ui_context_t *ctx, const char *track) {
     if (!ctx || !track) {
         return;
     }
+    int16_t old_width = ui_font_text_width(UI_TEXT_FONT, ctx->track_name);
     strncpy(ctx->track_name, track, sizeof(ctx->track_name) - 1);
     ctx->track_name[sizeof(ctx->track_name) - 1] = '\0';
-    for (size_t i = 0; ctx->track_name[i]; ++i) {
-        ctx->track_name[i] = (char)toupper((int)ctx->track_name[i]);
-    }
-    ui_draw_labels(ctx);
+    ui_utf8_truncate(ctx->track_name, strlen(track));
+    int16_t new_width = ui_font_text_width(UI_TEXT_FONT, ctx->track_name);
+    ui_rect_t text = ui_track_rect();
+    text.width = old_width > new_width ? old_width : new_width;
+    ui_widget_invalidate(ctx, UI_WIDGET_TRACK, &text);
+    ctx->stats.pending_updates++;
 }
 
 void ui_set_volume(ui_context_t *ctx, uint8_t volume_percent) {
@@ -209,21 +663,161 @@ void ui_set_volume(ui_context_t *ctx, uint8_t volume_percent) {
     if (volume_percent > 100) {
         volume_percent = 100;
     }
+    int16_t old_fill = ui_volume_fill_width(ctx->volume_percent);
+    int16_t new_fill = ui_volume_fill_width(volume_percent);
     ctx->volume_percent = volume_percent;
-    ui_draw_volume_bar(ctx);
+    if (old_fill != new_fill) {
+        // Only the slice between the old and new fill edge changes, plus the
+        // rounded end behind it. A fill shorter than the bar is tall has its
+        // radius clamped, which reshapes the left end as well.
+        ui_rect_t bar = ui_volume_bar_rect();
+        int16_t from = old_fill < new_fill ? old_fill : new_fill;
+        int16_t to = old_fill < new_fill ? new_fill : old_fill;
+        from = from < UI_VOLUME_BAR_HEIGHT ? 0 : from - UI_VOLUME_RADIUS;
+        ui_rect_t slice = {bar.x + 2 + from, bar.y + 2, to - from, UI_VOLUME_BAR_HEIGHT};
+        ui_widget_invalidate(ctx, UI_WIDGET_VOLUME, &slice);
+        ctx->stats.pending_updates++;
+    }
 }
 
 void ui_set_play_state(ui_context_t *ctx, bool playing) {
     if (!ctx) {
         return;
     }
-    ctx->is_playing = playing;
-    ui_draw_play_pause_icon(ctx);
+    if (ctx->is_playing != playing) {
+        ctx->is_playing = playing;
+        ui_widget_invalidate(ctx, UI_WIDGET_PLAY_STATE, NULL);
+        ctx->stats.pending_updates++;
+    }
+}
+
+void ui_set_progress(ui_context_t *ctx, uint32_t position_ms, uint32_t duration_ms) {
+    if (!ctx) {
+        return;
+    }
+    int16_t old_fill = ui_progress_fill_width(ctx->position_ms, ctx->duration_ms);
+    int16_t new_fill = ui_progress_fill_width(position_ms, duration_ms);
+    ctx->position_ms = position_ms;
+    ctx->duration_ms = duration_ms;
+    if (old_fill != new_fill) {
+        // Same slicing as the volume bar.
+        ui_rect_t bar = ui_progress_rect();
+        int16_t from = old_fill < new_fill ? old_fill : new_fill;
+        int16_t to = old_fill < new_fill ? new_fill : old_fill;
+        from = from < UI_PROGRESS_HEIGHT ? 0 : from - UI_PROGRESS_RADIUS;
+        ui_rect_t slice = {bar.x + from, bar.y, to - from, UI_PROGRESS_HEIGHT};
+        ui_widget_invalidate(ctx, UI_WIDGET_PROGRESS, &slice);
+        ctx->stats.pending_updates++;
+    }
+}
+
+void ui_set_scrubbing(ui_context_t *ctx, bool scrubbing) {
+    if (!ctx) {
+        return;
+    }
+    if (ctx->scrubbing != scrubbing) {
+        ctx->scrubbing = scrubbing;
+        ui_widget_invalidate(ctx, UI_WIDGET_PROGRESS, NULL);
+        ctx->stats.pending_updates++;
+    }
+}
+
+bool ui_progress_hit(const ui_context_t *ctx, uint16_t x, uint16_t y) {
+    if (!ctx || ctx->screen != UI_SCREEN_NOW_PLAYING) {
+        return false;
+    }
+    // The bar is thin; accept anything between the art and the play icon.
+    ui_rect_t bar = ui_progress_rect();
+    int16_t top = UI_ART_Y + UI_ART_SIZE;
+    int16_t bottom = ui_play_icon_rect().y;
+    return x >= bar.x && x < bar.x + bar.width && y >= top && y < bottom;
+}
+
+void ui_set_album_art(ui_context_t *ctx, const char *path) {
+    if (!ctx) {
+        return;
+    }
+    if (!path) {
+        path = "";
+    }
+    if (strlen(path) >= sizeof(ctx->art_path)) {
+        ESP_LOGW(TAG, "Album art path too long: %s", path);
+        path = "";
+    }
+    if (strcmp(ctx->art_path, path) == 0) {
+        return;
+    }
+    strcpy(ctx->art_path, path);
+    ui_widget_invalidate(ctx, UI_WIDGET_ART, NULL);
+    ctx->stats.pending_updates++;
+}
+
+void ui_set_spectrum(ui_context_t *ctx, const uint8_t *levels, size_t count) {
+    if (!ctx || !levels) {
+        return;
+    }
+    ui_spectrum_t *spectrum = &ctx->spectrum;
+    const int16_t height = ui_spectrum_rect().height;
+    for (size_t i = 0; i < UI_SPECTRUM_BANDS; ++i) {
+        spectrum->pending[i] = i < count ? (uint8_t)((levels[i] * height + 127) / 255) : 0;
+        spectrum->dirty |= spectrum->pending[i] != spectrum->heights[i];
+    }
 }
 
 void ui_redraw(ui_context_t *ctx) {
     if (!ctx) {
         return;
     }
+    if (ctx->screen == UI_SCREEN_TRACKS) {
+        ctx->browser.repaint = true;
+        ui_flush(ctx);
+        return;
+    }
     ui_draw_boot_screen(ctx);
 }
+
+void ui_browser_open(ui_context_t *ctx, const char *const *names, size_t count, size_t selected) {
+    if (!ctx || (!names && count)) {
+        return;
+    }
+    ui_browser_t *browser = &ctx->browser;
+    browser->names = names;
+    browser->count = count;
+    browser->selected = count && selected >= count ? count - 1 : selected;
+    browser->first = browser->selected >= UI_BROWSER_ROWS ? browser->selected - UI_BROWSER_ROWS + 1 : 0;
+    browser->repaint = true;
+    ctx->screen = UI_SCREEN_TRACKS;
+    ctx->stats.pending_updates++;
+}
+
+void ui_browser_close(ui_context_t *ctx) {
+    if (!ctx || ctx->screen != UI_SCREEN_TRACKS) {
+        return;
+    }
+    ctx->screen = UI_SCREEN_NOW_PLAYING;
+    ctx->browser.names = NULL;
+    ctx->browser.count = 0;
+    // The scroll mapping is reset by the flush that repaints this.
+    ui_damage_add(ctx, (ui_rect_t) {0, 0, ILI9488_WIDTH, ILI9488_HEIGHT});
+    ctx->stats.pending_updates++;
+}
+
+void ui_browser_move(ui_context_t *ctx, int delta) {
+    if (!ctx || ctx->screen != UI_SCREEN_TRACKS || ctx->browser.count == 0) {
+        return;
+    }
+    ui_browser_t *browser = &ctx->browser;
+    int32_t target = (int32_t)browser->selected + delta;
+    if (target < 0) {
+        target = 0;
+    } else if (target >= (int32_t)browser->count) {
+        target = (int32_t)browser->count - 1;
+    }
+    browser->selected = (size_t)target;
+    if (browser->selected < browser->first) {
+        browser->first = browser->selected;
+    } else if (browser->selected >= browser->first + UI_BROWSER_ROWS) {
+        browser->first = browser->selected - UI_BROWSER_ROWS + 1;
+    }
+    ctx->stats.pending_updates++;
+}
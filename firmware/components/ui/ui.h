@@ -5,25 +5,140 @@
 
 #include "esp_err.h"
 #include "ili9488.h"
+#include "ui_art_cache.h"
+#include "ui_asset.h"
+#include "ui_band.h"
+#include "ui_font.h"
 
 typedef struct {
     ili9488_t *display;
     uint16_t background_color;
     uint16_t accent_color;
+    const char *art_cache_dir; // NULL decodes album art on every repaint
+    uint32_t art_cache_max_bytes;
 } ui_config_t;
 
+#define UI_MAX_DAMAGE_RECTS 8
+#define UI_SPECTRUM_BANDS 24
+
+typedef enum {
+    UI_WIDGET_TITLE = 0,
+    UI_WIDGET_TRACK,
+    UI_WIDGET_VOLUME,
+    UI_WIDGET_PLAY_STATE,
+    UI_WIDGET_PROGRESS,
+    UI_WIDGET_ART,
+    UI_WIDGET_COUNT,
+} ui_widget_id_t;
+
+typedef struct {
+    ui_rect_t bounds;
+    ui_rect_t damage;
+    bool dirty;
+} ui_widget_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t pending_updates;
+    uint32_t coalesced;
+    uint32_t last_frame_us;
+    uint32_t max_frame_us;
+    uint32_t spectrum_us; // rasterising and queueing the last bar deltas
+    uint32_t spectrum_px;
+} ui_frame_stats_t;
+
+typedef enum {
+    UI_SCREEN_NOW_PLAYING = 0,
+    UI_SCREEN_TRACKS,
+} ui_screen_t;
+
+// List item i always lives in the same frame memory slot (i modulo the
+// visible row count), so scrolling is a scroll-start change plus one row.
+typedef struct {
+    const char *const *names;
+    size_t count;
+    size_t selected;
+    size_t first;
+    size_t shown_selected;
+    size_t shown_first;
+    bool repaint;
+    bool scrolled;
+} ui_browser_t;
+
+// Bars are repainted one delta rect each, between the old and new top, so
+// a frame only sends the pixels that changed.
+typedef struct {
+    uint8_t heights[UI_SPECTRUM_BANDS]; // what the panel shows
+    uint8_t pending[UI_SPECTRUM_BANDS];
+    bool dirty;
+} ui_spectrum_t;
+
 typedef struct {
     ili9488_t *display;
     uint16_t background_color;
     uint16_t accent_color;
+    ui_screen_t screen;
     uint8_t volume_percent;
     bool is_playing;
+    uint32_t position_ms;
+    uint32_t duration_ms;
+    bool scrubbing;
     char track_name[64];
+    char art_path[128];
+    ui_art_cache_t art_cache;
+    ui_assets_t assets;
+    const ui_asset_t *play_icon;
+    const ui_asset_t *pause_icon;
+    const ui_asset_t *splash;
+    ui_band_renderer_t renderer;
+    ui_scene_t scene;
+    ui_widget_t widgets[UI_WIDGET_COUNT];
+    ui_rect_t damage[UI_MAX_DAMAGE_RECTS];
+    size_t damage_count;
+    ui_browser_t browser;
+    ui_spectrum_t spectrum;
+    ui_frame_stats_t stats;
 } ui_context_t;
 
 esp_err_t ui_init(ui_context_t *ctx, const ui_config_t *config);
+// Logo on a blank screen, shown while storage and audio come up.
+void ui_draw_splash(ui_context_t *ctx);
 void ui_draw_boot_screen(ui_context_t *ctx);
+// Setters only update state and mark damage; nothing reaches the panel
+// until the next ui_flush(), so a burst of updates costs one frame.
 void ui_set_track(ui_context_t *ctx, const char *track);
 void ui_set_volume(ui_context_t *ctx, uint8_t volume_percent);
 void ui_set_play_state(ui_context_t *ctx, bool playing);
+// Track progress under the album art; empty while duration_ms is 0. Only
+// the slice between the old and new fill is repainted, so calling this
+// every frame costs nothing until the fill moves a pixel.
+void ui_set_progress(ui_context_t *ctx, uint32_t position_ms, uint32_t duration_ms);
+// Highlights the progress bar while the encoder scrubs instead of setting
+// the volume.
+void ui_set_scrubbing(ui_context_t *ctx, bool scrubbing);
+// True if a touch at x, y is on the progress bar or the gap around it.
+bool ui_progress_hit(const ui_context_t *ctx, uint16_t x, uint16_t y);
+// Baseline JPEG shown under the track name, or NULL for the placeholder. The
+// file is decoded straight into the band buffers the first time and streamed
+// from the art cache after that, so it must stay readable.
+void ui_set_album_art(ui_context_t *ctx, const char *path);
+// Levels are 0..255 per band; extra bands are ignored.
+void ui_set_spectrum(ui_context_t *ctx, const uint8_t *levels, size_t count);
 void ui_redraw(ui_context_t *ctx);
+// Track browser. names must stay valid until ui_browser_close(); moving the
+// selection past either edge scrolls the list one row at a time.
+void ui_browser_open(ui_context_t *ctx, const char *const *names, size_t count, size_t selected);
+void ui_browser_close(ui_context_t *ctx);
+void ui_browser_move(ui_context_t *ctx, int delta);
+// Repaints the merged damage of all dirty widgets, or the browser rows that
+// changed.
+void ui_flush(ui_context_t *ctx);
+bool ui_needs_flush(const ui_context_t *ctx);
+// Draws the title label both ways and logs the average time per string.
+void ui_benchmark_text(ui_context_t *ctx, uint32_t iterations);
+// Times the RGB666 expansion against a copy of one band, then full-screen
+// redraws in each pixel format; the caller's format is restored afterwards.
+void ui_benchmark_pixel_formats(ui_context_t *ctx, uint32_t frames);
+// Blends one band with the old per-pixel path and both span kernels and logs
+// the cost per pixel.
+void ui_benchmark_blend(ui_context_t *ctx, uint32_t iterations);
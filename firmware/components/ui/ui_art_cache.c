@@ -0,0 +1,241 @@
+#include "ui_art_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esp_check.h"
+#include "esp_log.h"
+
+#define TAG "UI_ART_CACHE"
+#define UI_ART_CACHE_MAGIC 0x35363541 // "A565"
+#define UI_ART_CACHE_EXT ".565"
+
+// FNV-1a of the source path; the name only has to be short and stable, the
+// header decides whether the entry is still current.
+static void ui_art_cache_path(const ui_art_cache_t *cache, const char *source, const char *ext, char *out, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = source; *p; ++p) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    snprintf(out, len, "%s/%08lx%s", cache->dir, (unsigned long)hash, ext);
+}
+
+static bool ui_art_cache_read_header(FILE *file, ui_art_cache_header_t *header) {
+    return fread(header, sizeof(*header), 1, file) == 1 && header->magic == UI_ART_CACHE_MAGIC;
+}
+
+static bool ui_art_cache_has_ext(const struct dirent *entry, const char *ext) {
+    const char *dot = strrchr(entry->d_name, '.');
+    return dot && strcasecmp(dot, ext) == 0;
+}
+
+typedef struct {
+    char name[16]; // 8.3
+    uint32_t used;
+    uint32_t size;
+} ui_art_cache_entry_t;
+
+static int ui_art_cache_entry_compare(const void *a, const void *b) {
+    uint32_t x = ((const ui_art_cache_entry_t *)a)->used;
+    uint32_t y = ((const ui_art_cache_entry_t *)b)->used;
+    return x < y ? -1 : x > y;
+}
+
+// Totals the entries in one pass and, if list is set, returns them in a
+// heap array for the caller to free. Temporaries are only ever left by a
+// write cut short by power loss or a card pull, so the first scan after
+// boot removes them.
+static uint32_t ui_art_cache_scan(ui_art_cache_t *cache, bool remove_temporaries, ui_art_cache_entry_t **list, size_t *count) {
+    DIR *dir = opendir(cache->dir);
+    if (list) {
+        *list = NULL;
+        *count = 0;
+    }
+    if (!dir) {
+        return 0;
+    }
+    uint32_t total = 0;
+    size_t capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[sizeof(cache->dir) + sizeof(entry->d_name)];
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, entry->d_name);
+        if (remove_temporaries && ui_art_cache_has_ext(entry, ".tmp")) {
+            ESP_LOGI(TAG, "Removing unfinished %s", path);
+            unlink(path);
+            continue;
+        }
+        if (!ui_art_cache_has_ext(entry, UI_ART_CACHE_EXT)) {
+            continue;
+        }
+        struct stat st;
+        FILE *file = fopen(path, "rb");
+        ui_art_cache_header_t header;
+        bool valid = file && ui_art_cache_read_header(file, &header);
+        if (file) {
+            fclose(file);
+        }
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        total += st.st_size;
+        // Unreadable entries sort first so they are the first to go.
+        uint32_t used = valid ? header.last_used : 0;
+        if (valid && used >= cache->sequence) {
+            cache->sequence = used + 1;
+        }
+        if (!list || strlen(entry->d_name) >= sizeof((*list)->name)) {
+            continue;
+        }
+        if (*count == capacity) {
+            size_t grow = capacity ? capacity * 2 : 16;
+            ui_art_cache_entry_t *grown = realloc(*list, grow * sizeof(**list));
+            if (!grown) {
+                continue;
+            }
+            *list = grown;
+            capacity = grow;
+        }
+        ui_art_cache_entry_t *item = &(*list)[(*count)++];
+        strcpy(item->name, entry->d_name);
+        item->used = used;
+        item->size = (uint32_t)st.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+static bool ui_art_cache_prepare(ui_art_cache_t *cache) {
+    if (cache->ready) {
+        return true;
+    }
+    if (mkdir(cache->dir, 0755) != 0 && errno != EEXIST) {
+        ESP_LOGW(TAG, "Cannot create %s (errno %d), art is not cached", cache->dir, errno);
+        return false;
+    }
+    cache->stats.bytes = ui_art_cache_scan(cache, true, NULL, NULL);
+    cache->ready = true;
+    ESP_LOGI(TAG, "%s: %lu bytes cached, limit %lu", cache->dir, (unsigned long)cache->stats.bytes, (unsigned long)cache->max_bytes);
+    return true;
+}
+
+// One scan, then least recently used first until the total fits.
+static void ui_art_cache_evict(ui_art_cache_t *cache) {
+    ui_art_cache_entry_t *list;
+    size_t count;
+    cache->stats.bytes = ui_art_cache_scan(cache, false, &list, &count);
+    if (cache->stats.bytes > cache->max_bytes) {
+        qsort(list, count, sizeof(*list), ui_art_cache_entry_compare);
+        char path[64];
+        for (size_t i = 0; i < count && cache->stats.bytes > cache->max_bytes; ++i) {
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, list[i].name);
+            ESP_LOGD(TAG, "Evicting %s", path);
+            if (unlink(path) != 0) {
+                break;
+            }
+            cache->stats.bytes -= list[i].size;
+            cache->stats.evictions++;
+        }
+    }
+    free(list);
+}
+
+void ui_art_cache_init(ui_art_cache_t *cache, const char *dir, uint32_t max_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    if (!dir || max_bytes == 0 || strlen(dir) >= sizeof(cache->dir)) {
+        return;
+    }
+    strcpy(cache->dir, dir);
+    cache->max_bytes = max_bytes;
+}
+
+bool ui_art_cache_enabled(const ui_art_cache_t *cache) {
+    return cache && cache->dir[0] != '\0';
+}
+
+FILE *ui_art_cache_open(ui_art_cache_t *cache, const char *source, uint16_t *width, uint16_t *height) {
+    struct stat st;
+    if (!ui_art_cache_enabled(cache) || !ui_art_cache_prepare(cache) || stat(source, &st) != 0) {
+        return NULL;
+    }
+    char path[48];
+    ui_art_cache_path(cache, source, UI_ART_CACHE_EXT, path, sizeof(path));
+    FILE *file = fopen(path, "r+b");
+    ui_art_cache_header_t header;
+    if (!file || !ui_art_cache_read_header(file, &header) || header.source_size != (uint32_t)st.st_size ||
+        header.source_mtime != (uint32_t)st.st_mtime || header.width == 0 || header.height == 0) {
+        if (file) {
+            // Stale: the source changed since this entry was written.
+            fclose(file);
+            unlink(path);
+        }
+        cache->stats.misses++;
+        return NULL;
+    }
+    header.last_used = cache->sequence++;
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file) != 0) {
+        ESP_LOGW(TAG, "Could not update %s", path);
+    }
+    fseek(file, sizeof(header), SEEK_SET);
+    cache->stats.hits++;
+    *width = header.width;
+    *height = header.height;
+    return file;
+}
+
+esp_err_t ui_art_cache_write_begin(ui_art_cache_t *cache, const char *source, uint16_t width, uint16_t height, ui_art_cache_writer_t *writer) {
+    memset(writer, 0, sizeof(*writer));
+    struct stat st;
+    ESP_RETURN_ON_FALSE(ui_art_cache_enabled(cache) && ui_art_cache_prepare(cache), ESP_ERR_INVALID_STATE, TAG, "Cache unavailable");
+    ESP_RETURN_ON_FALSE(stat(source, &st) == 0, ESP_ERR_NOT_FOUND, TAG, "Source %s missing", source);
+    writer->header = (ui_art_cache_header_t) {
+        .magic = UI_ART_CACHE_MAGIC,
+        .source_size = (uint32_t)st.st_size,
+        .source_mtime = (uint32_t)st.st_mtime,
+        .last_used = cache->sequence++,
+        .width = width,
+        .height = height,
+    };
+    // Written under a temporary name so a torn write never looks valid.
+    ui_art_cache_path(cache, source, ".tmp", writer->path, sizeof(writer->path));
+    writer->file = fopen(writer->path, "wb");
+    ESP_RETURN_ON_FALSE(writer->file, ESP_FAIL, TAG, "Could not create %s", writer->path);
+    writer->failed = fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1;
+    return ESP_OK;
+}
+
+void ui_art_cache_write(ui_art_cache_writer_t *writer, const uint16_t *pixels, size_t count) {
+    if (writer->file && !writer->failed) {
+        writer->failed = fwrite(pixels, sizeof(uint16_t), count, writer->file) != count;
+    }
+}
+
+esp_err_t ui_art_cache_write_end(ui_art_cache_t *cache, ui_art_cache_writer_t *writer, bool commit) {
+    if (!writer->file) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    commit = commit && !writer->failed && ftell(writer->file) == (long)(sizeof(writer->header) + (size_t)writer->header.width * writer->header.height * sizeof(uint16_t));
+    commit = fclose(writer->file) == 0 && commit;
+    writer->file = NULL;
+    if (!commit) {
+        unlink(writer->path);
+        return ESP_FAIL;
+    }
+    char path[48];
+    strcpy(path, writer->path);
+    strcpy(strrchr(path, '.'), UI_ART_CACHE_EXT);
+    // FAT rename does not replace an existing file.
+    unlink(path);
+    if (rename(writer->path, path) != 0) {
+        unlink(writer->path);
+        return ESP_FAIL;
+    }
+    cache->stats.stores++;
+    ui_art_cache_evict(cache);
+    return ESP_OK;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+
+// Entries are raw panel-order RGB565 behind a fixed header, one file per
+// source, so a hit is streamed to the panel with no decode or conversion.
+typedef struct {
+    uint32_t magic;
+    uint32_t source_size;
+    uint32_t source_mtime;
+    uint32_t last_used; // cache-wide sequence number, lowest is evicted first
+    uint16_t width;
+    uint16_t height;
+} ui_art_cache_header_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t stores;
+    uint32_t evictions;
+    uint32_t bytes;
+} ui_art_cache_stats_t;
+
+typedef struct {
+    char dir[32];
+    uint32_t max_bytes;
+    uint32_t sequence;
+    bool ready;
+    ui_art_cache_stats_t stats;
+} ui_art_cache_t;
+
+typedef struct {
+    FILE *file;
+    char path[48];
+    ui_art_cache_header_t header;
+    bool failed;
+} ui_art_cache_writer_t;
+
+// dir is created on first use, so this may run before the card is mounted.
+// A NULL dir or zero max_bytes leaves the cache disabled.
+void ui_art_cache_init(ui_art_cache_t *cache, const char *dir, uint32_t max_bytes);
+bool ui_art_cache_enabled(const ui_art_cache_t *cache);
+// Opens the entry for source if it is still current, positioned at the first
+// pixel, and marks it most recently used.
+FILE *ui_art_cache_open(ui_art_cache_t *cache, const char *source, uint16_t *width, uint16_t *height);
+// Rows must be written top to bottom; the entry only becomes visible once
+// ui_art_cache_write_end() commits it.
+esp_err_t ui_art_cache_write_begin(ui_art_cache_t *cache, const char *source, uint16_t width, uint16_t height, ui_art_cache_writer_t *writer);
+void ui_art_cache_write(ui_art_cache_writer_t *writer, const uint16_t *pixels, size_t count);
+esp_err_t ui_art_cache_write_end(ui_art_cache_t *cache, ui_art_cache_writer_t *writer, bool commit);
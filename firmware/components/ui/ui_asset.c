@@ -0,0 +1,124 @@
+#include "ui_asset.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_log.h"
+
+#define TAG "UI_ASSET"
+#define UI_ASSET_MAGIC 0x31414955 // "UIA1"
+#define UI_ASSET_HEADER_SIZE 8
+
+#define UI_ASSET_PACKET_LITERAL 0
+#define UI_ASSET_PACKET_RUN 1
+#define UI_ASSET_PACKET_SKIP 2
+
+static const uint8_t *ui_asset_data(const ui_asset_t *asset) {
+    return (const uint8_t *)asset + asset->offset;
+}
+
+static bool ui_asset_valid(const ui_asset_t *asset, const uint8_t *end) {
+    const uint8_t *data = ui_asset_data(asset);
+    if (asset->offset % 4 != 0 || data > end || asset->size > (size_t)(end - data)) {
+        return false;
+    }
+    if (asset->encoding == UI_ASSET_RAW) {
+        return asset->size == (uint32_t)asset->width * asset->height * sizeof(uint16_t);
+    }
+    return asset->encoding == UI_ASSET_RLE && asset->size >= (uint32_t)asset->height * sizeof(uint32_t);
+}
+
+esp_err_t ui_assets_init(ui_assets_t *assets, const char *label) {
+    ESP_RETURN_ON_FALSE(assets && label, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    memset(assets, 0, sizeof(*assets));
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    ESP_RETURN_ON_FALSE(partition, ESP_ERR_NOT_FOUND, TAG, "No %s partition", label);
+
+    const void *base;
+    esp_partition_mmap_handle_t handle;
+    ESP_RETURN_ON_ERROR(esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &base, &handle), TAG, "mmap failed");
+    const uint8_t *bytes = base;
+    const uint8_t *end = bytes + partition->size;
+    uint32_t magic;
+    uint16_t count;
+    memcpy(&magic, bytes, sizeof(magic));
+    memcpy(&count, bytes + 4, sizeof(count));
+    esp_err_t ret = ESP_OK;
+    if (magic != UI_ASSET_MAGIC || UI_ASSET_HEADER_SIZE + (size_t)count * sizeof(ui_asset_t) > partition->size) {
+        ESP_LOGE(TAG, "%s partition holds no assets; flash it with idf.py flash", label);
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    const ui_asset_t *entries = (const ui_asset_t *)(bytes + UI_ASSET_HEADER_SIZE);
+    for (uint16_t i = 0; ret == ESP_OK && i < count; ++i) {
+        if (!ui_asset_valid(&entries[i], end)) {
+            ESP_LOGE(TAG, "Asset %u is corrupt", i);
+            ret = ESP_ERR_INVALID_SIZE;
+        }
+    }
+    if (ret != ESP_OK) {
+        esp_partition_munmap(handle);
+        return ret;
+    }
+    assets->base = bytes;
+    assets->entries = entries;
+    assets->count = count;
+    assets->handle = handle;
+    ESP_LOGI(TAG, "%u assets mapped from %s", count, label);
+    return ESP_OK;
+}
+
+void ui_assets_deinit(ui_assets_t *assets) {
+    if (assets && assets->base) {
+        esp_partition_munmap(assets->handle);
+        memset(assets, 0, sizeof(*assets));
+    }
+}
+
+const ui_asset_t *ui_asset_find(const ui_assets_t *assets, const char *name) {
+    if (!assets || !name) {
+        return NULL;
+    }
+    for (uint16_t i = 0; i < assets->count; ++i) {
+        if (strncmp(assets->entries[i].name, name, sizeof(assets->entries[i].name)) == 0) {
+            return &assets->entries[i];
+        }
+    }
+    return NULL;
+}
+
+void ui_asset_draw_row(const ui_asset_t *asset, uint16_t row, uint16_t x, uint16_t width, uint16_t *dst) {
+    const uint8_t *data = ui_asset_data(asset);
+    if (asset->encoding == UI_ASSET_RAW) {
+        // Opaque and incompressible: one copy out of the flash cache.
+        memcpy(dst, data + ((size_t)row * asset->width + x) * sizeof(uint16_t), width * sizeof(uint16_t));
+        return;
+    }
+    uint32_t offset;
+    memcpy(&offset, data + row * sizeof(uint32_t), sizeof(offset));
+    const uint8_t *p = data + (size_t)asset->height * sizeof(uint32_t) + offset;
+    // Packets never cross a row, so walk them until the clip window is done.
+    uint16_t col = 0;
+    const uint16_t end = x + width;
+    while (col < end) {
+        uint8_t ctrl = *p++;
+        uint8_t type = ctrl >> 6;
+        uint16_t count = (ctrl & 0x3F) + 1;
+        uint16_t from = col > x ? col : x;
+        uint16_t to = col + count < end ? col + count : end;
+        if (type == UI_ASSET_PACKET_LITERAL) {
+            if (from < to) {
+                memcpy(dst + (from - x), p + (from - col) * sizeof(uint16_t), (to - from) * sizeof(uint16_t));
+            }
+            p += count * sizeof(uint16_t);
+        } else if (type == UI_ASSET_PACKET_RUN) {
+            uint16_t px;
+            memcpy(&px, p, sizeof(px));
+            for (uint16_t i = from; i < to; ++i) {
+                dst[i - x] = px;
+            }
+            p += sizeof(uint16_t);
+        }
+        col += count;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#define UI_ASSET_PARTITION "assets"
+
+typedef enum {
+    UI_ASSET_RAW = 0,
+    UI_ASSET_RLE,
+} ui_asset_encoding_t;
+
+// Directory entry as written by tools/assetgen.py. Entries and pixel data are
+// used in place from the memory-mapped partition; nothing is copied to RAM.
+typedef struct {
+    char name[16];
+    uint16_t width;
+    uint16_t height;
+    uint8_t encoding;
+    uint8_t reserved[3];
+    uint32_t offset; // from the start of this entry
+    uint32_t size;
+} ui_asset_t;
+
+typedef struct {
+    const uint8_t *base;
+    const ui_asset_t *entries;
+    uint16_t count;
+    esp_partition_mmap_handle_t handle;
+} ui_assets_t;
+
+esp_err_t ui_assets_init(ui_assets_t *assets, const char *label);
+void ui_assets_deinit(ui_assets_t *assets);
+// NULL if the partition is not mapped or has no asset by that name.
+const ui_asset_t *ui_asset_find(const ui_assets_t *assets, const char *name);
+// Writes columns [x, x + width) of one asset row to dst in panel order.
+// Transparent pixels leave dst as it was.
+void ui_asset_draw_row(const ui_asset_t *asset, uint16_t row, uint16_t x, uint16_t width, uint16_t *dst);
@@ -0,0 +1,502 @@
+#include "ui_band.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "ui_blend.h"
+#include "ui_font.h"
+
+#define TAG "UI_BAND"
+
+static inline int16_t ui_min16(int16_t a, int16_t b) {
+    return a < b ? a : b;
+}
+
+static inline int16_t ui_max16(int16_t a, int16_t b) {
+    return a > b ? a : b;
+}
+
+bool ui_rect_intersect(const ui_rect_t *a, const ui_rect_t *b, ui_rect_t *out) {
+    int16_t x0 = ui_max16(a->x, b->x);
+    int16_t y0 = ui_max16(a->y, b->y);
+    int16_t x1 = ui_min16(a->x + a->width, b->x + b->width);
+    int16_t y1 = ui_min16(a->y + a->height, b->y + b->height);
+    if (x1 <= x0 || y1 <= y0) {
+        return false;
+    }
+    if (out) {
+        *out = (ui_rect_t) {x0, y0, x1 - x0, y1 - y0};
+    }
+    return true;
+}
+
+ui_rect_t ui_rect_union(const ui_rect_t *a, const ui_rect_t *b) {
+    int16_t x0 = ui_min16(a->x, b->x);
+    int16_t y0 = ui_min16(a->y, b->y);
+    int16_t x1 = ui_max16(a->x + a->width, b->x + b->width);
+    int16_t y1 = ui_max16(a->y + a->height, b->y + b->height);
+    return (ui_rect_t) {x0, y0, x1 - x0, y1 - y0};
+}
+
+size_t ui_rect_subtract(const ui_rect_t *rect, const ui_rect_t *hole, ui_rect_t out[4]) {
+    ui_rect_t inner;
+    if (!ui_rect_intersect(rect, hole, &inner)) {
+        out[0] = *rect;
+        return 1;
+    }
+    size_t count = 0;
+    int16_t bottom = rect->y + rect->height;
+    int16_t right = rect->x + rect->width;
+    if (inner.y > rect->y) {
+        out[count++] = (ui_rect_t) {rect->x, rect->y, rect->width, inner.y - rect->y};
+    }
+    if (inner.y + inner.height < bottom) {
+        out[count++] = (ui_rect_t) {rect->x, inner.y + inner.height, rect->width, bottom - inner.y - inner.height};
+    }
+    if (inner.x > rect->x) {
+        out[count++] = (ui_rect_t) {rect->x, inner.y, inner.x - rect->x, inner.height};
+    }
+    if (inner.x + inner.width < right) {
+        out[count++] = (ui_rect_t) {inner.x + inner.width, inner.y, right - inner.x - inner.width, inner.height};
+    }
+    return count;
+}
+
+void ui_scene_clear(ui_scene_t *scene) {
+    scene->count = 0;
+}
+
+static ui_prim_t *ui_scene_push(ui_scene_t *scene, ui_prim_type_t type, uint16_t color) {
+    if (scene->count >= UI_SCENE_MAX_PRIMS) {
+        ESP_LOGW(TAG, "Scene full, primitive dropped");
+        return NULL;
+    }
+    ui_prim_t *prim = &scene->prims[scene->count++];
+    memset(prim, 0, sizeof(*prim));
+    prim->type = type;
+    prim->color = color;
+    return prim;
+}
+
+ui_prim_t *ui_scene_add_rect(ui_scene_t *scene, int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color) {
+    if (width <= 0 || height <= 0) {
+        return NULL;
+    }
+    ui_prim_t *prim = ui_scene_push(scene, UI_PRIM_RECT, color);
+    if (prim) {
+        prim->bounds = (ui_rect_t) {x, y, width, height};
+    }
+    return prim;
+}
+
+ui_prim_t *ui_scene_add_text(ui_scene_t *scene, int16_t x, int16_t y, const char *str, const ui_font_t *font, uint16_t color) {
+    if (!str || !font) {
+        return NULL;
+    }
+    int16_t width = ui_font_text_width(font, str);
+    if (width == 0) {
+        return NULL;
+    }
+    int16_t lines = 1;
+    for (const char *p = str; *p; ++p) {
+        lines += *p == '\n';
+    }
+    ui_prim_t *prim = ui_scene_push(scene, UI_PRIM_TEXT, color);
+    if (prim) {
+        prim->text.str = str;
+        prim->text.font = font;
+        prim->bounds = (ui_rect_t) {x, y, width, lines * font->line_height};
+    }
+    return prim;
+}
+
+ui_prim_t *ui_scene_add_triangle(ui_scene_t *scene, const int16_t xs[3], const int16_t ys[3], uint16_t color) {
+    ui_prim_t *prim = ui_scene_push(scene, UI_PRIM_TRIANGLE, color);
+    if (!prim) {
+        return NULL;
+    }
+    int16_t x0 = xs[0], x1 = xs[0], y0 = ys[0], y1 = ys[0];
+    for (int i = 0; i < 3; ++i) {
+        prim->tri.x[i] = xs[i];
+        prim->tri.y[i] = ys[i];
+        x0 = ui_min16(x0, xs[i]);
+        x1 = ui_max16(x1, xs[i]);
+        y0 = ui_min16(y0, ys[i]);
+        y1 = ui_max16(y1, ys[i]);
+    }
+    prim->bounds = (ui_rect_t) {x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+    return prim;
+}
+
+ui_prim_t *ui_scene_add_round_rect(ui_scene_t *scene, int16_t x, int16_t y, int16_t width, int16_t height, int16_t radius, uint16_t color) {
+    if (width <= 0 || height <= 0) {
+        return NULL;
+    }
+    ui_prim_t *prim = ui_scene_push(scene, UI_PRIM_ROUND_RECT, color);
+    if (prim) {
+        prim->bounds = (ui_rect_t) {x, y, width, height};
+        prim->round.radius = ui_max16(0, ui_min16(radius, ui_min16(width, height) / 2));
+    }
+    return prim;
+}
+
+ui_prim_t *ui_scene_add_circle(ui_scene_t *scene, int16_t cx, int16_t cy, int16_t radius, uint16_t color) {
+    return ui_scene_add_round_rect(scene, cx - radius, cy - radius, radius * 2, radius * 2, radius, color);
+}
+
+ui_prim_t *ui_scene_add_bars(ui_scene_t *scene, int16_t x, int16_t y, int16_t height, const uint8_t *heights, uint8_t count,
+                             uint8_t width, uint8_t gap, uint16_t color) {
+    if (!heights || count == 0 || width == 0) {
+        return NULL;
+    }
+    ui_prim_t *prim = ui_scene_push(scene, UI_PRIM_BARS, color);
+    if (prim) {
+        prim->bounds = (ui_rect_t) {x, y, count * (width + gap) - gap, height};
+        prim->bars.heights = heights;
+        prim->bars.count = count;
+        prim->bars.width = width;
+        prim->bars.gap = gap;
+    }
+    return prim;
+}
+
+ui_prim_t *ui_scene_add_image(ui_scene_t *scene, int16_t x, int16_t y, const ui_asset_t *asset) {
+    if (!asset) {
+        return NULL;
+    }
+    ui_prim_t *prim = ui_scene_push(scene, UI_PRIM_IMAGE, 0);
+    if (!prim) {
+        return NULL;
+    }
+    prim->bounds = (ui_rect_t) {x, y, asset->width, asset->height};
+    prim->image.asset = asset;
+    return prim;
+}
+
+static void ui_band_raster_rect(uint16_t *dst, const ui_rect_t *band, const ui_rect_t *clip, uint16_t px) {
+    for (int16_t y = clip->y; y < clip->y + clip->height; ++y) {
+        uint16_t *row = dst + (y - band->y) * band->width + (clip->x - band->x);
+        for (int16_t i = 0; i < clip->width; ++i) {
+            row[i] = px;
+        }
+    }
+}
+
+static void ui_band_raster_glyph_row(uint16_t *row, const ui_rect_t *band, const ui_font_t *font, const uint8_t *bits,
+                                     int16_t x, int16_t width, int16_t clip_x0, int16_t clip_x1, uint16_t px,
+                                     uint32_t src, const uint8_t *alpha) {
+    if (font->bpp == 1) {
+        for (int16_t col = 0; col < width; ++col) {
+            int16_t dx = x + col;
+            if ((bits[col >> 3] & (0x80 >> (col & 7))) && dx >= clip_x0 && dx < clip_x1) {
+                row[dx - band->x] = px;
+            }
+        }
+        return;
+    }
+    const uint8_t bpp = font->bpp;
+    const uint8_t per_byte = 8 / bpp;
+    const uint8_t max_level = (1 << bpp) - 1;
+    int16_t col0 = ui_max16(0, clip_x0 - x);
+    int16_t col1 = ui_min16(width, clip_x1 - x);
+    for (int16_t col = col0; col < col1; ++col) {
+        uint8_t level = (bits[col / per_byte] >> (8 - bpp * (col % per_byte + 1))) & max_level;
+        if (level == max_level) {
+            row[x + col - band->x] = px;
+        } else if (level) {
+            row[x + col - band->x] = ui_blend_pixel(row[x + col - band->x], src, alpha[level]);
+        }
+    }
+}
+
+static void ui_band_raster_text(uint16_t *dst, const ui_rect_t *band, const ui_rect_t *clip, const ui_prim_t *prim, uint16_t px) {
+    // Walks the string once per output row and copies each glyph's packed
+    // row straight out of the pre-scaled font tables.
+    const ui_font_t *font = prim->text.font;
+    const int16_t clip_x1 = clip->x + clip->width;
+    const int16_t clip_y1 = clip->y + clip->height;
+    const char *line = prim->text.str;
+    int16_t line_y = prim->bounds.y;
+    // Coverage levels to blend weights, and the colour spread once per string.
+    const uint32_t src = ui_blend_expand(px);
+    const uint8_t max_level = (1 << font->bpp) - 1;
+    uint8_t alpha[16];
+    for (uint8_t level = 0; level <= max_level && font->bpp > 1; ++level) {
+        alpha[level] = (level * UI_ALPHA_OPAQUE + max_level / 2) / max_level;
+    }
+
+    while (line && line_y < clip_y1) {
+        const char *next = strchr(line, '\n');
+        int16_t y0 = ui_max16(line_y, clip->y);
+        int16_t y1 = ui_min16(line_y + font->line_height, clip_y1);
+        for (int16_t y = y0; y < y1; ++y) {
+            uint16_t *row = dst + (y - band->y) * band->width;
+            int16_t pen_x = prim->bounds.x;
+            const char *p = line;
+            while (*p && *p != '\n' && pen_x < clip_x1) {
+                const ui_font_glyph_t *glyph = ui_font_glyph(font, ui_utf8_next(&p));
+                int16_t glyph_x = pen_x + glyph->x_offset;
+                int16_t glyph_row = y - line_y - glyph->y_offset;
+                pen_x += glyph->advance;
+                if (glyph_row < 0 || glyph_row >= glyph->height || glyph_x + glyph->width <= clip->x) {
+                    continue;
+                }
+                const size_t stride = (glyph->width * font->bpp + 7) / 8;
+                const uint8_t *bits = font->bitmap + glyph->offset + glyph_row * stride;
+                ui_band_raster_glyph_row(row, band, font, bits, glyph_x, glyph->width, clip->x, clip_x1, px, src, alpha);
+            }
+        }
+        line = next ? next + 1 : NULL;
+        line_y += font->line_height;
+    }
+}
+
+static inline int32_t ui_edge(int16_t ax, int16_t ay, int16_t bx, int16_t by, int16_t px, int16_t py) {
+    return (int32_t)(bx - ax) * (py - ay) - (int32_t)(by - ay) * (px - ax);
+}
+
+static uint8_t ui_coverage(float distance) {
+    // distance is how far the pixel centre is inside the edge; a pixel half
+    // way across it is half covered.
+    if (distance >= 0.5f) {
+        return UI_ALPHA_OPAQUE;
+    }
+    if (distance <= -0.5f) {
+        return 0;
+    }
+    return (uint8_t)((distance + 0.5f) * UI_ALPHA_OPAQUE + 0.5f);
+}
+
+static void ui_band_raster_triangle(uint16_t *dst, const ui_rect_t *band, const ui_rect_t *clip, const ui_prim_t *prim, uint16_t px) {
+    const int16_t *tx = prim->tri.x;
+    const int16_t *ty = prim->tri.y;
+    int32_t area = ui_edge(tx[0], ty[0], tx[1], ty[1], tx[2], ty[2]);
+    if (area == 0) {
+        return;
+    }
+    // Each edge function scaled to a signed distance in pixels, positive
+    // inside whichever way the vertices wind, and stepped along the row.
+    const float sign = area > 0 ? 1.0f : -1.0f;
+    float dist[3];
+    float step[3];
+    float rise[3];
+    for (int i = 0; i < 3; ++i) {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        float dx = tx[b] - tx[a];
+        float dy = ty[b] - ty[a];
+        float scale = sign / sqrtf(dx * dx + dy * dy);
+        dist[i] = ui_edge(tx[a], ty[a], tx[b], ty[b], clip->x, clip->y) * scale;
+        step[i] = -dy * scale;
+        rise[i] = dx * scale;
+    }
+    uint8_t coverage[ILI9488_WIDTH];
+    for (int16_t y = clip->y; y < clip->y + clip->height; ++y) {
+        float d0 = dist[0], d1 = dist[1], d2 = dist[2];
+        for (int16_t i = 0; i < clip->width; ++i) {
+            float d = fminf(d0, fminf(d1, d2));
+            coverage[i] = ui_coverage(d);
+            d0 += step[0];
+            d1 += step[1];
+            d2 += step[2];
+        }
+        ui_blend_mask(dst + (y - band->y) * band->width + (clip->x - band->x), px, coverage, clip->width);
+        for (int i = 0; i < 3; ++i) {
+            dist[i] += rise[i];
+        }
+    }
+}
+
+static void ui_band_raster_round_rect(uint16_t *dst, const ui_rect_t *band, const ui_rect_t *clip, const ui_prim_t *prim, uint16_t px) {
+    const ui_rect_t *r = &prim->bounds;
+    const float radius = prim->round.radius;
+    // Corner circle centres; between them the edges are straight and on
+    // pixel boundaries, so only the corners need coverage.
+    const float left = r->x + radius;
+    const float right = r->x + r->width - radius;
+    const float top = r->y + radius;
+    const float bottom = r->y + r->height - radius;
+    uint8_t coverage[ILI9488_WIDTH];
+    for (int16_t y = clip->y; y < clip->y + clip->height; ++y) {
+        uint16_t *row = dst + (y - band->y) * band->width + (clip->x - band->x);
+        float cy = y + 0.5f;
+        float dy = cy < top ? top - cy : cy > bottom ? cy - bottom : 0.0f;
+        if (dy == 0.0f) {
+            for (int16_t i = 0; i < clip->width; ++i) {
+                row[i] = px;
+            }
+            continue;
+        }
+        for (int16_t i = 0; i < clip->width; ++i) {
+            float cx = clip->x + i + 0.5f;
+            float dx = cx < left ? left - cx : cx > right ? cx - right : 0.0f;
+            coverage[i] = ui_coverage(dx == 0.0f ? radius - dy : radius - sqrtf(dx * dx + dy * dy));
+        }
+        ui_blend_mask(row, px, coverage, clip->width);
+    }
+}
+
+static void ui_band_raster_image(uint16_t *dst, const ui_rect_t *band, const ui_rect_t *clip, const ui_prim_t *prim) {
+    for (int16_t y = clip->y; y < clip->y + clip->height; ++y) {
+        uint16_t *row = dst + (y - band->y) * band->width + (clip->x - band->x);
+        ui_asset_draw_row(prim->image.asset, y - prim->bounds.y, clip->x - prim->bounds.x, clip->width, row);
+    }
+}
+
+static void ui_band_raster_bars(uint16_t *dst, const ui_rect_t *band, const ui_rect_t *clip, const ui_prim_t *prim, uint16_t px) {
+    const ui_rect_t *r = &prim->bounds;
+    const int16_t pitch = prim->bars.width + prim->bars.gap;
+    const int16_t first = (clip->x - r->x) / pitch;
+    for (int16_t i = first; i < prim->bars.count; ++i) {
+        int16_t height = ui_min16(prim->bars.heights[i], r->height);
+        ui_rect_t bar = {r->x + i * pitch, r->y + r->height - height, prim->bars.width, height};
+        if (bar.x >= clip->x + clip->width) {
+            break;
+        }
+        ui_rect_t part;
+        if (ui_rect_intersect(&bar, clip, &part)) {
+            ui_band_raster_rect(dst, band, &part, px);
+        }
+    }
+}
+
+static void ui_band_raster(uint16_t *dst, const ui_rect_t *band, const ui_scene_t *scene) {
+    for (size_t i = 0; i < scene->count; ++i) {
+        const ui_prim_t *prim = &scene->prims[i];
+        ui_rect_t clip;
+        if (!ui_rect_intersect(&prim->bounds, band, &clip)) {
+            continue;
+        }
+        const uint16_t px = ili9488_panel_color(prim->color);
+        switch (prim->type) {
+            case UI_PRIM_RECT:
+                ui_band_raster_rect(dst, band, &clip, px);
+                break;
+            case UI_PRIM_TEXT:
+                ui_band_raster_text(dst, band, &clip, prim, px);
+                break;
+            case UI_PRIM_TRIANGLE:
+                ui_band_raster_triangle(dst, band, &clip, prim, px);
+                break;
+            case UI_PRIM_IMAGE:
+                ui_band_raster_image(dst, band, &clip, prim);
+                break;
+            case UI_PRIM_ROUND_RECT:
+                ui_band_raster_round_rect(dst, band, &clip, prim, px);
+                break;
+            case UI_PRIM_BARS:
+                ui_band_raster_bars(dst, band, &clip, prim, px);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+esp_err_t ui_band_init(ui_band_renderer_t *renderer, ili9488_t *display) {
+    if (!renderer || !display) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->display = display;
+    for (size_t i = 0; i < UI_BAND_BUFFERS; ++i) {
+        esp_err_t ret = ili9488_surface_create(&renderer->buffers[i], ILI9488_WIDTH, UI_BAND_ROWS);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to allocate band buffer %u", (unsigned)i);
+            ui_band_deinit(renderer);
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+void ui_band_deinit(ui_band_renderer_t *renderer) {
+    if (!renderer) {
+        return;
+    }
+    if (renderer->display) {
+        ili9488_wait_idle(renderer->display);
+    }
+    for (size_t i = 0; i < UI_BAND_BUFFERS; ++i) {
+        ili9488_surface_destroy(&renderer->buffers[i]);
+    }
+}
+
+esp_err_t ui_band_acquire(ui_band_renderer_t *renderer, uint16_t **pixels) {
+    if (!renderer || !pixels) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t index = renderer->next;
+    ESP_RETURN_ON_ERROR(ili9488_wait_fence(renderer->display, renderer->fences[index]), TAG, "Band fence failed");
+    *pixels = renderer->buffers[index].pixels;
+    return ESP_OK;
+}
+
+esp_err_t ui_band_submit(ui_band_renderer_t *renderer, const ui_rect_t *rect) {
+    if (!renderer || !rect || (int32_t)rect->width * rect->height > UI_BAND_PIXELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t index = renderer->next;
+    ESP_RETURN_ON_ERROR(ili9488_blit_panel_pixels(renderer->display, rect->x, rect->y, rect->width, rect->height, renderer->buffers[index].pixels), TAG, "Band blit failed");
+    renderer->fences[index] = ili9488_fence(renderer->display);
+    renderer->next = (index + 1) % UI_BAND_BUFFERS;
+    return ESP_OK;
+}
+
+esp_err_t ui_band_render(ui_band_renderer_t *renderer, const ui_scene_t *scene, const ui_rect_t *region) {
+    if (!renderer || !scene || !region) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const ui_rect_t screen = {0, 0, ILI9488_WIDTH, ILI9488_HEIGHT};
+    ui_rect_t area;
+    if (!ui_rect_intersect(region, &screen, &area)) {
+        return ESP_OK;
+    }
+
+    int64_t frame_start = esp_timer_get_time();
+    int64_t raster_us = 0;
+    uint32_t bands = 0;
+    // Narrow regions get taller bands so the whole buffer is used.
+    int16_t rows_per_band = UI_BAND_PIXELS / area.width;
+    for (int16_t y = area.y; y < area.y + area.height; y += rows_per_band) {
+        ui_rect_t band = {area.x, y, area.width, ui_min16(rows_per_band, area.y + area.height - y)};
+        uint16_t *pixels;
+        ESP_RETURN_ON_ERROR(ui_band_acquire(renderer, &pixels), TAG, "Band fence failed");
+
+        int64_t raster_start = esp_timer_get_time();
+        ui_band_raster(pixels, &band, scene);
+        raster_us += esp_timer_get_time() - raster_start;
+
+        ESP_RETURN_ON_ERROR(ui_band_submit(renderer, &band), TAG, "Band blit failed");
+        bands++;
+    }
+
+    renderer->last = (ui_band_stats_t) {
+        .bands = bands,
+        .raster_us = (uint32_t)raster_us,
+        .frame_us = (uint32_t)(esp_timer_get_time() - frame_start),
+    };
+    return ESP_OK;
+}
+
+esp_err_t ui_band_draw_text(ui_band_renderer_t *renderer, int16_t x, int16_t y, const char *str, const ui_font_t *font, uint16_t fg, uint16_t bg) {
+    if (!renderer || !str) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ui_scene_t *scene = &renderer->scratch;
+    ui_scene_clear(scene);
+    ui_prim_t *text = ui_scene_add_text(scene, x, y, str, font, fg);
+    if (!text) {
+        return ESP_OK;
+    }
+    ui_rect_t bounds = text->bounds;
+    // The background goes underneath so every pixel in the window is set.
+    ui_prim_t background = {.type = UI_PRIM_RECT, .bounds = bounds, .color = bg};
+    scene->prims[1] = scene->prims[0];
+    scene->prims[0] = background;
+    scene->count = 2;
+    return ui_band_render(renderer, scene, &bounds);
+}
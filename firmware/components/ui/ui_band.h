@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "ili9488.h"
+#include "ui_asset.h"
+#include "ui_font.h"
+
+#define UI_BAND_ROWS 40
+#define UI_BAND_PIXELS (ILI9488_WIDTH * UI_BAND_ROWS)
+#define UI_BAND_BUFFERS 2
+#define UI_SCENE_MAX_PRIMS 24
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+} ui_rect_t;
+
+typedef enum {
+    UI_PRIM_RECT = 0,
+    UI_PRIM_TEXT,
+    UI_PRIM_TRIANGLE,
+    UI_PRIM_IMAGE,
+    UI_PRIM_ROUND_RECT,
+    UI_PRIM_BARS,
+} ui_prim_type_t;
+
+// Primitives are painted in list order; colours are host-order RGB565. The
+// first primitive should cover the screen, since bands are not cleared.
+// Triangles, rounded rects and glyphs with more than 1 bpp are anti-aliased
+// by blending their edge coverage over what is already in the band.
+typedef struct {
+    ui_prim_type_t type;
+    ui_rect_t bounds;
+    uint16_t color;
+    union {
+        struct {
+            const char *str; // UTF-8, '\n' starts a new line
+            const ui_font_t *font;
+        } text;
+        struct {
+            int16_t x[3];
+            int16_t y[3];
+        } tri;
+        struct {
+            const ui_asset_t *asset; // colour is unused
+        } image;
+        struct {
+            int16_t radius; // at most half the shorter side
+        } round;
+        struct {
+            const uint8_t *heights; // pixels, read when rasterised
+            uint8_t count;
+            uint8_t width;
+            uint8_t gap;
+        } bars;
+    };
+} ui_prim_t;
+
+typedef struct {
+    ui_prim_t prims[UI_SCENE_MAX_PRIMS];
+    size_t count;
+} ui_scene_t;
+
+typedef struct {
+    uint32_t bands;
+    uint32_t raster_us;
+    uint32_t frame_us;
+} ui_band_stats_t;
+
+typedef struct {
+    ili9488_t *display;
+    ili9488_surface_t buffers[UI_BAND_BUFFERS];
+    ili9488_fence_t fences[UI_BAND_BUFFERS];
+    uint8_t next;
+    ui_band_stats_t last;
+    ui_scene_t scratch;
+} ui_band_renderer_t;
+
+esp_err_t ui_band_init(ui_band_renderer_t *renderer, ili9488_t *display);
+void ui_band_deinit(ui_band_renderer_t *renderer);
+// Rasterises the part of the scene inside region band by band; band N+1 is
+// rasterised while band N is being sent, and every pixel goes out once.
+esp_err_t ui_band_render(ui_band_renderer_t *renderer, const ui_scene_t *scene, const ui_rect_t *region);
+// Lets a producer other than the rasteriser fill band buffers: acquire waits
+// until the next buffer's previous blit is done, submit sends its first
+// width x height pixels (at most UI_BAND_PIXELS, panel order) to rect.
+esp_err_t ui_band_acquire(ui_band_renderer_t *renderer, uint16_t **pixels);
+esp_err_t ui_band_submit(ui_band_renderer_t *renderer, const ui_rect_t *rect);
+// Immediate-mode text: the whole string and its spacing go out as one window.
+esp_err_t ui_band_draw_text(ui_band_renderer_t *renderer, int16_t x, int16_t y, const char *str, const ui_font_t *font, uint16_t fg, uint16_t bg);
+
+void ui_scene_clear(ui_scene_t *scene);
+ui_prim_t *ui_scene_add_rect(ui_scene_t *scene, int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+ui_prim_t *ui_scene_add_text(ui_scene_t *scene, int16_t x, int16_t y, const char *str, const ui_font_t *font, uint16_t color);
+// Vertices are pixel centres.
+ui_prim_t *ui_scene_add_triangle(ui_scene_t *scene, const int16_t xs[3], const int16_t ys[3], uint16_t color);
+// radius is clamped to half the shorter side, so a square with a radius of
+// half its width is a circle.
+ui_prim_t *ui_scene_add_round_rect(ui_scene_t *scene, int16_t x, int16_t y, int16_t width, int16_t height, int16_t radius, uint16_t color);
+// Centred on the corner between pixels (cx - 1, cy - 1) and (cx, cy).
+// Bottom-aligned bars of the given width and spacing; only the bars are
+// painted, not the space around them.
+ui_prim_t *ui_scene_add_bars(ui_scene_t *scene, int16_t x, int16_t y, int16_t height, const uint8_t *heights, uint8_t count,
+                             uint8_t width, uint8_t gap, uint16_t color);
+ui_prim_t *ui_scene_add_circle(ui_scene_t *scene, int16_t cx, int16_t cy, int16_t radius, uint16_t color);
+// Returns NULL (and adds nothing) for a NULL asset, so callers can fall back.
+ui_prim_t *ui_scene_add_image(ui_scene_t *scene, int16_t x, int16_t y, const ui_asset_t *asset);
+
+bool ui_rect_intersect(const ui_rect_t *a, const ui_rect_t *b, ui_rect_t *out);
+ui_rect_t ui_rect_union(const ui_rect_t *a, const ui_rect_t *b);
+// Splits the part of rect outside hole into at most four rects.
+size_t ui_rect_subtract(const ui_rect_t *rect, const ui_rect_t *hole, ui_rect_t out[4]);
@@ -0,0 +1,171 @@
+#include "ui.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "ui_blend.h"
+
+#define TAG "UI_BENCH"
+
+// The pre-band text path: one window and one pool chunk per character.
+static void ui_bench_draw_char(ui_context_t *ctx, int x, int y, uint32_t codepoint, const ui_font_t *font, uint16_t fg, uint16_t bg) {
+    const ui_font_glyph_t *glyph = ui_font_glyph(font, codepoint);
+    const int width = glyph->advance;
+    const int height = font->line_height;
+    const uint16_t fg_px = ili9488_panel_color(fg);
+    const uint16_t bg_px = ili9488_panel_color(bg);
+    uint8_t *chunk = NULL;
+    size_t max_pixels = 0;
+    if (ili9488_write_begin(ctx->display, x, y, width, height) != ESP_OK ||
+        ili9488_write_acquire(ctx->display, &chunk, &max_pixels) != ESP_OK ||
+        max_pixels < (size_t)(width * height)) {
+        return;
+    }
+    uint16_t *bitmap = (uint16_t *)chunk;
+    const size_t stride = (glyph->width * font->bpp + 7) / 8;
+    for (int row = 0; row < height; ++row) {
+        int glyph_row = row - glyph->y_offset;
+        const uint8_t *bits = font->bitmap + glyph->offset + glyph_row * stride;
+        for (int col = 0; col < width; ++col) {
+            int glyph_col = col - glyph->x_offset;
+            bool pixel = glyph_row >= 0 && glyph_row < glyph->height && glyph_col >= 0 && glyph_col < glyph->width &&
+                         (bits[(glyph_col * font->bpp) >> 3] & (0x80 >> ((glyph_col * font->bpp) & 7)));
+            bitmap[row * width + col] = pixel ? fg_px : bg_px;
+        }
+    }
+    ili9488_write_submit(ctx->display, width * height, true);
+}
+
+static void ui_bench_draw_text_per_char(ui_context_t *ctx, int x, int y, const char *text, const ui_font_t *font, uint16_t fg, uint16_t bg) {
+    while (*text) {
+        uint32_t codepoint = ui_utf8_next(&text);
+        ui_bench_draw_char(ctx, x, y, codepoint, font, fg, bg);
+        x += ui_font_glyph(font, codepoint)->advance;
+    }
+}
+
+void ui_benchmark_text(ui_context_t *ctx, uint32_t iterations) {
+    if (!ctx || iterations == 0) {
+        return;
+    }
+    static const char *sample = "Now Playing";
+    const ui_font_t *font = &ui_font_large;
+
+    ili9488_wait_idle(ctx->display);
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        ui_bench_draw_text_per_char(ctx, 16, 16, sample, font, ctx->accent_color, ctx->background_color);
+    }
+    ili9488_wait_idle(ctx->display);
+    int64_t per_char_us = (esp_timer_get_time() - start) / iterations;
+
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        ui_band_draw_text(&ctx->renderer, 16, 16, sample, font, ctx->accent_color, ctx->background_color);
+    }
+    ili9488_wait_idle(ctx->display);
+    int64_t span_us = (esp_timer_get_time() - start) / iterations;
+
+    ESP_LOGI(TAG, "\"%s\" %u px: per-char %ld us, span %ld us per string", sample, (unsigned)font->line_height, (long)per_char_us, (long)span_us);
+}
+
+static int64_t ui_bench_full_screen(ui_context_t *ctx, uint32_t frames) {
+    ili9488_wait_idle(ctx->display);
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < frames; ++i) {
+        ui_draw_boot_screen(ctx);
+    }
+    ili9488_wait_idle(ctx->display);
+    return (esp_timer_get_time() - start) / frames;
+}
+
+void ui_benchmark_pixel_formats(ui_context_t *ctx, uint32_t frames) {
+    if (!ctx || frames == 0) {
+        return;
+    }
+    // One band through the expansion kernel against a plain copy of the same
+    // band, so the conversion cost is separate from the extra bus time.
+    const uint16_t *band = ctx->renderer.buffers[0].pixels;
+    uint8_t *scratch = malloc(UI_BAND_PIXELS * 3);
+    if (scratch) {
+        ili9488_wait_idle(ctx->display);
+        int64_t start = esp_timer_get_time();
+        for (uint32_t i = 0; i < frames; ++i) {
+            memcpy(scratch, band, UI_BAND_PIXELS * sizeof(uint16_t));
+        }
+        int64_t copy_us = esp_timer_get_time() - start;
+        start = esp_timer_get_time();
+        for (uint32_t i = 0; i < frames; ++i) {
+            ili9488_rgb565_to_rgb666(scratch, band, UI_BAND_PIXELS);
+        }
+        int64_t expand_us = esp_timer_get_time() - start;
+        free(scratch);
+        ESP_LOGI(TAG, "%u px band: memcpy %ld us, 565->666 %ld us", (unsigned)UI_BAND_PIXELS, (long)(copy_us / frames), (long)(expand_us / frames));
+    }
+
+    const ili9488_pixel_format_t original = ctx->display->pixel_format;
+    int64_t frame_us[2] = {0};
+    for (int format = ILI9488_PIXEL_FORMAT_RGB565; format <= ILI9488_PIXEL_FORMAT_RGB666; ++format) {
+        if (ili9488_set_pixel_format(ctx->display, format) != ESP_OK) {
+            break;
+        }
+        frame_us[format] = ui_bench_full_screen(ctx, frames);
+    }
+    ili9488_set_pixel_format(ctx->display, original);
+    ESP_LOGI(TAG, "Full screen: RGB565 %ld us, RGB666 %ld us per frame", (long)frame_us[ILI9488_PIXEL_FORMAT_RGB565], (long)frame_us[ILI9488_PIXEL_FORMAT_RGB666]);
+}
+
+// The pre-kernel blend: both pixels spread per call, one pixel at a time.
+static uint16_t ui_bench_blend_pixel(uint16_t dst, uint16_t src, uint32_t alpha) {
+    uint32_t d = (uint16_t)((dst >> 8) | (dst << 8));
+    uint32_t s = (uint16_t)((src >> 8) | (src << 8));
+    d = (d | (d << 16)) & 0x07E0F81F;
+    s = (s | (s << 16)) & 0x07E0F81F;
+    d = (d + (((s - d) * alpha) >> 5)) & 0x07E0F81F;
+    uint16_t out = (uint16_t)(d | (d >> 16));
+    return (uint16_t)((out >> 8) | (out << 8));
+}
+
+void ui_benchmark_blend(ui_context_t *ctx, uint32_t iterations) {
+    if (!ctx || iterations == 0) {
+        return;
+    }
+    uint16_t *band = ctx->renderer.buffers[0].pixels;
+    uint8_t *coverage = malloc(UI_BAND_PIXELS);
+    if (!coverage) {
+        return;
+    }
+    // Every weight in turn, so the mask kernel gets no clear or opaque pairs.
+    for (size_t i = 0; i < UI_BAND_PIXELS; ++i) {
+        coverage[i] = 1 + i % (UI_ALPHA_OPAQUE - 1);
+    }
+    const uint16_t px = ili9488_panel_color(ctx->accent_color);
+    ili9488_wait_idle(ctx->display);
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        for (size_t j = 0; j < UI_BAND_PIXELS; ++j) {
+            band[j] = ui_bench_blend_pixel(band[j], px, coverage[j]);
+        }
+    }
+    int64_t pixel_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        ui_blend_mask(band, px, coverage, UI_BAND_PIXELS);
+    }
+    int64_t mask_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        ui_blend_fill(band, px, UI_ALPHA_OPAQUE / 2, UI_BAND_PIXELS);
+    }
+    int64_t fill_us = esp_timer_get_time() - start;
+    free(coverage);
+
+    const int64_t pixels = (int64_t)iterations * UI_BAND_PIXELS;
+    ESP_LOGI(TAG, "Blend ns/px: per-pixel %ld, mask %ld, constant alpha %ld", (long)(pixel_us * 1000 / pixels),
+             (long)(mask_us * 1000 / pixels), (long)(fill_us * 1000 / pixels));
+}
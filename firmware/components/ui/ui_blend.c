@@ -0,0 +1,85 @@
+#include "ui_blend.h"
+
+// Band buffers are word-aligned, so the kernels move two pixels per load and
+// store and byte-swap both halves of the word at once.
+static inline uint32_t ui_blend_swap_pair(uint32_t w) {
+    return ((w >> 8) & 0x00FF00FF) | ((w << 8) & 0xFF00FF00);
+}
+
+static inline uint32_t ui_blend_spread(uint32_t host) {
+    return (host | (host << 16)) & UI_BLEND_MASK;
+}
+
+static inline uint32_t ui_blend_join(uint32_t lo, uint32_t hi) {
+    return ((lo | (lo >> 16)) & 0xFFFF) | ((hi | (hi >> 16)) << 16);
+}
+
+void ui_blend_fill(uint16_t *dst, uint16_t px, uint8_t alpha, size_t count) {
+    if (alpha == 0) {
+        return;
+    }
+    if (alpha >= UI_ALPHA_OPAQUE) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = px;
+        }
+        return;
+    }
+    // The source term is the same for every pixel, so only dst is multiplied.
+    const uint32_t src = ui_blend_expand(px) * alpha;
+    const uint32_t keep = UI_ALPHA_OPAQUE - alpha;
+    if (count && ((uintptr_t)dst & 2)) {
+        *dst = ui_blend_pack(((ui_blend_expand(*dst) * keep + src) >> 5) & UI_BLEND_MASK);
+        dst++;
+        count--;
+    }
+    uint32_t *words = (uint32_t *)dst;
+    for (; count >= 2; count -= 2, ++words) {
+        uint32_t host = ui_blend_swap_pair(*words);
+        uint32_t lo = ((ui_blend_spread(host & 0xFFFF) * keep + src) >> 5) & UI_BLEND_MASK;
+        uint32_t hi = ((ui_blend_spread(host >> 16) * keep + src) >> 5) & UI_BLEND_MASK;
+        *words = ui_blend_swap_pair(ui_blend_join(lo, hi));
+    }
+    if (count) {
+        dst = (uint16_t *)words;
+        *dst = ui_blend_pack(((ui_blend_expand(*dst) * keep + src) >> 5) & UI_BLEND_MASK);
+    }
+}
+
+static inline uint32_t ui_blend_spread_alpha(uint32_t d, uint32_t src, uint32_t alpha) {
+    return (((d << 5) + (src - d) * alpha) >> 5) & UI_BLEND_MASK;
+}
+
+void ui_blend_mask(uint16_t *dst, uint16_t px, const uint8_t *alpha, size_t count) {
+    const uint32_t src = ui_blend_expand(px);
+    if (count && ((uintptr_t)dst & 2)) {
+        if (*alpha) {
+            *dst = *alpha >= UI_ALPHA_OPAQUE ? px : ui_blend_pixel(*dst, src, *alpha);
+        }
+        dst++;
+        alpha++;
+        count--;
+    }
+    // Shape interiors and the space around them come in long runs, so whole
+    // pairs that are clear or opaque cost one compare.
+    const uint32_t pair = (uint32_t)px | ((uint32_t)px << 16);
+    uint32_t *words = (uint32_t *)dst;
+    for (; count >= 2; count -= 2, ++words, alpha += 2) {
+        uint32_t a0 = alpha[0];
+        uint32_t a1 = alpha[1];
+        if ((a0 | a1) == 0) {
+            continue;
+        }
+        if (a0 >= UI_ALPHA_OPAQUE && a1 >= UI_ALPHA_OPAQUE) {
+            *words = pair;
+            continue;
+        }
+        uint32_t host = ui_blend_swap_pair(*words);
+        uint32_t lo = a0 >= UI_ALPHA_OPAQUE ? src : ui_blend_spread_alpha(ui_blend_spread(host & 0xFFFF), src, a0);
+        uint32_t hi = a1 >= UI_ALPHA_OPAQUE ? src : ui_blend_spread_alpha(ui_blend_spread(host >> 16), src, a1);
+        *words = ui_blend_swap_pair(ui_blend_join(lo, hi));
+    }
+    if (count && *alpha) {
+        dst = (uint16_t *)words;
+        *dst = *alpha >= UI_ALPHA_OPAQUE ? px : ui_blend_pixel(*dst, src, *alpha);
+    }
+}
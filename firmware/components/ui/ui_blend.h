@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Coverage runs from 0 (dst kept) to UI_ALPHA_OPAQUE (src); five bits is all
+// an RGB565 channel can resolve.
+#define UI_ALPHA_OPAQUE 32
+#define UI_BLEND_MASK 0x07E0F81Fu
+
+// Spreads a panel-order RGB565 pixel to ---gggggg-----rrrrr------bbbbb so every
+// channel has room for a 5-bit multiply and the sum of two products.
+static inline uint32_t ui_blend_expand(uint16_t panel) {
+    uint32_t v = (uint16_t)((panel >> 8) | (panel << 8));
+    return (v | (v << 16)) & UI_BLEND_MASK;
+}
+
+static inline uint16_t ui_blend_pack(uint32_t spread) {
+    uint16_t v = (uint16_t)(spread | (spread >> 16));
+    return (uint16_t)((v >> 8) | (v << 8));
+}
+
+// (d << 5) + (s - d) * a equals s * a + d * (32 - a) in every channel, so
+// borrows between channels cancel and the result is exact with one multiply.
+static inline uint16_t ui_blend_pixel(uint16_t dst, uint32_t src, uint32_t alpha) {
+    uint32_t d = ui_blend_expand(dst);
+    return ui_blend_pack((((d << 5) + (src - d) * alpha) >> 5) & UI_BLEND_MASK);
+}
+
+// Blends px (panel order) over count pixels at one alpha.
+void ui_blend_fill(uint16_t *dst, uint16_t px, uint8_t alpha, size_t count);
+// Blends px over count pixels, each with its own alpha. Runs of 0 and
+// UI_ALPHA_OPAQUE are skipped or stored without a multiply.
+void ui_blend_mask(uint16_t *dst, uint16_t px, const uint8_t *alpha, size_t count);
@@ -0,0 +1,67 @@
+#include "ui_font.h"
+
+#include <stddef.h>
+
+const ui_font_glyph_t *ui_font_glyph(const ui_font_t *font, uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        return &font->glyphs[font->ascii[codepoint]];
+    }
+    size_t lo = 0;
+    size_t hi = font->glyph_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        uint16_t cp = font->glyphs[mid].codepoint;
+        if (cp == codepoint) {
+            return &font->glyphs[mid];
+        }
+        if (cp < codepoint) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return &font->glyphs[font->fallback];
+}
+
+uint32_t ui_utf8_next(const char **str) {
+    const uint8_t *p = (const uint8_t *)*str;
+    uint32_t cp = p[0];
+    size_t len = 1;
+    if (cp >= 0xC2 && cp <= 0xDF) {
+        len = 2;
+        cp &= 0x1F;
+    } else if (cp >= 0xE0 && cp <= 0xEF) {
+        len = 3;
+        cp &= 0x0F;
+    } else if (cp >= 0xF0 && cp <= 0xF4) {
+        len = 4;
+        cp &= 0x07;
+    }
+    for (size_t i = 1; i < len; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            // Not a continuation byte: treat the lead byte as Latin-1.
+            *str += 1;
+            return p[0];
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    *str += len;
+    return cp;
+}
+
+int16_t ui_font_text_width(const ui_font_t *font, const char *str) {
+    int16_t width = 0;
+    int16_t line = 0;
+    while (*str) {
+        uint32_t cp = ui_utf8_next(&str);
+        if (cp == '\n') {
+            line = 0;
+            continue;
+        }
+        line += ui_font_glyph(font, cp)->advance;
+        if (line > width) {
+            width = line;
+        }
+    }
+    return width;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+// Glyph bitmaps are cropped to their ink; rows are packed MSB first at the
+// font's bpp and padded to a whole byte.
+typedef struct {
+    uint16_t codepoint;
+    uint32_t offset;
+    uint8_t width;
+    uint8_t height;
+    int8_t x_offset;
+    uint8_t y_offset; // from the top of the line box
+    uint8_t advance;
+} ui_font_glyph_t;
+
+// Tables are generated at build time by tools/fontgen.py, pre-scaled to the
+// size they are drawn at.
+typedef struct {
+    const uint8_t *bitmap;
+    const ui_font_glyph_t *glyphs; // sorted by codepoint
+    const uint16_t *ascii;         // glyph index for codes below 0x80
+    uint16_t glyph_count;
+    uint16_t fallback;
+    uint8_t bpp;
+    uint8_t ascent;
+    uint8_t line_height;
+} ui_font_t;
+
+extern const ui_font_t ui_font_small;
+extern const ui_font_t ui_font_large;
+
+const ui_font_glyph_t *ui_font_glyph(const ui_font_t *font, uint32_t codepoint);
+// Decodes one UTF-8 sequence and advances *str past it. Bytes that do not
+// form valid UTF-8 are taken as Latin-1 so either encoding renders.
+uint32_t ui_utf8_next(const char **str);
+// Width in pixels of the widest line of str.
+int16_t ui_font_text_width(const ui_font_t *font, const char *str);
@@ -7,8 +7,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 
 #include "audio.h"
+#include "bus_sched.h"
 #include "encoder.h"
 #include "esp_check.h"
 #include "esp_log.h"
@@ -24,6 +26,7 @@
 #include "ili9488.h"
 #include "nvs_flash.h"
 #include "sdmmc_cmd.h"
+#include "spectrum.h"
 #include "ui.h"
 
 #define TAG "SPOTIFY_DESK"
@@ -32,6 +35,30 @@
 #define CONFIG_TFT_SPI_SPEED_HZ (20 * 1000 * 1000)
 #endif
 
+#ifndef CONFIG_UI_MAX_FPS
+#define CONFIG_UI_MAX_FPS 30
+#endif
+
+#ifndef CONFIG_SD_BUS_LATENCY_US
+#define CONFIG_SD_BUS_LATENCY_US BUS_SCHED_DEFAULT_LATENCY_US
+#endif
+
+#ifndef CONFIG_AUDIO_PREFETCH_BLOCKS
+#define CONFIG_AUDIO_PREFETCH_BLOCKS AUDIO_DEFAULT_PREFETCH_BLOCKS
+#endif
+
+#ifndef CONFIG_UI_SCRUB_STEP_MS
+#define CONFIG_UI_SCRUB_STEP_MS 5000
+#endif
+
+#ifndef CONFIG_UI_SCRUB_TIMEOUT_MS
+#define CONFIG_UI_SCRUB_TIMEOUT_MS 3000
+#endif
+
+#ifndef CONFIG_UI_ART_CACHE_KB
+#define CONFIG_UI_ART_CACHE_KB 2048
+#endif
+
 #define SCREEN_MOSI GPIO_NUM_28
 #define SCREEN_MISO GPIO_NUM_30
 #define SCREEN_SCLK GPIO_NUM_29
@@ -40,6 +67,8 @@
 #define SCREEN_RES GPIO_NUM_35
 #define SCREEN_BL GPIO_NUM_2
 #define SD_CS GPIO_NUM_10
+#define SCREEN_MAX_TRANSFER_BYTES (320 * 40 * 2)
+#define SCREEN_SPI_QUEUE_SIZE 16
 
 #define I2C_SDA GPIO_NUM_39
 #define I2C_SCL GPIO_NUM_38
@@ -53,14 +82,19 @@
 #define I2S_BCLK GPIO_NUM_5
 #define I2S_LRCLK GPIO_NUM_6
 #define I2S_DOUT GPIO_NUM_7
+#define AUDIO_SAMPLE_RATE_HZ 44100
 
 #define MUSIC_DIR "/sd/music"
+// FATFS is built without long file names, so everything here stays 8.3.
+#define ART_CACHE_DIR "/sd/ARTCACHE"
+#define MAX_TRACKS 64
 
 typedef enum {
 	INPUT_EVENT_TOUCH = 0,
 	INPUT_EVENT_ENCODER_LEFT,
 	INPUT_EVENT_ENCODER_RIGHT,
 	INPUT_EVENT_ENCODER_BUTTON,
+	INPUT_EVENT_TRACK_END, // from the audio task, not a user input
 } input_event_type_t;
 
 typedef struct {
@@ -70,6 +104,7 @@ typedef struct {
 			uint16_t x;
 			uint16_t y;
 		} touch;
+		uint32_t play_request; // INPUT_EVENT_TRACK_END
 	} data;
 } input_event_t;
 
@@ -81,6 +116,8 @@ typedef enum {
 
 typedef struct {
 	audio_command_type_t type;
+	uint32_t play_request; // AUDIO_CMD_PLAY_WAV: sequence number, for its end event
+	uint32_t stops;        // AUDIO_CMD_PLAY_WAV: audio_get_stop_count() when requested
 	char path[256];
 } audio_command_t;
 
@@ -89,13 +126,27 @@ static QueueHandle_t audio_queue;
 
 static spi_device_handle_t lcd_spi = NULL;
 static ili9488_t lcd = {0};
+static bus_sched_t bus_sched;
 static gt911_handle_t *touch_handle = NULL;
 static encoder_handle_t *encoder_handle = NULL;
 static ui_context_t ui_ctx;
 static sdmmc_card_t *mounted_card = NULL;
 static char default_track[256] = {0};
 static char default_track_name[64] = {0};
+static uint32_t play_requests = 0; // owned by ui_task
+static char track_names[MAX_TRACKS][64];
+static const char *track_list[MAX_TRACKS];
+static size_t track_count = 0;
 static volatile bool touch_flag = false;
+static spectrum_t spectrum;
+static int16_t spectrum_samples[SPECTRUM_FFT_SIZE];
+// Touching the progress bar hands the encoder from volume to seeking until
+// the button is pressed or it sits idle. Steps only move the target; the UI
+// task issues one seek per frame for wherever it ended up.
+static bool scrubbing = false;
+static bool scrub_pending = false;
+static uint32_t scrub_ms = 0;
+static TickType_t scrub_input = 0;
 
 static void IRAM_ATTR touch_interrupt(void *arg) {
 	(void)arg;
@@ -117,16 +168,23 @@ static esp_err_t init_spi_bus(void) {
 		.sclk_io_num = SCREEN_SCLK,
 		.quadwp_io_num = -1,
 		.quadhd_io_num = -1,
-		.max_transfer_sz = 320 * 40 * 2,
+		.max_transfer_sz = SCREEN_MAX_TRANSFER_BYTES,
 	};
 	ESP_RETURN_ON_ERROR(spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_CH_AUTO), TAG, "SPI bus init failed");
+	const bus_sched_config_t sched_cfg = {
+		.clock_hz = CONFIG_TFT_SPI_SPEED_HZ,
+		.latency_us = CONFIG_SD_BUS_LATENCY_US,
+	};
+	ESP_RETURN_ON_ERROR(bus_sched_init(&bus_sched, &sched_cfg), TAG, "Bus scheduler init failed");
 
 	spi_device_interface_config_t devcfg = {
 		.clock_speed_hz = CONFIG_TFT_SPI_SPEED_HZ,
 		.mode = 0,
 		.spics_io_num = SCREEN_CS,
-		.queue_size = 7,
+		.queue_size = SCREEN_SPI_QUEUE_SIZE,
 		.flags = SPI_DEVICE_NO_DUMMY,
+		.pre_cb = ili9488_spi_pre_transfer_cb,
+		.post_cb = ili9488_spi_post_transfer_cb,
 	};
 	return spi_bus_add_device(SPI2_HOST, &devcfg, &lcd_spi);
 }
@@ -138,6 +196,20 @@ static esp_err_t init_display(void) {
 		.reset_pin = SCREEN_RES,
 		.backlight_pin = SCREEN_BL,
 		.backlight_active_high = true,
+		// Display transfers are sliced so an SD read for audio never waits
+		// longer than CONFIG_SD_BUS_LATENCY_US behind them.
+		.max_transfer_bytes = bus_sched_slice_bytes(&bus_sched),
+		.spi_queue_size = SCREEN_SPI_QUEUE_SIZE,
+		.bus_hooks = {
+			.queue = bus_sched_lcd_queue,
+			.cancel = bus_sched_lcd_cancel,
+			.start = bus_sched_lcd_start,
+			.done = bus_sched_lcd_done,
+			.user_data = &bus_sched,
+		},
+#ifdef CONFIG_TFT_PIXEL_FORMAT_RGB666
+		.pixel_format = ILI9488_PIXEL_FORMAT_RGB666,
+#endif
 	};
 	ESP_RETURN_ON_ERROR(ili9488_init(&lcd, &cfg), TAG, "LCD init failed");
 	return ili9488_fill_color(&lcd, 0, 0, ILI9488_WIDTH, ILI9488_HEIGHT, 0x0000);
@@ -187,18 +259,20 @@ static void list_music_files(const char *path) {
 	closedir(dir);
 }
 
-static bool find_first_wav(const char *path, char *out_path, size_t len) {
+// The player tells formats apart by content; the extension only picks files.
+static bool is_audio_file(const char *name) {
+	const char *dot = strrchr(name, '.');
+	return dot && (strcasecmp(dot, ".wav") == 0 || strcasecmp(dot, ".flac") == 0);
+}
+
+static bool find_first_track(const char *path, char *out_path, size_t len) {
 	DIR *dir = opendir(path);
 	if (!dir) {
 		return false;
 	}
 	struct dirent *entry;
 	while ((entry = readdir(dir)) != NULL) {
-		char *dot = strrchr(entry->d_name, '.');
-		if (!dot) {
-			continue;
-		}
-		if (strcasecmp(dot, ".wav") == 0) {
+		if (is_audio_file(entry->d_name)) {
 			snprintf(out_path, len, "%s/%s", path, entry->d_name);
 			closedir(dir);
 			return true;
@@ -208,6 +282,48 @@ static bool find_first_wav(const char *path, char *out_path, size_t len) {
 	return false;
 }
 
+static void load_track_list(const char *path) {
+	DIR *dir = opendir(path);
+	if (!dir) {
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL && track_count < MAX_TRACKS) {
+		if (!is_audio_file(entry->d_name)) {
+			continue;
+		}
+		if (strlen(entry->d_name) >= sizeof(track_names[0])) {
+			ESP_LOGW(TAG, "Skipping %s: name too long", entry->d_name);
+			continue;
+		}
+		strcpy(track_names[track_count], entry->d_name);
+		track_list[track_count] = track_names[track_count];
+		track_count++;
+	}
+	closedir(dir);
+	ESP_LOGI(TAG, "%u tracks in %s", (unsigned)track_count, path);
+}
+
+// Prefers <track>.jpg next to the audio file, then cover.jpg in the same directory.
+static bool find_album_art(const char *track_path, char *out_path, size_t len) {
+	struct stat st;
+	const char *dot = strrchr(track_path, '.');
+	const char *slash = strrchr(track_path, '/');
+	if (dot && dot > slash) {
+		snprintf(out_path, len, "%.*s.jpg", (int)(dot - track_path), track_path);
+		if (stat(out_path, &st) == 0) {
+			return true;
+		}
+	}
+	if (slash) {
+		snprintf(out_path, len, "%.*s/cover.jpg", (int)(slash - track_path), track_path);
+		if (stat(out_path, &st) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static esp_err_t init_touch(void) {
 	gt911_config_t cfg = {
 		.i2c_port = I2C_NUM_0,
@@ -231,6 +347,14 @@ static esp_err_t init_encoder(void) {
 	return encoder_init(&encoder_handle, &cfg);
 }
 
+static void audio_bus_read(bool begin, void *user_data) {
+	if (begin) {
+		bus_sched_sd_begin(user_data);
+	} else {
+		bus_sched_sd_end(user_data);
+	}
+}
+
 static esp_err_t init_audio(void) {
 	audio_i2s_config_t cfg = {
 		.port = I2S_NUM_0,
@@ -238,7 +362,13 @@ static esp_err_t init_audio(void) {
 		.bclk_pin = I2S_BCLK,
 		.lrclk_pin = I2S_LRCLK,
 		.dout_pin = I2S_DOUT,
-		.sample_rate_hz = 44100,
+		.sample_rate_hz = AUDIO_SAMPLE_RATE_HZ,
+#ifdef CONFIG_AUDIO_RECLOCK_PER_TRACK
+		.reclock_per_track = true,
+#endif
+		.prefetch_blocks = CONFIG_AUDIO_PREFETCH_BLOCKS,
+		.read_callback = audio_bus_read,
+		.read_user_data = &bus_sched,
 	};
 	return audio_init(&cfg);
 }
@@ -302,10 +432,17 @@ static void audio_task(void *arg) {
 				case AUDIO_CMD_BEEP:
 					audio_play_beep(880.0f, 120, 0.35f);
 					break;
-				case AUDIO_CMD_PLAY_WAV:
-					ESP_LOGI(TAG, "Playing %s", cmd.path);
-					audio_play_wav_file(cmd.path);
+				case AUDIO_CMD_PLAY_WAV: {
+					// One superseded while queued is skipped without opening it.
+					if (cmd.stops == audio_get_stop_count()) {
+						ESP_LOGI(TAG, "Playing %s", cmd.path);
+						audio_play_wav_file(cmd.path, cmd.stops);
+					}
+					// Stopped, failed or played out: the UI stops showing it as playing.
+					input_event_t end = {.type = INPUT_EVENT_TRACK_END, .data.play_request = cmd.play_request};
+					xQueueSend(input_queue, &end, portMAX_DELAY);
 					break;
+				}
 				case AUDIO_CMD_STOP:
 					audio_request_stop();
 					break;
@@ -316,60 +453,250 @@ static void audio_task(void *arg) {
 	}
 }
 
+static void play_default_track(void) {
+	if (default_track[0] == '\0') {
+		ESP_LOGW(TAG, "No track available");
+		ui_set_play_state(&ui_ctx, false);
+		return;
+	}
+	// The audio task is busy until the current track, paused or not, ends.
+	// Stop whatever it has, even a track still opening its file; this one
+	// only answers to stops that come after it.
+	audio_request_stop();
+	audio_command_t play = {
+		.type = AUDIO_CMD_PLAY_WAV,
+		.play_request = ++play_requests,
+		.stops = audio_get_stop_count(),
+	};
+	strncpy(play.path, default_track, sizeof(play.path) - 1);
+	play.path[sizeof(play.path) - 1] = '\0';
+	xQueueSend(audio_queue, &play, portMAX_DELAY);
+	const char *name = default_track_name[0] ? default_track_name : default_track;
+	ui_set_track(&ui_ctx, name);
+	char art[sizeof(ui_ctx.art_path)];
+	ui_set_album_art(&ui_ctx, find_album_art(default_track, art, sizeof(art)) ? art : NULL);
+	ui_set_play_state(&ui_ctx, true);
+}
+
+static void browser_handle_input(const input_event_t *evt) {
+	switch (evt->type) {
+		case INPUT_EVENT_ENCODER_LEFT:
+			ui_browser_move(&ui_ctx, -1);
+			break;
+		case INPUT_EVENT_ENCODER_RIGHT:
+			ui_browser_move(&ui_ctx, 1);
+			break;
+		case INPUT_EVENT_ENCODER_BUTTON: {
+			const char *name = track_list[ui_ctx.browser.selected];
+			snprintf(default_track, sizeof(default_track), "%s/%s", MUSIC_DIR, name);
+			strcpy(default_track_name, name);
+			ui_browser_close(&ui_ctx);
+			play_default_track();
+			break;
+		}
+		case INPUT_EVENT_TOUCH:
+			ui_browser_close(&ui_ctx);
+			break;
+		default:
+			break;
+	}
+}
+
+static void scrub_end(void) {
+	scrubbing = false;
+	ui_set_scrubbing(&ui_ctx, false);
+}
+
+static void scrub_handle_input(const input_event_t *evt) {
+	scrub_input = xTaskGetTickCount();
+	switch (evt->type) {
+		case INPUT_EVENT_ENCODER_LEFT:
+			scrub_ms = scrub_ms > CONFIG_UI_SCRUB_STEP_MS ? scrub_ms - CONFIG_UI_SCRUB_STEP_MS : 0;
+			scrub_pending = true;
+			break;
+		case INPUT_EVENT_ENCODER_RIGHT: {
+			uint32_t duration = audio_get_duration_ms();
+			scrub_ms += CONFIG_UI_SCRUB_STEP_MS;
+			if (duration > 0 && scrub_ms >= duration) {
+				scrub_ms = duration - 1;
+			}
+			scrub_pending = true;
+			break;
+		}
+		default:
+			scrub_end();
+			return;
+	}
+	ui_set_progress(&ui_ctx, scrub_ms, audio_get_duration_ms());
+}
+
+static void ui_handle_input(const input_event_t *evt) {
+	if (evt->type == INPUT_EVENT_TRACK_END) {
+		// Ends of tracks a newer request already replaced don't count.
+		if (evt->data.play_request == play_requests) {
+			ui_set_play_state(&ui_ctx, false);
+		}
+		return;
+	}
+	if (ui_ctx.screen == UI_SCREEN_TRACKS) {
+		browser_handle_input(evt);
+		return;
+	}
+	if (scrubbing) {
+		scrub_handle_input(evt);
+		return;
+	}
+	switch (evt->type) {
+		case INPUT_EVENT_ENCODER_LEFT: {
+			uint8_t vol = ui_ctx.volume_percent > 5 ? ui_ctx.volume_percent - 5 : 0;
+			ui_set_volume(&ui_ctx, vol);
+			audio_set_volume(ui_ctx.volume_percent);
+			break;
+		}
+		case INPUT_EVENT_ENCODER_RIGHT: {
+			uint8_t vol = ui_ctx.volume_percent + 5;
+			if (vol > 100) {
+				vol = 100;
+			}
+			ui_set_volume(&ui_ctx, vol);
+			audio_set_volume(ui_ctx.volume_percent);
+			break;
+		}
+		case INPUT_EVENT_ENCODER_BUTTON:
+			// Pause holds the open track; only a track that isn't playing
+			// at all starts over.
+			if (ui_ctx.is_playing) {
+				ui_set_play_state(&ui_ctx, false);
+				audio_set_paused(true);
+			} else if (audio_set_paused(false) == ESP_OK) {
+				ui_set_play_state(&ui_ctx, true);
+			} else {
+				play_default_track();
+			}
+			break;
+		case INPUT_EVENT_TOUCH:
+			if (audio_is_playing() && audio_get_duration_ms() > 0 && ui_progress_hit(&ui_ctx, evt->data.touch.x, evt->data.touch.y)) {
+				scrubbing = true;
+				scrub_ms = audio_get_position_ms();
+				scrub_input = xTaskGetTickCount();
+				ui_set_scrubbing(&ui_ctx, true);
+			} else if (track_count > 0) {
+				size_t selected = 0;
+				for (size_t i = 0; i < track_count; ++i) {
+					if (strcmp(track_list[i], default_track_name) == 0) {
+						selected = i;
+						break;
+					}
+				}
+				ui_browser_open(&ui_ctx, track_list, track_count, selected);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
 static void ui_task(void *arg) {
 	(void)arg;
 	input_event_t evt;
 	ui_draw_boot_screen(&ui_ctx);
+#ifdef CONFIG_UI_RUN_BENCHMARKS
+	ui_benchmark_text(&ui_ctx, 50);
+	ui_benchmark_pixel_formats(&ui_ctx, 10);
+	ui_benchmark_blend(&ui_ctx, 20);
+	ui_redraw(&ui_ctx);
+#endif
+
+	ili9488_pool_stats_t pool_stats;
+	ili9488_get_pool_stats(&lcd, &pool_stats);
+	ESP_LOGI(TAG, "LCD DMA pool: %u x %u bytes, high-water %u, stalls %lu", pool_stats.buffer_count, (unsigned)pool_stats.chunk_bytes, pool_stats.high_water, (unsigned long)pool_stats.stalls);
 
 	audio_command_t beep = {.type = AUDIO_CMD_BEEP};
 	xQueueSend(audio_queue, &beep, portMAX_DELAY);
 
+	// Input only updates UI state; the panel is redrawn at most once per
+	// frame period with whatever the latest state is.
+	TickType_t frame_ticks = pdMS_TO_TICKS(1000 / CONFIG_UI_MAX_FPS);
+	if (frame_ticks == 0) {
+		frame_ticks = 1;
+	}
+	TickType_t last_frame = xTaskGetTickCount();
+	uint32_t logged_frames = 0;
+	bool spectrum_active = false;
+	uint32_t spectrum_rate = AUDIO_SAMPLE_RATE_HZ;
+
 	while (true) {
-		if (xQueueReceive(input_queue, &evt, portMAX_DELAY) != pdPASS) {
-			continue;
+		// The spectrum runs on this core at the frame rate while there is
+		// audio and until its bars have fallen; the audio task on core 0
+		// only ever copies into the tap.
+		bool animating = audio_is_playing() || spectrum_active;
+		TickType_t wait = portMAX_DELAY;
+		if (animating || ui_needs_flush(&ui_ctx)) {
+			TickType_t elapsed = xTaskGetTickCount() - last_frame;
+			wait = elapsed >= frame_ticks ? 0 : frame_ticks - elapsed;
 		}
 
-		switch (evt.type) {
-			case INPUT_EVENT_ENCODER_LEFT: {
-				uint8_t vol = ui_ctx.volume_percent > 5 ? ui_ctx.volume_percent - 5 : 0;
-				ui_set_volume(&ui_ctx, vol);
-				break;
-			}
-			case INPUT_EVENT_ENCODER_RIGHT: {
-				uint8_t vol = ui_ctx.volume_percent + 5;
-				if (vol > 100) {
-					vol = 100;
-				}
-				ui_set_volume(&ui_ctx, vol);
-				break;
+		if (xQueueReceive(input_queue, &evt, wait) == pdPASS) {
+			do {
+				ui_handle_input(&evt);
+			} while (xQueueReceive(input_queue, &evt, 0) == pdPASS);
+		}
+
+		TickType_t now = xTaskGetTickCount();
+		if (now - last_frame < frame_ticks || !(animating || ui_needs_flush(&ui_ctx))) {
+			continue;
+		}
+		last_frame = now;
+		if (animating) {
+			// Bands follow I2S when a track re-clocks it.
+			uint32_t rate = audio_get_output_rate();
+			if (rate != spectrum_rate && spectrum_init(&spectrum, rate, UI_SPECTRUM_BANDS) == ESP_OK) {
+				spectrum_rate = rate;
 			}
-			case INPUT_EVENT_ENCODER_BUTTON: {
-				bool new_state = !ui_ctx.is_playing;
-				ui_set_play_state(&ui_ctx, new_state);
-				if (new_state) {
-					if (default_track[0] != '\0') {
-						audio_command_t play = {
-							.type = AUDIO_CMD_PLAY_WAV,
-						};
-						strncpy(play.path, default_track, sizeof(play.path) - 1);
-						play.path[sizeof(play.path) - 1] = '\0';
-						xQueueSend(audio_queue, &play, portMAX_DELAY);
-						const char *name = default_track_name[0] ? default_track_name : default_track;
-						ui_set_track(&ui_ctx, name);
-					} else {
-						ESP_LOGW(TAG, "No WAV file available");
-						ui_set_play_state(&ui_ctx, false);
-					}
-				} else {
-					audio_request_stop();
-				}
-				break;
+			bool fresh = audio_tap_read(spectrum_samples, SPECTRUM_FFT_SIZE);
+			spectrum_active = spectrum_process(&spectrum, fresh ? spectrum_samples : NULL);
+			ui_set_spectrum(&ui_ctx, spectrum.levels, spectrum.band_count);
+		}
+		if (scrub_pending) {
+			scrub_pending = false;
+			if (audio_seek_ms(scrub_ms) != ESP_OK) {
+				scrub_end();
 			}
-			case INPUT_EVENT_TOUCH:
-				ESP_LOGI(TAG, "Touch event forwarded to UI");
-				break;
-			default:
-				break;
+		}
+		if (scrubbing && (!audio_is_playing() || now - scrub_input >= pdMS_TO_TICKS(CONFIG_UI_SCRUB_TIMEOUT_MS))) {
+			scrub_end();
+		}
+		if (!scrubbing) {
+			ui_set_progress(&ui_ctx, audio_get_position_ms(), audio_get_duration_ms());
+		}
+		if (ui_needs_flush(&ui_ctx)) {
+			ui_flush(&ui_ctx);
+		}
+
+		if (ui_ctx.stats.frames - logged_frames >= 100) {
+			logged_frames = ui_ctx.stats.frames;
+			ESP_LOGI(TAG, "UI: %lu frames, %lu coalesced updates, last %lu us, max %lu us", (unsigned long)ui_ctx.stats.frames,
+					 (unsigned long)ui_ctx.stats.coalesced, (unsigned long)ui_ctx.stats.last_frame_us, (unsigned long)ui_ctx.stats.max_frame_us);
+			ESP_LOGI(TAG, "Spectrum: FFT %lu us (max %lu), bars %lu us for %lu px", (unsigned long)spectrum.stats.fft_us,
+					 (unsigned long)spectrum.stats.max_fft_us, (unsigned long)ui_ctx.stats.spectrum_us, (unsigned long)ui_ctx.stats.spectrum_px);
+			audio_buffer_status_t buffer;
+			audio_get_buffer_status(&buffer);
+			ESP_LOGI(TAG, "Audio ring: %u/%u blocks%s, low-water %u, %lu underruns, slowest read %lu us, seek %lu us (max %lu), stop %lu us (max %lu)",
+					 buffer.filled, buffer.blocks, audio_is_buffered() ? "" : " (buffering)", buffer.low_water, (unsigned long)buffer.underruns,
+					 (unsigned long)buffer.max_read_us, (unsigned long)buffer.seek_us, (unsigned long)buffer.max_seek_us, (unsigned long)buffer.stop_us,
+					 (unsigned long)buffer.max_stop_us);
+			audio_dsp_stats_t dsp;
+			audio_get_dsp_stats(&dsp);
+			ESP_LOGI(TAG, "Audio DSP at %lu Hz, decode %lu us/frame (max %lu), us per 16 KB: convert %lu (max %lu), resample %lu (max %lu), gain %lu (max %lu)",
+					 (unsigned long)audio_get_output_rate(), (unsigned long)dsp.decode_frame_us, (unsigned long)dsp.max_decode_frame_us,
+					 (unsigned long)dsp.convert_us_per_16k, (unsigned long)dsp.max_convert_us_per_16k, (unsigned long)dsp.resample_us_per_16k,
+					 (unsigned long)dsp.max_resample_us_per_16k, (unsigned long)dsp.gain_us_per_16k, (unsigned long)dsp.max_gain_us_per_16k);
+			bus_sched_stats_t lcd_bus, sd_bus;
+			bus_sched_get_stats(&bus_sched, BUS_SCHED_CLIENT_LCD, &lcd_bus);
+			bus_sched_get_stats(&bus_sched, BUS_SCHED_CLIENT_SD, &sd_bus);
+			ESP_LOGI(TAG, "SPI2: LCD %u%% busy, max wait %lu us; SD %u%% busy, max wait %lu us (%lu over %lu us)", lcd_bus.occupancy_pct,
+					 (unsigned long)lcd_bus.max_wait_us, sd_bus.occupancy_pct, (unsigned long)sd_bus.max_wait_us, (unsigned long)sd_bus.over_bound,
+					 (unsigned long)bus_sched.latency_us);
 		}
 	}
 }
@@ -394,12 +721,18 @@ void app_main(void) {
 		.display = &lcd,
 		.background_color = 0,
 		.accent_color = 0,
+		.art_cache_dir = ART_CACHE_DIR,
+		.art_cache_max_bytes = CONFIG_UI_ART_CACHE_KB * 1024,
 	};
 	ESP_ERROR_CHECK(ui_init(&ui_ctx, &ui_cfg));
+	ESP_ERROR_CHECK(spectrum_init(&spectrum, AUDIO_SAMPLE_RATE_HZ, UI_SPECTRUM_BANDS));
+	audio_set_volume(ui_ctx.volume_percent);
+	ui_draw_splash(&ui_ctx);
 
 	if (mount_sd() == ESP_OK) {
 		list_music_files(MUSIC_DIR);
-		if (find_first_wav(MUSIC_DIR, default_track, sizeof(default_track))) {
+		load_track_list(MUSIC_DIR);
+		if (find_first_track(MUSIC_DIR, default_track, sizeof(default_track))) {
 			ESP_LOGI(TAG, "Default track: %s", default_track);
 			const char *name = strrchr(default_track, '/');
 			name = name ? name + 1 : default_track;
@@ -408,7 +741,7 @@ void app_main(void) {
 			default_track_name[sizeof(default_track_name) - 1] = '\0';
 			ui_set_track(&ui_ctx, default_track_name);
 		} else {
-			ESP_LOGW(TAG, "No WAV files found in %s", MUSIC_DIR);
+			ESP_LOGW(TAG, "No WAV or FLAC files found in %s", MUSIC_DIR);
 		}
 	}
 
@@ -0,0 +1,310 @@
+// FreeRTOS on pthreads with a virtual clock. Tasks are ordinary threads, but
+// the clock only moves once every task is blocked, and then jumps straight to
+// the earliest timeout. Timing-dependent tests are exact and take no real
+// time, and a state where nothing can ever wake up aborts as a deadlock
+// instead of hanging the test run.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_rtos.h"
+
+#define HOST_RTOS_MAX_WAITERS 32
+#define HOST_RTOS_FOREVER INT64_MAX
+
+struct host_queue_s {
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+    uint8_t *items;
+};
+
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+} host_task_start_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static int64_t s_now_us;
+static int s_runnable = 1; // the thread running main()
+static int s_pending;      // woken by the last broadcast, not yet rechecked
+static uint64_t s_epoch;
+static int64_t s_deadlines[HOST_RTOS_MAX_WAITERS];
+static bool s_waiting[HOST_RTOS_MAX_WAITERS];
+
+int64_t esp_timer_get_time(void) {
+    return __atomic_load_n(&s_now_us, __ATOMIC_ACQUIRE);
+}
+
+// Every waiter rechecks what it is waiting for. Lock held.
+static void host_rtos_wake_all(void) {
+    s_pending = 0;
+    for (int i = 0; i < HOST_RTOS_MAX_WAITERS; ++i) {
+        s_pending += s_waiting[i];
+    }
+    s_epoch++;
+    pthread_cond_broadcast(&s_cond);
+}
+
+// Everyone is blocked: move the clock to the first timeout. Lock held.
+static void host_rtos_advance(void) {
+    int64_t next = HOST_RTOS_FOREVER;
+    for (int i = 0; i < HOST_RTOS_MAX_WAITERS; ++i) {
+        if (s_waiting[i] && s_deadlines[i] < next) {
+            next = s_deadlines[i];
+        }
+    }
+    if (next == HOST_RTOS_FOREVER) {
+        fprintf(stderr, "host_rtos: deadlock, every task is blocked forever at %lld us\n", (long long)s_now_us);
+        abort();
+    }
+    if (next > s_now_us) {
+        __atomic_store_n(&s_now_us, next, __ATOMIC_RELEASE);
+    }
+    host_rtos_wake_all();
+}
+
+// Blocks until the next wake-up or the deadline; the caller rechecks its
+// condition. Lock held.
+static void host_rtos_block(int64_t deadline) {
+    int slot = 0;
+    while (slot < HOST_RTOS_MAX_WAITERS && s_waiting[slot]) {
+        slot++;
+    }
+    if (slot == HOST_RTOS_MAX_WAITERS) {
+        fprintf(stderr, "host_rtos: too many blocked tasks\n");
+        abort();
+    }
+    s_waiting[slot] = true;
+    s_deadlines[slot] = deadline;
+    s_runnable--;
+    uint64_t epoch = s_epoch;
+    if (s_runnable == 0 && s_pending == 0) {
+        host_rtos_advance();
+    }
+    while (epoch == s_epoch) {
+        pthread_cond_wait(&s_cond, &s_lock);
+    }
+    s_waiting[slot] = false;
+    s_pending--;
+    s_runnable++;
+}
+
+static int64_t host_rtos_deadline(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? HOST_RTOS_FOREVER : s_now_us + (int64_t)ticks * 1000;
+}
+
+static void host_rtos_sleep_until(int64_t deadline) {
+    pthread_mutex_lock(&s_lock);
+    while (s_now_us < deadline) {
+        host_rtos_block(deadline);
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void host_rtos_sleep_us(int64_t us) {
+    host_rtos_sleep_until(esp_timer_get_time() + us);
+}
+
+static void *host_rtos_task_main(void *arg) {
+    host_task_start_t start = *(host_task_start_t *)arg;
+    free(arg);
+    start.fn(start.arg);
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+    host_task_start_t *start = malloc(sizeof(*start));
+    if (!start) {
+        return pdFAIL;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    pthread_mutex_lock(&s_lock);
+    s_runnable++;
+    pthread_mutex_unlock(&s_lock);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, host_rtos_task_main, start) != 0) {
+        free(start);
+        pthread_mutex_lock(&s_lock);
+        s_runnable--;
+        pthread_mutex_unlock(&s_lock);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (handle) {
+        *handle = (TaskHandle_t)start;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    return xTaskCreate(fn, name, stack, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task) {
+        fprintf(stderr, "host_rtos: only self-deletion is supported\n");
+        abort();
+    }
+    pthread_mutex_lock(&s_lock);
+    s_runnable--;
+    if (s_runnable == 0 && s_pending == 0) {
+        host_rtos_advance();
+    }
+    pthread_mutex_unlock(&s_lock);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    host_rtos_sleep_us((int64_t)ticks * 1000);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous, TickType_t increment) {
+    *previous += increment;
+    host_rtos_sleep_until((int64_t)*previous * 1000);
+    return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void) {
+    return xTaskGetTickCount();
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    QueueHandle_t queue = calloc(1, sizeof(*queue));
+    if (!queue) {
+        return NULL;
+    }
+    queue->item_size = item_size;
+    queue->length = length;
+    queue->items = item_size ? calloc(length, item_size) : NULL;
+    if (item_size && !queue->items) {
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue) {
+        free(queue->items);
+        free(queue);
+    }
+}
+
+static BaseType_t host_queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool overwrite) {
+    pthread_mutex_lock(&s_lock);
+    int64_t deadline = host_rtos_deadline(ticks);
+    while (queue->count == queue->length && !overwrite) {
+        if (s_now_us >= deadline) {
+            pthread_mutex_unlock(&s_lock);
+            return errQUEUE_FULL;
+        }
+        host_rtos_block(deadline);
+    }
+    if (queue->count == queue->length) {
+        queue->count--;
+    }
+    if (queue->item_size) {
+        size_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    host_rtos_wake_all();
+    pthread_mutex_unlock(&s_lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return host_queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return host_queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken) {
+    return host_queue_send(queue, item, 0, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    return host_queue_send(queue, item, 0, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    pthread_mutex_lock(&s_lock);
+    int64_t deadline = host_rtos_deadline(ticks);
+    while (queue->count == 0) {
+        if (s_now_us >= deadline) {
+            pthread_mutex_unlock(&s_lock);
+            return pdFALSE;
+        }
+        host_rtos_block(deadline);
+    }
+    if (queue->item_size) {
+        memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    host_rtos_wake_all();
+    pthread_mutex_unlock(&s_lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&s_lock);
+    queue->head = 0;
+    queue->count = 0;
+    host_rtos_wake_all();
+    pthread_mutex_unlock(&s_lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&s_lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&s_lock);
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+    SemaphoreHandle_t sem = xQueueCreate(max, 0);
+    if (sem) {
+        sem->count = initial;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    return xQueueReceive(sem, NULL, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return xQueueSend(sem, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken) {
+    return xQueueSend(sem, NULL, 0);
+}
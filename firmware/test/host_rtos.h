@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+// Sleeps the calling task for a number of virtual microseconds; lets test
+// models of peripherals take exactly as long as the hardware would.
+void host_rtos_sleep_us(int64_t us);
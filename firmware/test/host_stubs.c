@@ -0,0 +1,10 @@
+// What the components need from ESP-IDF that isn't a header-only stand-in;
+// the clock and the RTOS are in host_rtos.c.
+#include "esp_err.h"
+
+const char *esp_err_to_name(esp_err_t code) {
+    (void)code;
+    return "esp_err";
+}
+
+int host_test_failures;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Fails the test with file and line; tests keep going so one run reports
+// every broken case.
+#define CHECK(cond, fmt, ...)                                                                    \
+    do {                                                                                         \
+        if (!(cond)) {                                                                           \
+            fprintf(stderr, "%s:%d: check failed: %s: " fmt "\n", __FILE__, __LINE__, #cond, ##__VA_ARGS__); \
+            host_test_failures++;                                                                \
+        }                                                                                        \
+    } while (0)
+
+extern int host_test_failures;
+
+static inline uint32_t host_fnv1a(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#define HOST_FNV1A_INIT 2166136261u
+
+static inline int host_test_result(const char *name) {
+    if (host_test_failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, host_test_failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: ok\n", name);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+} gpio_num_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    int mode;
+    int pull_up_en;
+    int pull_down_en;
+    int intr_type;
+} gpio_config_t;
+
+#define GPIO_MODE_OUTPUT 2
+#define GPIO_PULLUP_DISABLE 0
+#define GPIO_PULLDOWN_DISABLE 0
+#define GPIO_INTR_DISABLE 0
+
+// No pins on the host: configuring and driving them does nothing.
+static inline esp_err_t gpio_config(const gpio_config_t *config) {
+    (void)config;
+    return ESP_OK;
+}
+
+static inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    (void)pin;
+    (void)level;
+    return ESP_OK;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// The legacy I2S driver API the audio component uses. Tests that link it
+// provide the functions as a model of the DMA ring.
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum {
+    I2S_NUM_0 = 0,
+    I2S_NUM_1,
+} i2s_port_t;
+
+typedef enum {
+    I2S_BITS_PER_SAMPLE_16BIT = 16,
+    I2S_BITS_PER_SAMPLE_24BIT = 24,
+    I2S_BITS_PER_SAMPLE_32BIT = 32,
+} i2s_bits_per_sample_t;
+
+typedef enum {
+    I2S_CHANNEL_MONO = 1,
+    I2S_CHANNEL_STEREO = 2,
+} i2s_channel_t;
+
+typedef enum {
+    I2S_EVENT_DMA_ERROR,
+    I2S_EVENT_TX_DONE,
+    I2S_EVENT_RX_DONE,
+    I2S_EVENT_TX_Q_OVF,
+    I2S_EVENT_RX_Q_OVF,
+} i2s_event_type_t;
+
+typedef struct {
+    i2s_event_type_t type;
+    size_t size;
+} i2s_event_t;
+
+#define I2S_MODE_MASTER (1 << 0)
+#define I2S_MODE_TX (1 << 2)
+#define I2S_CHANNEL_FMT_RIGHT_LEFT 0
+#define I2S_COMM_FORMAT_STAND_I2S 1
+#define I2S_MCLK_MULTIPLE_256 256
+#define I2S_PIN_NO_CHANGE -1
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+
+typedef struct {
+    int mode;
+    int sample_rate;
+    int bits_per_sample;
+    int channel_format;
+    int communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;
+    bool use_apll;
+    bool tx_desc_auto_clear;
+    int mclk_multiple;
+} i2s_config_t;
+
+typedef struct {
+    int mck_io_num;
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, void *queue);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins);
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, uint32_t bits, i2s_channel_t channels);
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *written, TickType_t ticks);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port);
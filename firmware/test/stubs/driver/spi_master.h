@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef struct spi_device_t *spi_device_handle_t;
+
+#define SPI_TRANS_USE_TXDATA (1 << 3)
+
+typedef struct spi_transaction_t {
+    uint32_t flags;
+    uint16_t cmd;
+    uint64_t addr;
+    size_t length;
+    size_t rxlength;
+    void *user;
+    union {
+        const void *tx_buffer;
+        uint8_t tx_data[4];
+    };
+    union {
+        void *rx_buffer;
+        uint8_t rx_data[4];
+    };
+} spi_transaction_t;
+
+// Tests that link a driver only use its pure helpers; a transfer fails.
+static inline esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+    (void)handle;
+    (void)trans;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t wait) {
+    (void)handle;
+    (void)trans;
+    (void)wait;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t wait) {
+    (void)handle;
+    (void)trans;
+    (void)wait;
+    return ESP_ERR_NOT_SUPPORTED;
+}
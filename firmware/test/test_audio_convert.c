@@ -0,0 +1,233 @@
+// Checks the WAV sample converters bit for bit against a straightforward
+// reference: integer maths on whole samples, floor division and a plain
+// double-precision float path. The TPDF dither is seeded so the reference
+// can replay it; the schedule it follows is the converters' contract: pairs
+// of samples share one xorshift draw (low half, then high half) and samples
+// left over at the end draw alone.
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_convert.h"
+#include "host_test.h"
+
+#define MAX_FRAMES 4099
+#define DITHER_SEED 0x9E3779B9u
+
+static uint8_t s_input[MAX_FRAMES * 8] __attribute__((aligned(4)));
+static uint8_t s_buf[MAX_FRAMES * 8] __attribute__((aligned(4)));
+static int16_t s_expected[MAX_FRAMES * 2];
+static uint32_t s_fill_state = 12345;
+
+static uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static int16_t ref_sat16(double v) {
+    return v >= INT16_MAX ? INT16_MAX : (v <= INT16_MIN ? INT16_MIN : (int16_t)v);
+}
+
+// 24-bit to 16-bit: add a triangular dither of up to one output LSB, then
+// round to nearest.
+static int16_t ref_s24(int32_t v, uint32_t r) {
+    int d = (int)(r & 0xFF) - (int)((r >> 8) & 0xFF);
+    return ref_sat16(floor((v + d + 128) / 256.0));
+}
+
+static int16_t ref_f32(float f, uint32_t r) {
+    if (isnan(f)) {
+        return INT16_MIN;
+    }
+    double d = ((int)(r & 0xFFFF) - (int)(r >> 16)) / 65536.0;
+    double v = (float)((double)f * 32768.0 + d);
+    return ref_sat16(round(v));
+}
+
+// The draw for sample i of count when draws are shared by pairs.
+static uint32_t ref_pair_draw(uint32_t *state, size_t i, uint32_t *held) {
+    if (i % 2 == 0) {
+        *held = xorshift(state);
+        return *held;
+    }
+    return *held >> 16;
+}
+
+static int32_t read_s24(const uint8_t *p) {
+    return (int32_t)(((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)) << 8) >> 8;
+}
+
+static void ref_convert(const uint8_t *in, size_t frames, const audio_pcm_format_t *format) {
+    const size_t count = frames * format->channels;
+    int16_t samples[MAX_FRAMES * 2];
+    uint32_t state = DITHER_SEED;
+    uint32_t held = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *p = in + i * audio_sample_bytes(format->sample);
+        switch (format->sample) {
+            case AUDIO_SAMPLE_S16:
+                samples[i] = (int16_t)(p[0] | (p[1] << 8));
+                break;
+            case AUDIO_SAMPLE_U8:
+                samples[i] = (int16_t)((p[0] - 128) * 256);
+                break;
+            case AUDIO_SAMPLE_S24:
+                // Whole groups of four share draws by pairs, the tail draws alone.
+                samples[i] = ref_s24(read_s24(p), i < (count & ~(size_t)3) ? ref_pair_draw(&state, i, &held)
+                                                                            : xorshift(&state));
+                break;
+            case AUDIO_SAMPLE_S32: {
+                int32_t v;
+                memcpy(&v, p, sizeof(v));
+                samples[i] = ref_s24(v >> 8, ref_pair_draw(&state, i, &held));
+                break;
+            }
+            case AUDIO_SAMPLE_F32: {
+                float f;
+                memcpy(&f, p, sizeof(f));
+                samples[i] = ref_f32(f, xorshift(&state));
+                break;
+            }
+        }
+    }
+    for (size_t f = 0; f < frames; ++f) {
+        s_expected[f * 2] = samples[f * format->channels];
+        s_expected[f * 2 + 1] = samples[f * format->channels + format->channels - 1];
+    }
+}
+
+static void fill_input(const audio_pcm_format_t *format, size_t frames) {
+    const size_t count = frames * format->channels;
+    for (size_t i = 0; i < count * audio_sample_bytes(format->sample); ++i) {
+        s_input[i] = (uint8_t)xorshift(&s_fill_state);
+    }
+    // Full scale, both rails and the awkward floats, spread through the data.
+    static const int32_t s24_edges[] = {0x7FFFFF, -0x800000, 0, -1, 0x7F, 0x80, -0x80, -0x81};
+    static const float f32_edges[] = {1.0f, -1.0f, 1.5f, -1.5f, 0.0f, -0.0f, 1e-9f, 0.99999994f, -1.0000001f};
+    for (size_t i = 0, e = 0; i < count; i += 53, ++e) {
+        uint8_t *p = s_input + i * audio_sample_bytes(format->sample);
+        if (format->sample == AUDIO_SAMPLE_S24) {
+            int32_t v = s24_edges[e % 8];
+            p[0] = (uint8_t)v;
+            p[1] = (uint8_t)(v >> 8);
+            p[2] = (uint8_t)(v >> 16);
+        } else if (format->sample == AUDIO_SAMPLE_S32) {
+            int32_t v = (int32_t)((uint32_t)s24_edges[e % 8] << 8) | (int32_t)(e & 0xFF);
+            memcpy(p, &v, sizeof(v));
+        }
+    }
+    if (format->sample == AUDIO_SAMPLE_F32) {
+        for (size_t i = 0; i < count; ++i) {
+            float f = (float)((int32_t)xorshift(&s_fill_state) / 2147483648.0 * 1.2);
+            if (i % 53 == 0) {
+                f = f32_edges[(i / 53) % 9];
+            }
+            if (i % 211 == 7) {
+                f = (i / 211) % 3 == 0 ? NAN : ((i / 211) % 3 == 1 ? INFINITY : -INFINITY);
+            }
+            memcpy(s_input + i * 4, &f, sizeof(f));
+        }
+    }
+}
+
+static void test_convert_frames(audio_sample_format_t sample, uint8_t channels, size_t frames) {
+    static const char *names[] = {"s16", "u8", "s24", "s32", "f32"};
+    audio_pcm_format_t format = {.sample = sample, .channels = channels};
+    fill_input(&format, frames);
+    ref_convert(s_input, frames, &format);
+
+    memcpy(s_buf, s_input, frames * audio_pcm_frame_bytes(&format));
+    audio_dither_t dither = {.state = DITHER_SEED};
+    size_t bytes = audio_convert_frames(s_buf, frames, &format, &dither);
+    CHECK(bytes == frames * 4, "%s/%u returned %zu bytes", names[sample], channels, bytes);
+
+    const int16_t *out = (const int16_t *)s_buf;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < frames * 2; ++i) {
+        if (out[i] != s_expected[i] && mismatches++ < 3) {
+            fprintf(stderr, "  %s/%u x %zu: sample %zu is %d, reference %d\n", names[sample], channels, frames, i, out[i],
+                    s_expected[i]);
+        }
+    }
+    CHECK(mismatches == 0, "%s/%u x %zu frames: %zu samples differ", names[sample], channels, frames, mismatches);
+}
+
+static void test_planar(uint8_t bits, bool mono, size_t frames) {
+    int32_t left[MAX_FRAMES], right[MAX_FRAMES];
+    const int32_t max = (1 << (bits - 1)) - 1;
+    for (size_t i = 0; i < frames; ++i) {
+        left[i] = (int32_t)(xorshift(&s_fill_state) % (2u * max + 2)) - max - 1;
+        right[i] = i % 17 == 0 ? max : -left[i] - 1;
+    }
+    const int32_t *r_plane = mono ? left : right;
+    uint32_t state = DITHER_SEED;
+    uint32_t held = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        if (bits <= 16) {
+            s_expected[i * 2] = (int16_t)(left[i] * (1 << (16 - bits)));
+            s_expected[i * 2 + 1] = (int16_t)(r_plane[i] * (1 << (16 - bits)));
+        } else if (mono) {
+            // Both channels of a mono frame take the same dither.
+            uint32_t r = ref_pair_draw(&state, i, &held);
+            s_expected[i * 2] = s_expected[i * 2 + 1] = ref_s24(left[i] * (1 << (24 - bits)), r);
+        } else {
+            uint32_t r = xorshift(&state);
+            s_expected[i * 2] = ref_s24(left[i] * (1 << (24 - bits)), r);
+            s_expected[i * 2 + 1] = ref_s24(right[i] * (1 << (24 - bits)), r >> 16);
+        }
+    }
+    int16_t out[MAX_FRAMES * 2];
+    audio_dither_t dither = {.state = DITHER_SEED};
+    audio_convert_planar(out, left, r_plane, frames, bits, &dither);
+    CHECK(memcmp(out, s_expected, frames * 4) == 0, "planar %u-bit %s x %zu frames differs", bits,
+          mono ? "mono" : "stereo", frames);
+}
+
+// A steady input between two output codes must average out to its true value
+// once dithered, and the dither must never move a sample by more than one LSB
+// either side.
+static void test_dither_is_tpdf(void) {
+    const size_t count = 4096;
+    int32_t *in = (int32_t *)s_buf;
+    for (size_t i = 0; i < count; ++i) {
+        in[i] = (1000 << 8) + 0x40; // 1000.25 output LSBs, as 24 bits in s32
+        in[i] <<= 8;
+    }
+    audio_dither_t dither = {.state = DITHER_SEED};
+    audio_convert_s32(s_buf, count, &dither);
+    const int16_t *out = (const int16_t *)s_buf;
+    double sum = 0;
+    int lo = INT16_MAX, hi = INT16_MIN;
+    for (size_t i = 0; i < count; ++i) {
+        sum += out[i];
+        lo = out[i] < lo ? out[i] : lo;
+        hi = out[i] > hi ? out[i] : hi;
+    }
+    double mean = sum / count;
+    CHECK(fabs(mean - 1000.25) < 0.02, "dithered mean %.4f", mean);
+    CHECK(lo >= 999 && hi <= 1002, "dither spread %d..%d", lo, hi);
+}
+
+int main(void) {
+    static const size_t frame_counts[] = {1, 2, 3, 5, 8, MAX_FRAMES};
+    for (audio_sample_format_t sample = AUDIO_SAMPLE_S16; sample <= AUDIO_SAMPLE_F32; ++sample) {
+        for (uint8_t channels = 1; channels <= 2; ++channels) {
+            for (size_t i = 0; i < sizeof(frame_counts) / sizeof(frame_counts[0]); ++i) {
+                test_convert_frames(sample, channels, frame_counts[i]);
+            }
+        }
+    }
+    static const uint8_t planar_bits[] = {8, 12, 16, 20, 24};
+    for (size_t i = 0; i < sizeof(planar_bits); ++i) {
+        test_planar(planar_bits[i], false, MAX_FRAMES);
+        test_planar(planar_bits[i], true, MAX_FRAMES);
+        test_planar(planar_bits[i], true, 3);
+    }
+    test_dither_is_tpdf();
+    return host_test_result("test_audio_convert");
+}
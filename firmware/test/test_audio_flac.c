@@ -0,0 +1,239 @@
+// Decodes reference FLAC files and checks the decoded samples against the
+// MD5 the encoder stored in STREAMINFO, then checks that the int16 read path
+// and sample-accurate seeks agree with that decode. Built with audio_flac.c
+// included, so the test can see the native-width samples.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+
+#include "audio_flac.c"
+
+typedef struct {
+    const char *name;
+    uint32_t sample_rate;
+    uint8_t channels;
+    uint8_t bps;
+    uint64_t frames;
+    bool length_known;
+} flac_fixture_t;
+
+static const flac_fixture_t s_fixtures[] = {
+    {"s16.flac", 44100, 2, 16, 20000, true},
+    {"m16_seek.flac", 44100, 1, 16, 20000, true},
+    {"s24.flac", 48000, 2, 24, 9000, true},
+    {"m24.flac", 44100, 1, 24, 9000, true},
+    {"m8_id3.flac", 22050, 1, 8, 9000, true},
+    {"m8_nolen.flac", 22050, 1, 8, 9000, false},
+};
+
+size_t audio_source_read(FILE *f, void *dst, size_t bytes) {
+    return fread(dst, 1, bytes, f);
+}
+
+// RFC 1321, just enough to hash a decode.
+typedef struct {
+    uint32_t state[4];
+    uint64_t bytes;
+    uint8_t block[64];
+} md5_t;
+
+static void md5_transform(md5_t *md5, const uint8_t *p) {
+    static const uint32_t k[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+    };
+    static const uint8_t r[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+    };
+    uint32_t w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = p[i * 4] | (p[i * 4 + 1] << 8) | (p[i * 4 + 2] << 16) | ((uint32_t)p[i * 4 + 3] << 24);
+    }
+    uint32_t a = md5->state[0], b = md5->state[1], c = md5->state[2], d = md5->state[3];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        uint32_t t = d;
+        d = c;
+        c = b;
+        uint32_t x = a + f + k[i] + w[g];
+        b += (x << r[i]) | (x >> (32 - r[i]));
+        a = t;
+    }
+    md5->state[0] += a;
+    md5->state[1] += b;
+    md5->state[2] += c;
+    md5->state[3] += d;
+}
+
+static void md5_init(md5_t *md5) {
+    *md5 = (md5_t){.state = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476}};
+}
+
+static void md5_update(md5_t *md5, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        md5->block[md5->bytes++ % 64] = p[i];
+        if (md5->bytes % 64 == 0) {
+            md5_transform(md5, md5->block);
+        }
+    }
+}
+
+static void md5_final(md5_t *md5, uint8_t out[16]) {
+    uint64_t bits = md5->bytes * 8;
+    uint8_t pad = 0x80;
+    md5_update(md5, &pad, 1);
+    pad = 0;
+    while (md5->bytes % 64 != 56) {
+        md5_update(md5, &pad, 1);
+    }
+    for (int i = 0; i < 8; ++i) {
+        uint8_t byte = (uint8_t)(bits >> (i * 8));
+        md5_update(md5, &byte, 1);
+    }
+    for (int i = 0; i < 16; ++i) {
+        out[i] = (uint8_t)(md5->state[i / 4] >> ((i % 4) * 8));
+    }
+}
+
+static FILE *open_fixture(const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", FIXTURES_DIR, name);
+    FILE *file = fopen(path, "rb");
+    CHECK(file, "cannot open %s", path);
+    return file;
+}
+
+// Decodes the whole stream at native width, hashing it the way the encoder
+// did: interleaved, little-endian, in whole bytes per sample. Returns the
+// frames as stereo int16, as the player should see them.
+static int16_t *decode_native(const flac_fixture_t *fx, audio_flac_t *dec, uint64_t *frames) {
+    md5_t md5;
+    md5_init(&md5);
+    const int bytes = (dec->bps + 7) / 8;
+    int16_t *pcm = malloc((fx->frames + AUDIO_FLAC_MAX_BLOCK) * 2 * sizeof(int16_t));
+    *frames = 0;
+    while (audio_flac_next_frame(dec)) {
+        CHECK(dec->frame_first == *frames, "%s: frame starts at %llu, expected %llu", fx->name,
+              (unsigned long long)dec->frame_first, (unsigned long long)*frames);
+        for (uint32_t i = 0; i < dec->frame_samples && *frames + i < fx->frames; ++i) {
+            for (int c = 0; c < dec->channels; ++c) {
+                int32_t v = dec->samples[c][i];
+                uint8_t le[3] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16)};
+                md5_update(&md5, le, bytes);
+            }
+            // Reference for the int16 path; 24-bit is dithered there, so
+            // only its top 16 bits are kept here for a tolerance check.
+            int32_t l = dec->samples[0][i];
+            int32_t r = dec->samples[dec->channels - 1][i];
+            pcm[(*frames + i) * 2] = (int16_t)(dec->bps <= 16 ? l << (16 - dec->bps) : l >> (dec->bps - 16));
+            pcm[(*frames + i) * 2 + 1] = (int16_t)(dec->bps <= 16 ? r << (16 - dec->bps) : r >> (dec->bps - 16));
+        }
+        *frames += dec->frame_samples;
+        dec->frame_pos = dec->frame_samples;
+    }
+    uint8_t digest[16];
+    md5_final(&md5, digest);
+    CHECK(memcmp(digest, dec->md5, sizeof(digest)) == 0, "%s: decoded MD5 does not match STREAMINFO", fx->name);
+    return pcm;
+}
+
+// Reads frames through the decoder's int16 path into out.
+static size_t read_frames(audio_decoder_t *decoder, int16_t *out, size_t frames) {
+    size_t got = 0;
+    while (got < frames) {
+        size_t want = frames - got < 1024 ? frames - got : 1024;
+        size_t n = decoder->read(decoder, (uint8_t *)(out + got * 2), want * 4);
+        if (n == 0) {
+            break;
+        }
+        got += n;
+    }
+    return got;
+}
+
+static bool frames_match(const flac_fixture_t *fx, const int16_t *got, const int16_t *expected, size_t frames) {
+    for (size_t i = 0; i < frames * 2; ++i) {
+        // 24-bit output is dithered down, so allow the dither's one LSB.
+        int tolerance = fx->bps > 16 ? 2 : 0;
+        if (abs(got[i] - expected[i]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_fixture(const flac_fixture_t *fx) {
+    FILE *file = open_fixture(fx->name);
+    if (!file) {
+        return;
+    }
+    audio_decoder_t *decoder;
+    CHECK(audio_flac_open(file, &decoder) == ESP_OK, "%s: open failed", fx->name);
+    audio_flac_t *dec = (audio_flac_t *)decoder;
+    CHECK(decoder->sample_rate == fx->sample_rate && dec->channels == fx->channels && dec->bps == fx->bps,
+          "%s: %lu Hz, %u ch, %u bits", fx->name, (unsigned long)decoder->sample_rate, dec->channels, dec->bps);
+    CHECK(decoder->total_frames == (fx->length_known ? fx->frames : 0), "%s: %llu frames in STREAMINFO", fx->name,
+          (unsigned long long)decoder->total_frames);
+    CHECK((decoder->seek != NULL) == fx->length_known, "%s: seekable %d", fx->name, decoder->seek != NULL);
+
+    uint64_t frames;
+    int16_t *expected = decode_native(fx, dec, &frames);
+    CHECK(frames == fx->frames, "%s: decoded %llu frames", fx->name, (unsigned long long)frames);
+
+    int16_t *got = malloc(fx->frames * 2 * sizeof(int16_t));
+    if (decoder->seek) {
+        // The whole track through the int16 path, then seeks across it,
+        // both inside the first blocks and far enough to need the SEEKTABLE
+        // or the length-based guess.
+        CHECK(decoder->seek(decoder, 0) == ESP_OK, "%s: seek to 0", fx->name);
+        size_t n = read_frames(decoder, got, fx->frames);
+        CHECK(n == fx->frames && frames_match(fx, got, expected, n), "%s: int16 read differs", fx->name);
+        static const uint64_t targets[] = {1, 4095, 4096, 4097, 8191, 17000, 19999, 100, 12345, 0};
+        for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+            uint64_t target = targets[i] < fx->frames ? targets[i] : fx->frames - 7;
+            size_t want = fx->frames - target < 600 ? fx->frames - target : 600;
+            CHECK(decoder->seek(decoder, target) == ESP_OK, "%s: seek to %llu", fx->name, (unsigned long long)target);
+            n = read_frames(decoder, got, want);
+            CHECK(n == want && frames_match(fx, got, expected + target * 2, n), "%s: wrong audio after seek to %llu",
+                  fx->name, (unsigned long long)target);
+        }
+        CHECK(decoder->seek(decoder, fx->frames) != ESP_OK, "%s: seek past the end", fx->name);
+    } else {
+        // Without a length or SEEKTABLE a far seek has nothing to go on.
+        CHECK(audio_flac_seek(decoder, dec->max_block * 4u + 1) == ESP_ERR_NOT_SUPPORTED, "%s: far seek", fx->name);
+    }
+    free(got);
+    free(expected);
+    decoder->close(decoder);
+    fclose(file);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(s_fixtures) / sizeof(s_fixtures[0]); ++i) {
+        test_fixture(&s_fixtures[i]);
+    }
+    return host_test_result("test_audio_flac");
+}
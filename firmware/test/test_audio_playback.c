@@ -0,0 +1,400 @@
+// Plays a WAV through the audio component into a model of the legacy I2S
+// driver: a ring of DMA buffers that the peripheral plays out one after the
+// other at the sample rate, handing each finished one back to i2s_write and
+// posting TX_DONE. Every frame that reaches the DAC is logged with the time it
+// is heard, and each frame of the track carries its own index, so seeks can
+// be checked for the frame they land on and for how long they take to be
+// heard, and a pause or stop for how long the DAC keeps playing after it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "audio.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_rtos.h"
+#include "host_test.h"
+
+#define RATE_HZ 44100
+#define TRACK_FRAMES (RATE_HZ * 4)
+#define LOG_FRAMES (RATE_HZ * 12)
+// One 4 KB block read from SD: the longest the display may hold the bus
+// (the arbiter's default bound), eight sectors of command overhead and the
+// data itself at 20 MHz.
+#define SD_READ_US (2000 + 8 * 250 + 4096 * 8 / 20)
+#define SEEK_BOUND_US 50000
+// What can still play after a seek before the writer flushes DMA: the buffer
+// the DAC is in, and the one i2s_write may be waiting for.
+#define STALE_BOUND_FRAMES (2 * DMA_BUFFER_FRAMES)
+// From a pause or stop request until the DAC goes quiet: the writer sees it
+// between DMA-buffer slices, and the flush silences everything queued.
+#define SILENCE_BOUND_US 10000
+
+#define DMA_BUFFERS 4
+#define DMA_BUFFER_FRAMES 256
+
+typedef struct {
+    pthread_mutex_t lock;
+    int16_t buffers[DMA_BUFFERS][DMA_BUFFER_FRAMES * 2];
+    QueueHandle_t done_buffers; // sent, for i2s_write to refill
+    QueueHandle_t events;
+    int current; // buffer i2s_write is filling, -1 for none
+    size_t fill; // frames in it
+    uint32_t rate_hz;
+    int64_t start_us; // when frame 0 was heard
+    size_t played;    // frames heard so far
+    int16_t log[LOG_FRAMES * 2];
+} dma_model_t;
+
+static dma_model_t s_dma = {.lock = PTHREAD_MUTEX_INITIALIZER, .current = -1};
+
+// The peripheral: plays the ring in order, forever, whether or not anything
+// was written. Each buffer is logged once it has been played out.
+static void dma_task(void *arg) {
+    s_dma.start_us = esp_timer_get_time();
+    for (int index = 0;; index = (index + 1) % DMA_BUFFERS) {
+        int64_t end = s_dma.start_us + (int64_t)(s_dma.played + DMA_BUFFER_FRAMES) * 1000000 / s_dma.rate_hz;
+        host_rtos_sleep_us(end - esp_timer_get_time());
+        pthread_mutex_lock(&s_dma.lock);
+        if (s_dma.played + DMA_BUFFER_FRAMES <= LOG_FRAMES) {
+            memcpy(&s_dma.log[s_dma.played * 2], s_dma.buffers[index], sizeof(s_dma.buffers[index]));
+        }
+        s_dma.played += DMA_BUFFER_FRAMES;
+        // tx_desc_auto_clear: a buffer nobody refills plays silence.
+        memset(s_dma.buffers[index], 0, sizeof(s_dma.buffers[index]));
+        pthread_mutex_unlock(&s_dma.lock);
+
+        // The driver's ISR drops the oldest entry of a full queue. It runs
+        // on the writer's core, so the writer sees the event no later than
+        // the buffer it frees.
+        i2s_event_t event = {.type = I2S_EVENT_TX_DONE, .size = sizeof(s_dma.buffers[index])};
+        if (s_dma.events && !xQueueSend(s_dma.events, &event, 0)) {
+            i2s_event_t oldest;
+            xQueueReceive(s_dma.events, &oldest, 0);
+            xQueueSend(s_dma.events, &event, 0);
+        }
+        int dropped;
+        if (uxQueueMessagesWaiting(s_dma.done_buffers) == DMA_BUFFERS) {
+            xQueueReceive(s_dma.done_buffers, &dropped, 0);
+        }
+        xQueueSend(s_dma.done_buffers, &index, 0);
+    }
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, void *queue) {
+    CHECK(config->dma_buf_count == DMA_BUFFERS && config->dma_buf_len == DMA_BUFFER_FRAMES, "DMA ring %dx%d",
+          config->dma_buf_count, config->dma_buf_len);
+    s_dma.rate_hz = (uint32_t)config->sample_rate;
+    s_dma.done_buffers = xQueueCreate(DMA_BUFFERS, sizeof(int));
+    s_dma.events = xQueueCreate(queue_size, sizeof(i2s_event_t));
+    *(QueueHandle_t *)queue = s_dma.events;
+    xTaskCreate(dma_task, "i2s_dma", 0, NULL, 20, NULL);
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins) {
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, uint32_t bits, i2s_channel_t channels) {
+    CHECK(rate == s_dma.rate_hz, "the track is at %u Hz, not re-clocked", (unsigned)rate);
+    return ESP_OK;
+}
+
+// As the legacy driver: copies into the buffer being filled, waiting up to
+// ticks for each next one, and reports what fitted.
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *written, TickType_t ticks) {
+    const size_t frame_bytes = 2 * sizeof(int16_t);
+    const int16_t *frames = src;
+    size_t count = size / frame_bytes;
+    size_t done = 0;
+    while (done < count) {
+        if (s_dma.current < 0 || s_dma.fill == DMA_BUFFER_FRAMES) {
+            if (!xQueueReceive(s_dma.done_buffers, &s_dma.current, ticks)) {
+                break;
+            }
+            s_dma.fill = 0;
+        }
+        size_t n = DMA_BUFFER_FRAMES - s_dma.fill;
+        n = n < count - done ? n : count - done;
+        pthread_mutex_lock(&s_dma.lock);
+        memcpy(&s_dma.buffers[s_dma.current][s_dma.fill * 2], &frames[done * 2], n * frame_bytes);
+        pthread_mutex_unlock(&s_dma.lock);
+        s_dma.fill += n;
+        done += n;
+    }
+    *written = done * frame_bytes;
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port) {
+    pthread_mutex_lock(&s_dma.lock);
+    memset(s_dma.buffers, 0, sizeof(s_dma.buffers));
+    pthread_mutex_unlock(&s_dma.lock);
+    return ESP_OK;
+}
+
+// Frame n of the track is stamped with n; the right channel is never zero,
+// so silence can't pass for a frame.
+static void frame_stamp(uint32_t n, int16_t *frame) {
+    frame[0] = (int16_t)(n & 0x7fff);
+    frame[1] = (int16_t)(0x4000 | (n >> 15));
+}
+
+static int64_t frame_of(const int16_t *frame) {
+    if (frame[1] == 0) {
+        return -1;
+    }
+    return (int64_t)((frame[1] & 0x3fff) << 15 | (frame[0] & 0x7fff));
+}
+
+static void le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void le32(uint8_t *p, uint32_t v) {
+    le16(p, (uint16_t)v);
+    le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void write_track(const char *path) {
+    const uint32_t data_bytes = TRACK_FRAMES * 4;
+    uint8_t header[44];
+    memcpy(header, "RIFF", 4);
+    le32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    le32(header + 16, 16);
+    le16(header + 20, 1);
+    le16(header + 22, 2);
+    le32(header + 24, RATE_HZ);
+    le32(header + 28, RATE_HZ * 4);
+    le16(header + 32, 4);
+    le16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    le32(header + 40, data_bytes);
+    FILE *f = fopen(path, "wb");
+    fwrite(header, sizeof(header), 1, f);
+    for (uint32_t n = 0; n < TRACK_FRAMES; ++n) {
+        int16_t frame[2];
+        frame_stamp(n, frame);
+        fwrite(frame, sizeof(frame), 1, f);
+    }
+    fclose(f);
+}
+
+static void read_callback(bool begin, void *user_data) {
+    if (begin) {
+        host_rtos_sleep_us(SD_READ_US);
+    }
+}
+
+static volatile bool s_player_done;
+static uint32_t s_player_stops;
+
+static void player_task(void *arg) {
+    CHECK(audio_play_wav_file(arg, s_player_stops) == ESP_OK, "play");
+    s_player_done = true;
+    vTaskDelete(NULL);
+}
+
+static int64_t frame_time_us(size_t index) {
+    return s_dma.start_us + (int64_t)index * 1000000 / s_dma.rate_hz;
+}
+
+static size_t frame_index_at(int64_t us) {
+    return (size_t)((us - s_dma.start_us) * s_dma.rate_hz / 1000000);
+}
+
+// Seeks to position_ms, lets playback run on, and finds where in the log the
+// sought frame was heard. Checks that it was within the bound, that the
+// track carries on from it frame by frame, and that only what DMA already
+// held played in between.
+static void seek_and_check(uint32_t position_ms) {
+    const int64_t request = esp_timer_get_time();
+    CHECK(audio_seek_ms(position_ms) == ESP_OK, "seek to %u ms", (unsigned)position_ms);
+    vTaskDelay(pdMS_TO_TICKS(200));
+
+    const int64_t target = (int64_t)position_ms * RATE_HZ / 1000;
+    const size_t from = frame_index_at(request);
+    const size_t to = s_dma.played;
+    size_t hit = to;
+    size_t stale = 0;
+    for (size_t i = from; i < to && hit == to; ++i) {
+        int64_t n = frame_of(&s_dma.log[i * 2]);
+        if (n == target) {
+            hit = i;
+        } else if (n >= 0) {
+            stale++;
+        }
+    }
+    CHECK(hit < to, "frame %lld never heard after seeking to %u ms", (long long)target, (unsigned)position_ms);
+    if (hit == to) {
+        return;
+    }
+    int64_t latency_us = frame_time_us(hit) - request;
+    CHECK(latency_us < SEEK_BOUND_US, "seek to %u ms heard after %lld us", (unsigned)position_ms, (long long)latency_us);
+    CHECK(stale <= STALE_BOUND_FRAMES, "%zu stale frames after seeking to %u ms", stale, (unsigned)position_ms);
+    for (size_t i = hit; i < to && target + (int64_t)(i - hit) < TRACK_FRAMES; ++i) {
+        int64_t n = frame_of(&s_dma.log[i * 2]);
+        if (n != target + (int64_t)(i - hit)) {
+            CHECK(false, "after seeking to %u ms, frame %lld heard where %lld belongs", (unsigned)position_ms, (long long)n,
+                  (long long)(target + (int64_t)(i - hit)));
+            break;
+        }
+    }
+
+    // The writer's own figure, which the firmware reports, should agree to
+    // within what it can't see: where in its buffer DMA is.
+    audio_buffer_status_t status;
+    audio_get_buffer_status(&status);
+    int64_t reported = status.seek_us;
+    CHECK(llabs(reported - latency_us) <= 2 * (int64_t)DMA_BUFFER_FRAMES * 1000000 / RATE_HZ,
+          "seek_us %lld, heard after %lld us", (long long)reported, (long long)latency_us);
+    printf("seek to %4u ms: heard after %5.1f ms (seek_us %5.1f ms), %zu stale frames\n", (unsigned)position_ms,
+           latency_us / 1000.0, reported / 1000.0, stale);
+}
+
+static void start_track(const char *path) {
+    s_player_done = false;
+    s_player_stops = audio_get_stop_count();
+    xTaskCreate(player_task, "player", 0, (void *)path, 5, NULL);
+    vTaskDelay(pdMS_TO_TICKS(300));
+    CHECK(audio_is_playing(), "playing");
+}
+
+static void test_seek(const char *path) {
+    start_track(path);
+
+    seek_and_check(2500); // ahead
+    seek_and_check(500);  // back
+    seek_and_check(3000);
+    seek_and_check(0);
+
+    // A burst of seeks costs one: only the last is heard.
+    CHECK(audio_seek_ms(1000) == ESP_OK, "seek");
+    vTaskDelay(1);
+    CHECK(audio_seek_ms(1200) == ESP_OK, "seek");
+    seek_and_check(1700);
+
+    audio_buffer_status_t status;
+    audio_get_buffer_status(&status);
+    CHECK(status.max_seek_us < SEEK_BOUND_US, "max_seek_us %u", (unsigned)status.max_seek_us);
+    CHECK(status.underruns == 0, "%u underruns", (unsigned)status.underruns);
+
+    audio_request_stop();
+    while (!s_player_done) {
+        vTaskDelay(1);
+    }
+}
+
+// Lets DMA play on after a request made at request_us and returns how long
+// the track was still heard after it; *last is the last frame heard.
+static int64_t heard_after(int64_t request_us, int64_t *last) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+    int64_t until = request_us;
+    *last = -1;
+    for (size_t i = frame_index_at(request_us); i < s_dma.played; ++i) {
+        int64_t n = frame_of(&s_dma.log[i * 2]);
+        if (n >= 0) {
+            until = frame_time_us(i + 1);
+            *last = n;
+        }
+    }
+    return until - request_us;
+}
+
+static void check_silence(const char *what, int64_t heard_us) {
+    audio_buffer_status_t status;
+    audio_get_buffer_status(&status);
+    CHECK(heard_us < SILENCE_BOUND_US, "%s: track heard for %lld us", what, (long long)heard_us);
+    CHECK(llabs((int64_t)status.stop_us - heard_us) <= (int64_t)DMA_BUFFER_FRAMES * 1000000 / RATE_HZ,
+          "%s: stop_us %u, heard for %lld us", what, (unsigned)status.stop_us, (long long)heard_us);
+    printf("%s: silent after %4.1f ms (stop_us %4.1f ms)\n", what, heard_us / 1000.0, status.stop_us / 1000.0);
+}
+
+// Button to silence, for pause and for stop, and a resume that neither
+// skips nor repeats more than what the flush took back from DMA.
+static void test_pause_stop(const char *path) {
+    start_track(path);
+    for (int round = 0; round < 3; ++round) {
+        int64_t request = esp_timer_get_time();
+        CHECK(audio_set_paused(true) == ESP_OK, "pause");
+        int64_t last;
+        check_silence("pause", heard_after(request, &last));
+        CHECK(audio_is_paused(), "paused");
+        CHECK(last >= 0, "nothing heard before the pause");
+
+        int64_t resume = esp_timer_get_time();
+        CHECK(audio_set_paused(false) == ESP_OK, "resume");
+        vTaskDelay(pdMS_TO_TICKS(100));
+        size_t first = frame_index_at(resume);
+        while (first < s_dma.played && frame_of(&s_dma.log[first * 2]) < 0) {
+            first++;
+        }
+        CHECK(first < s_dma.played, "nothing heard after resuming");
+        int64_t n = first < s_dma.played ? frame_of(&s_dma.log[first * 2]) : -1;
+        CHECK(n <= last + 1 && n >= last + 1 - STALE_BOUND_FRAMES, "resumed at frame %lld after pausing at %lld",
+              (long long)n, (long long)last);
+        CHECK(frame_time_us(first) - resume < SEEK_BOUND_US, "resume heard after %lld us",
+              (long long)(frame_time_us(first) - resume));
+        vTaskDelay(pdMS_TO_TICKS(37 * round));
+    }
+
+    int64_t request = esp_timer_get_time();
+    audio_request_stop();
+    int64_t last;
+    check_silence("stop", heard_after(request, &last));
+    CHECK(s_player_done && !audio_is_playing(), "stopped");
+
+    // Pausing what isn't playing is refused, so the UI knows to start over.
+    CHECK(audio_set_paused(true) == ESP_ERR_INVALID_STATE, "pause with nothing playing");
+
+    audio_buffer_status_t status;
+    audio_get_buffer_status(&status);
+    CHECK(status.max_stop_us < SILENCE_BOUND_US, "max_stop_us %u", (unsigned)status.max_stop_us);
+}
+
+// A stop that comes in while the file is still being opened, before the
+// writer has started, cancels the track instead of being forgotten.
+static void test_stop_while_opening(const char *path) {
+    s_player_done = false;
+    s_player_stops = audio_get_stop_count();
+    int64_t request = esp_timer_get_time();
+    xTaskCreate(player_task, "player", 0, (void *)path, 5, NULL);
+    audio_request_stop();
+    for (int i = 0; i < 100 && !s_player_done; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    CHECK(s_player_done && !audio_is_playing(), "stopped while opening");
+    int64_t last;
+    CHECK(heard_after(request, &last) <= 0, "track heard after a stop while opening");
+}
+
+int main(void) {
+    char path[] = "/tmp/audio_playback_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "temporary file");
+    close(fd);
+    write_track(path);
+
+    audio_i2s_config_t config = {
+        .port = I2S_NUM_0,
+        .mclk_pin = GPIO_NUM_NC,
+        .bclk_pin = GPIO_NUM_NC,
+        .lrclk_pin = GPIO_NUM_NC,
+        .dout_pin = GPIO_NUM_NC,
+        .sample_rate_hz = RATE_HZ,
+        .read_callback = read_callback,
+    };
+    CHECK(audio_init(&config) == ESP_OK, "init");
+    test_seek(path);
+    test_pause_stop(path);
+    test_stop_while_opening(path);
+
+    unlink(path);
+    return host_test_result("audio_playback");
+}
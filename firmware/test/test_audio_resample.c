@@ -0,0 +1,168 @@
+// Feeds -1 dBFS sines through the resampler the way the player does and
+// measures THD+N against a least-squares fit of the expected tone, the
+// passband gain and the host throughput. Also checks that the output does
+// not depend on how the input is split into calls, and that reset really
+// starts afresh.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_resample.h"
+#include "host_test.h"
+
+#define OUT_RATE_HZ 44100
+#define LEVEL (0.89 * 32767) // -1 dBFS
+#define BLOCK_FRAMES 1024    // what the player hands over per call
+
+typedef struct {
+    uint32_t in_rate_hz;
+    double tone_hz;
+    double max_thd_n_db;
+    double min_gain;
+} tone_case_t;
+
+static const tone_case_t s_cases[] = {
+    {8000, 1000, -75, 0.999},   {16000, 1000, -75, 0.999}, {22050, 1000, -75, 0.999},
+    {32000, 1000, -75, 0.999},  {48000, 1000, -78, 0.999}, {88200, 1000, -90, 0.999},
+    {96000, 1000, -80, 0.999},  {48000, 10000, -75, 0.999}, {22050, 8000, -75, 0.995},
+    // At the filter's transition band; droop is allowed, distortion is not.
+    {96000, 15000, -75, 0.9},
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Left is the tone, right its negation, so crosstalk shows up as L != -R.
+static int16_t *make_tone(uint32_t rate_hz, double tone_hz, size_t frames) {
+    int16_t *pcm = malloc(frames * 2 * sizeof(int16_t));
+    for (size_t i = 0; i < frames; ++i) {
+        double v = LEVEL * sin(2 * M_PI * tone_hz * i / rate_hz);
+        pcm[2 * i] = (int16_t)lrint(v);
+        pcm[2 * i + 1] = (int16_t)lrint(-v);
+    }
+    return pcm;
+}
+
+// Resamples everything in blocks of block_frames input frames and returns
+// the number of output frames.
+static size_t resample(audio_resampler_t *rs, const int16_t *in, size_t in_frames, size_t block_frames, int16_t *out,
+                       size_t out_capacity) {
+    size_t out_frames = 0;
+    while (in_frames) {
+        size_t block = in_frames < block_frames ? in_frames : block_frames;
+        const int16_t *p = in;
+        size_t left = block;
+        size_t produced;
+        do {
+            size_t used = left;
+            size_t room = out_capacity - out_frames < BLOCK_FRAMES ? out_capacity - out_frames : BLOCK_FRAMES;
+            produced = audio_resampler_process(rs, p, &used, out + out_frames * 2, room);
+            out_frames += produced;
+            p += used * 2;
+            left -= used;
+        } while (left || (produced && out_frames < out_capacity));
+        in += block * 2;
+        in_frames -= block;
+    }
+    return out_frames;
+}
+
+static void test_tone(const tone_case_t *tc) {
+    audio_resampler_t rs;
+    CHECK(audio_resampler_init(&rs, tc->in_rate_hz, OUT_RATE_HZ) == ESP_OK, "init %lu", (unsigned long)tc->in_rate_hz);
+    size_t in_frames = tc->in_rate_hz * 2;
+    int16_t *in = make_tone(tc->in_rate_hz, tc->tone_hz, in_frames);
+    size_t capacity = (size_t)((double)in_frames * OUT_RATE_HZ / tc->in_rate_hz) + BLOCK_FRAMES;
+    int16_t *out = malloc(capacity * 2 * sizeof(int16_t));
+
+    double start = now_s();
+    size_t out_frames = resample(&rs, in, in_frames, BLOCK_FRAMES, out, capacity);
+    double elapsed = now_s() - start;
+
+    // Fit A sin + B cos over the middle half, away from the filter's start-up.
+    size_t a = out_frames / 4;
+    size_t b = out_frames * 3 / 4;
+    double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+    for (size_t i = a; i < b; ++i) {
+        double w = 2 * M_PI * tc->tone_hz * i / OUT_RATE_HZ;
+        double s = sin(w), c = cos(w), y = out[2 * i];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        ys += y * s;
+        yc += y * c;
+    }
+    double det = ss * cc - sc * sc;
+    double fit_a = (ys * cc - yc * sc) / det;
+    double fit_b = (yc * ss - ys * sc) / det;
+    double signal = 0, residual = 0;
+    int crosstalk = 0;
+    for (size_t i = a; i < b; ++i) {
+        double w = 2 * M_PI * tc->tone_hz * i / OUT_RATE_HZ;
+        double model = fit_a * sin(w) + fit_b * cos(w);
+        double err = out[2 * i] - model;
+        signal += model * model;
+        residual += err * err;
+        int sum = out[2 * i] + out[2 * i + 1];
+        crosstalk = abs(sum) > crosstalk ? abs(sum) : crosstalk;
+    }
+    double thd_n_db = 10 * log10(residual / signal);
+    double gain = sqrt(fit_a * fit_a + fit_b * fit_b) / LEVEL;
+    double realtime = (double)out_frames / OUT_RATE_HZ / elapsed;
+    printf("%6lu -> %u Hz, %5.0f Hz tone: THD+N %6.1f dB, gain %.4f, %4.0fx realtime on this host\n",
+           (unsigned long)tc->in_rate_hz, OUT_RATE_HZ, tc->tone_hz, thd_n_db, gain, realtime);
+
+    // The filter holds back half its taps of input until more arrives.
+    size_t expected = (size_t)((double)in_frames * OUT_RATE_HZ / tc->in_rate_hz);
+    size_t held = AUDIO_RESAMPLE_TAPS * OUT_RATE_HZ / tc->in_rate_hz + 1;
+    CHECK(out_frames + held >= expected && out_frames <= expected + 1, "%zu frames out, expected %zu", out_frames,
+          expected);
+    CHECK(thd_n_db <= tc->max_thd_n_db, "THD+N %.1f dB over %.1f dB", thd_n_db, tc->max_thd_n_db);
+    CHECK(gain >= tc->min_gain && gain <= 1.001, "gain %.4f", gain);
+    CHECK(crosstalk <= 1, "L/R differ by %d", crosstalk);
+
+    audio_resampler_deinit(&rs);
+    free(in);
+    free(out);
+}
+
+// The player's reads come in whatever sizes the decoder produces; the
+// output must not depend on them, and a reset must match a fresh start.
+static void test_block_sizes_and_reset(void) {
+    const uint32_t in_rate = 48000;
+    size_t in_frames = in_rate / 2;
+    int16_t *in = make_tone(in_rate, 3000, in_frames);
+    size_t capacity = in_frames + BLOCK_FRAMES;
+    int16_t *reference = malloc(capacity * 2 * sizeof(int16_t));
+    int16_t *out = malloc(capacity * 2 * sizeof(int16_t));
+
+    audio_resampler_t rs;
+    CHECK(audio_resampler_init(&rs, in_rate, OUT_RATE_HZ) == ESP_OK, "init");
+    size_t reference_frames = resample(&rs, in, in_frames, BLOCK_FRAMES, reference, capacity);
+
+    static const size_t blocks[] = {1, 37, 511, 4096};
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); ++i) {
+        audio_resampler_reset(&rs);
+        memset(out, 0, capacity * 2 * sizeof(int16_t));
+        size_t frames = resample(&rs, in, in_frames, blocks[i], out, capacity);
+        CHECK(frames == reference_frames && memcmp(out, reference, frames * 2 * sizeof(int16_t)) == 0,
+              "output differs with %zu-frame blocks", blocks[i]);
+    }
+    audio_resampler_deinit(&rs);
+    free(in);
+    free(reference);
+    free(out);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(s_cases) / sizeof(s_cases[0]); ++i) {
+        test_tone(&s_cases[i]);
+    }
+    test_block_sizes_and_reset();
+    return host_test_result("test_audio_resample");
+}
@@ -0,0 +1,206 @@
+// Runs the SPI2 arbiter against a model of the bus: a display task that
+// queues full-size slices as fast as the SPI queue takes them, an SPI
+// peripheral that clocks them out, and an SD reader on the audio schedule.
+// Checks that no SD claim waits past the latency bound and that the two
+// never share the wire, and compares the bus time PCM and IMA ADPCM reads
+// leave to the display.
+#include <stdio.h>
+#include <string.h>
+
+#include "bus_sched.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "host_rtos.h"
+#include "host_test.h"
+
+#define BUS_CLOCK_HZ 20000000
+#define SPI_QUEUE_SIZE 16
+// Descriptor setup and the ISR handing the bus over.
+#define SPI_SETUP_US 20
+// Command, token and CRC overhead of one SD block read.
+#define SD_SETUP_US 250
+// A full 320x480 RGB565 frame.
+#define SCREEN_FRAME_BYTES (320 * 480 * 2)
+
+typedef struct {
+    bus_sched_t sched;
+    QueueHandle_t spi_queue;
+    volatile bool running;
+    volatile bool lcd_on_bus;
+    volatile bool sd_on_bus;
+    uint32_t overlaps;
+    uint32_t slices;
+    uint32_t lcd_tasks;
+} bus_model_t;
+
+static int64_t wire_us(size_t bytes) {
+    return (int64_t)bytes * 8 * 1000000 / BUS_CLOCK_HZ;
+}
+
+// The SPI peripheral: start and done are the ISR hooks around each slice.
+static void spi_task(void *arg) {
+    bus_model_t *bus = arg;
+    size_t bytes;
+    while (xQueueReceive(bus->spi_queue, &bytes, portMAX_DELAY) && bytes) {
+        host_rtos_sleep_us(SPI_SETUP_US);
+        bus_sched_lcd_start(&bus->sched);
+        bus->lcd_on_bus = true;
+        bus->overlaps += bus->sd_on_bus;
+        host_rtos_sleep_us(wire_us(bytes));
+        bus->lcd_on_bus = false;
+        bus_sched_lcd_done(bytes, &bus->sched);
+        bus->slices++;
+    }
+    bus->lcd_tasks--;
+    vTaskDelete(NULL);
+}
+
+// The drawing task, as ili9488_queue_trans drives the hooks.
+static void lcd_task(void *arg) {
+    bus_model_t *bus = arg;
+    size_t slice = bus_sched_slice_bytes(&bus->sched);
+    while (bus->running) {
+        bus_sched_lcd_queue(slice, &bus->sched);
+        xQueueSend(bus->spi_queue, &slice, portMAX_DELAY);
+    }
+    size_t stop = 0;
+    xQueueSend(bus->spi_queue, &stop, portMAX_DELAY);
+    bus->lcd_tasks--;
+    vTaskDelete(NULL);
+}
+
+static void bus_model_start(bus_model_t *bus, uint32_t latency_us) {
+    memset(bus, 0, sizeof(*bus));
+    bus_sched_config_t config = {.clock_hz = BUS_CLOCK_HZ, .latency_us = latency_us};
+    CHECK(bus_sched_init(&bus->sched, &config) == ESP_OK, "init");
+    bus->spi_queue = xQueueCreate(SPI_QUEUE_SIZE, sizeof(size_t));
+    bus->running = true;
+    bus->lcd_tasks = 2;
+    xTaskCreate(spi_task, "spi", 0, bus, 5, NULL);
+    xTaskCreate(lcd_task, "lcd", 0, bus, 4, NULL);
+}
+
+static void bus_model_stop(bus_model_t *bus) {
+    bus->running = false;
+    while (bus->lcd_tasks) {
+        vTaskDelay(1);
+    }
+    vQueueDelete(bus->spi_queue);
+    vSemaphoreDelete(bus->sched.lcd_wake);
+    vSemaphoreDelete(bus->sched.sd_wake);
+}
+
+// One SD read of read_bytes every period_us for duration_us.
+static void sd_reads(bus_model_t *bus, size_t read_bytes, int64_t period_us, int64_t duration_us) {
+    int64_t next = esp_timer_get_time();
+    int64_t end = next + duration_us;
+    while (next < end) {
+        host_rtos_sleep_us(next - esp_timer_get_time());
+        bus_sched_sd_begin(&bus->sched);
+        bus->sd_on_bus = true;
+        bus->overlaps += bus->lcd_on_bus;
+        host_rtos_sleep_us(SD_SETUP_US + wire_us(read_bytes));
+        bus->sd_on_bus = false;
+        bus_sched_sd_end(&bus->sched);
+        // Land claims at every phase of the display's slices.
+        next += period_us + (next % 97);
+    }
+}
+
+// Streams reads of read_bytes at bytes_per_s for two seconds against a
+// saturating display and checks the bound held.
+static void run_stream(const char *label, uint32_t latency_us, size_t read_bytes, double bytes_per_s,
+                       bus_sched_stats_t *lcd, bus_sched_stats_t *sd) {
+    bus_model_t bus;
+    bus_model_start(&bus, latency_us);
+    sd_reads(&bus, read_bytes, (int64_t)(read_bytes / bytes_per_s * 1e6), 2000000);
+    bus_model_stop(&bus);
+
+    bus_sched_get_stats(&bus.sched, BUS_SCHED_CLIENT_LCD, lcd);
+    bus_sched_get_stats(&bus.sched, BUS_SCHED_CLIENT_SD, sd);
+    double elapsed_s = (double)(esp_timer_get_time() - bus.sched.init_us) / 1e6;
+    double frames_per_s = lcd->busy_us / 1e6 / elapsed_s * BUS_CLOCK_HZ / 8 / SCREEN_FRAME_BYTES;
+    printf("%-6s bound %4lu us, slice %4zu B, %4zu B reads: SD %2u%% busy, max wait %4lu us | display %2u%% busy, "
+           "%.1f frames/s\n",
+           label, (unsigned long)latency_us, bus_sched_slice_bytes(&bus.sched), read_bytes, sd->occupancy_pct,
+           (unsigned long)sd->max_wait_us, lcd->occupancy_pct, frames_per_s);
+    CHECK(sd->transfers >= (uint32_t)(2 * bytes_per_s / read_bytes) - 2, "%s: only %lu SD claims", label,
+          (unsigned long)sd->transfers);
+    CHECK(sd->max_wait_us <= latency_us, "%s: SD waited %lu us", label, (unsigned long)sd->max_wait_us);
+    CHECK(sd->over_bound == 0, "%s: %lu claims over the bound", label, (unsigned long)sd->over_bound);
+    CHECK(bus.overlaps == 0, "%s: display and SD shared the wire %lu times", label, (unsigned long)bus.overlaps);
+}
+
+static void test_latency_bound(uint32_t latency_us) {
+    bus_sched_stats_t lcd, sd;
+    run_stream("PCM", latency_us, 4096, 44100 * 4, &lcd, &sd);
+    CHECK(lcd.occupancy_pct >= 50, "display starved at %u%%", lcd.occupancy_pct);
+}
+
+// 16-bit stereo PCM takes 4 KB reads at 43 a second; IMA ADPCM carries the
+// same audio in 2 KB blocks of 2041 frames, 21.6 a second.
+static void test_adpcm_occupancy(void) {
+    bus_sched_stats_t pcm_lcd, pcm_sd, adpcm_lcd, adpcm_sd;
+    run_stream("PCM", BUS_SCHED_DEFAULT_LATENCY_US, 4096, 44100 * 4, &pcm_lcd, &pcm_sd);
+    run_stream("ADPCM", BUS_SCHED_DEFAULT_LATENCY_US, 2048, 44100.0 / 2041 * 2048, &adpcm_lcd, &adpcm_sd);
+    CHECK(adpcm_sd.busy_us * 3 < pcm_sd.busy_us, "ADPCM SD time %llu us vs PCM %llu us",
+          (unsigned long long)adpcm_sd.busy_us, (unsigned long long)pcm_sd.busy_us);
+    CHECK(adpcm_lcd.busy_us > pcm_lcd.busy_us, "display got no more of the bus with ADPCM");
+}
+
+// A slice the SPI driver refuses must not leave an SD claim waiting for a
+// done that never comes.
+static void test_cancel(void) {
+    bus_model_t bus;
+    bus_sched_config_t config = {.clock_hz = BUS_CLOCK_HZ, .latency_us = BUS_SCHED_DEFAULT_LATENCY_US};
+    memset(&bus, 0, sizeof(bus));
+    CHECK(bus_sched_init(&bus.sched, &config) == ESP_OK, "init");
+    size_t slice = bus_sched_slice_bytes(&bus.sched);
+
+    bus_sched_lcd_queue(slice, &bus.sched);
+    bus_sched_lcd_cancel(slice, &bus.sched);
+    bus_sched_sd_begin(&bus.sched);
+    bus_sched_sd_end(&bus.sched);
+    CHECK(bus.sched.lcd_queued == 0, "%zu bytes still queued", bus.sched.lcd_queued);
+
+    bus_sched_stats_t sd;
+    bus_sched_get_stats(&bus.sched, BUS_SCHED_CLIENT_SD, &sd);
+    CHECK(sd.transfers == 1 && sd.max_wait_us == 0, "SD claim waited %lu us", (unsigned long)sd.max_wait_us);
+    vSemaphoreDelete(bus.sched.lcd_wake);
+    vSemaphoreDelete(bus.sched.sd_wake);
+}
+
+static void cancel_later_task(void *arg) {
+    bus_model_t *bus = arg;
+    vTaskDelay(5);
+    bus_sched_lcd_cancel(bus_sched_slice_bytes(&bus->sched), &bus->sched);
+    vTaskDelete(NULL);
+}
+
+// Same, with the SD claim already blocked when the slice is refused.
+static void test_cancel_wakes_sd(void) {
+    bus_model_t bus;
+    bus_sched_config_t config = {.clock_hz = BUS_CLOCK_HZ, .latency_us = BUS_SCHED_DEFAULT_LATENCY_US};
+    memset(&bus, 0, sizeof(bus));
+    CHECK(bus_sched_init(&bus.sched, &config) == ESP_OK, "init");
+    bus_sched_lcd_queue(bus_sched_slice_bytes(&bus.sched), &bus.sched);
+    xTaskCreate(cancel_later_task, "cancel", 0, &bus, 4, NULL);
+    int64_t start = esp_timer_get_time();
+    bus_sched_sd_begin(&bus.sched);
+    bus_sched_sd_end(&bus.sched);
+    CHECK(esp_timer_get_time() - start == 5000, "SD claim granted after %lld us",
+          (long long)(esp_timer_get_time() - start));
+    vSemaphoreDelete(bus.sched.lcd_wake);
+    vSemaphoreDelete(bus.sched.sd_wake);
+}
+
+int main(void) {
+    test_cancel();
+    test_cancel_wakes_sd();
+    test_latency_bound(BUS_SCHED_DEFAULT_LATENCY_US);
+    test_latency_bound(1000);
+    test_latency_bound(5000);
+    test_adpcm_occupancy();
+    return host_test_result("test_bus_sched");
+}
@@ -0,0 +1,85 @@
+// Checks the RGB565-to-RGB666 conversion against a per-pixel reference, for
+// every colour on the word-at-a-time path, and for each alignment of source
+// and destination so the head and tail that go byte by byte are covered too.
+#include <string.h>
+
+#include "host_test.h"
+#include "ili9488.h"
+
+#define MAX_PIXELS 40
+#define GUARD 0xA5
+
+// Source pixels are in wire order: the high byte of RGB565 comes first.
+static void reference(uint8_t *dst, const uint8_t *src, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i) {
+        uint16_t px = (uint16_t)(src[i * 2] << 8 | src[i * 2 + 1]);
+        uint8_t r = px >> 11, g = (px >> 5) & 0x3F, b = px & 0x1F;
+        dst[i * 3] = (uint8_t)(r << 3 | (r >> 4) << 2);
+        dst[i * 3 + 1] = (uint8_t)(g << 2);
+        dst[i * 3 + 2] = (uint8_t)(b << 3 | (b >> 4) << 2);
+    }
+}
+
+static void test_all_colours(void) {
+    static uint16_t src[65536];
+    static uint8_t expected[65536 * 3];
+    static uint32_t out[65536 * 3 / 4];
+    uint8_t *dst = (uint8_t *)out;
+    for (uint32_t i = 0; i < 65536; ++i) {
+        uint8_t *bytes = (uint8_t *)&src[i];
+        bytes[0] = (uint8_t)(i >> 8);
+        bytes[1] = (uint8_t)i;
+    }
+    ili9488_rgb565_to_rgb666(dst, src, 65536);
+    reference(expected, (const uint8_t *)src, 65536);
+    size_t mismatches = 0;
+    for (uint32_t i = 0; i < 65536; ++i) {
+        if (memcmp(dst + i * 3, expected + i * 3, 3) != 0 && mismatches++ < 4) {
+            CHECK(false, "0x%04x -> %02x %02x %02x, expected %02x %02x %02x", (unsigned)i, dst[i * 3], dst[i * 3 + 1],
+                  dst[i * 3 + 2], expected[i * 3], expected[i * 3 + 1], expected[i * 3 + 2]);
+        }
+    }
+    CHECK(mismatches == 0, "%zu colours converted wrongly", mismatches);
+    // Full scale stays full scale on every channel.
+    CHECK(dst[0xFFFF * 3] == 0xFC && dst[0xFFFF * 3 + 1] == 0xFC && dst[0xFFFF * 3 + 2] == 0xFC, "white");
+}
+
+static void test_alignments(void) {
+    uint32_t src_words[MAX_PIXELS / 2 + 2];
+    uint32_t dst_words[(MAX_PIXELS * 3 + 8) / 4 + 1];
+    uint8_t expected[MAX_PIXELS * 3];
+    uint32_t seed = HOST_FNV1A_INIT;
+    for (int src_offset = 0; src_offset < 2; ++src_offset) {
+        for (int dst_offset = 0; dst_offset < 4; ++dst_offset) {
+            for (size_t pixels = 0; pixels <= MAX_PIXELS; ++pixels) {
+                uint16_t *src = (uint16_t *)src_words + src_offset;
+                uint8_t *bytes = (uint8_t *)src;
+                for (size_t i = 0; i < pixels * 2; ++i) {
+                    seed = host_fnv1a(seed, &i, sizeof(i));
+                    bytes[i] = (uint8_t)(seed >> 13);
+                }
+                uint8_t *dst = (uint8_t *)dst_words + dst_offset;
+                memset(dst_words, GUARD, sizeof(dst_words));
+                ili9488_rgb565_to_rgb666(dst, src, pixels);
+                reference(expected, bytes, pixels);
+                CHECK(memcmp(dst, expected, pixels * 3) == 0, "src +%d, dst +%d, %zu pixels", src_offset * 2,
+                      dst_offset, pixels);
+                const uint8_t *all = (const uint8_t *)dst_words;
+                bool guarded = true;
+                for (size_t i = 0; i < sizeof(dst_words); ++i) {
+                    if ((all + i < dst || all + i >= dst + pixels * 3) && all[i] != GUARD) {
+                        guarded = false;
+                    }
+                }
+                CHECK(guarded, "src +%d, dst +%d, %zu pixels: wrote outside the output", src_offset * 2, dst_offset,
+                      pixels);
+            }
+        }
+    }
+}
+
+int main(void) {
+    test_all_colours();
+    test_alignments();
+    return host_test_result("test_ili9488");
+}
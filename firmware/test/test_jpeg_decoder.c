@@ -0,0 +1,244 @@
+// Decodes the fixture covers at every scale and checks the RGB565 output
+// against known checksums. With libjpeg available the full-size decodes are
+// also compared pixel by pixel to libjpeg. The reduced scales are pinned by
+// checksum only: libjpeg folds high-frequency coefficients into its reduced
+// IDCT and decodes subsampled chroma at a larger size instead of
+// replicating it, so the two legitimately differ there.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "jpeg_decoder.h"
+
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+
+// Both decoders use an accurate integer IDCT, so a full-size decode may only
+// differ by rounding.
+#define MAX_STEPS 1
+#define MAX_MEAN_STEPS 0.1
+#endif
+
+typedef struct {
+    const char *name;
+    uint16_t width;
+    uint16_t height;
+    uint32_t checksum[4]; // per jpeg_scale_t
+} fixture_t;
+
+static const fixture_t s_fixtures[] = {
+    {"cover_444.jpg", 96, 80, {0x0e8d898e, 0x840c31f0, 0xea4fb051, 0x4bff7392}},
+    {"cover_422.jpg", 120, 64, {0x7bfea6b5, 0x788f39a8, 0xea876a62, 0x11004579}},
+    {"cover_440.jpg", 64, 100, {0xd1879bb9, 0x02b1c9c4, 0x28fbde65, 0xf64b4c2d}},
+    {"cover_420_rst.jpg", 150, 101, {0xfb9ff2c0, 0xb9747bfa, 0x4ec7ba8d, 0xa0c726f2}},
+    {"grey.jpg", 77, 53, {0xfeab0796, 0x80cee26f, 0x5179e978, 0x6ab73e3b}},
+};
+
+// The decoder's single allocation; strips belong to the caller.
+#define MAX_CONTEXT_BYTES 6400
+
+typedef struct {
+    FILE *file;
+    uint16_t *image;
+    uint16_t width;
+    uint16_t height;
+    uint16_t next_row;
+} sink_t;
+
+static int sink_read(void *user_data, uint8_t *buffer, size_t len) {
+    sink_t *sink = user_data;
+    size_t got = fread(buffer, 1, len, sink->file);
+    return got ? (int)got : (ferror(sink->file) ? -1 : 0);
+}
+
+static uint16_t *sink_strip_begin(void *user_data, uint16_t y, uint16_t rows) {
+    sink_t *sink = user_data;
+    if (y != sink->next_row || y + rows > sink->height) {
+        return NULL;
+    }
+    return sink->image + (size_t)y * sink->width;
+}
+
+static esp_err_t sink_strip_end(void *user_data, uint16_t y, uint16_t rows) {
+    sink_t *sink = user_data;
+    sink->next_row = y + rows;
+    return ESP_OK;
+}
+
+static FILE *open_fixture(const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", FIXTURES_DIR, name);
+    FILE *file = fopen(path, "rb");
+    CHECK(file, "cannot open %s", path);
+    return file;
+}
+
+// Returns the decoded big-endian RGB565 image, or NULL.
+static uint16_t *decode(const fixture_t *fx, jpeg_scale_t scale, uint16_t *width, uint16_t *height) {
+    sink_t sink = {.file = open_fixture(fx->name)};
+    if (!sink.file) {
+        return NULL;
+    }
+    jpeg_decoder_config_t config = {
+        .read = sink_read,
+        .strip_begin = sink_strip_begin,
+        .strip_end = sink_strip_end,
+        .user_data = &sink,
+    };
+    jpeg_decoder_t *decoder = NULL;
+    jpeg_info_t info;
+    esp_err_t ret = jpeg_decoder_create(&decoder, &config);
+    if (ret == ESP_OK) {
+        ret = jpeg_decoder_read_header(decoder, &info);
+    }
+    if (ret == ESP_OK) {
+        CHECK(info.width == fx->width && info.height == fx->height, "%s header %ux%u", fx->name, info.width,
+              info.height);
+        sink.width = jpeg_scaled_size(info.width, scale);
+        sink.height = jpeg_scaled_size(info.height, scale);
+        sink.image = calloc((size_t)sink.width * sink.height, sizeof(uint16_t));
+        ret = jpeg_decoder_decode(decoder, scale);
+        CHECK(ret != ESP_OK || sink.next_row == sink.height, "%s 1/%u stopped at row %u", fx->name, 1u << scale,
+              sink.next_row);
+        jpeg_decoder_stats_t stats;
+        jpeg_decoder_get_stats(decoder, &stats);
+        CHECK(stats.context_bytes <= MAX_CONTEXT_BYTES, "%s context is %zu bytes", fx->name, stats.context_bytes);
+        size_t strip_rows = info.mcu_height >> scale < sink.height ? info.mcu_height >> scale : sink.height;
+        CHECK(stats.strip_bytes == (size_t)sink.width * strip_rows * sizeof(uint16_t), "%s 1/%u strip is %zu bytes",
+              fx->name, 1u << scale, stats.strip_bytes);
+    }
+    CHECK(ret == ESP_OK, "%s 1/%u decode failed: %d", fx->name, 1u << scale, ret);
+    jpeg_decoder_destroy(decoder);
+    fclose(sink.file);
+    if (ret != ESP_OK) {
+        free(sink.image);
+        return NULL;
+    }
+    *width = sink.width;
+    *height = sink.height;
+    return sink.image;
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} memory_source_t;
+
+static int memory_read(void *user_data, uint8_t *buffer, size_t len) {
+    memory_source_t *src = user_data;
+    size_t n = src->len - src->pos < len ? src->len - src->pos : len;
+    memcpy(buffer, src->data + src->pos, n);
+    src->pos += n;
+    return (int)n;
+}
+
+// A DHT whose code counts claim more codes of one length than there are
+// must be refused before any of them reach the lookup table.
+static void test_oversubscribed_dht(uint8_t length, uint8_t count) {
+    uint8_t file[2 + 4 + 1 + 16 + 256 + 2] = {0xFF, 0xD8, 0xFF, 0xC4};
+    size_t pos = 4;
+    uint16_t segment = (uint16_t)(2 + 1 + 16 + count);
+    file[pos++] = (uint8_t)(segment >> 8);
+    file[pos++] = (uint8_t)segment;
+    file[pos++] = 0x00; // DC table 0
+    for (int len = 1; len <= 16; ++len) {
+        file[pos++] = len == length ? count : 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        file[pos++] = (uint8_t)i;
+    }
+    file[pos++] = 0xFF;
+    file[pos++] = 0xD9;
+
+    memory_source_t src = {.data = file, .len = pos};
+    jpeg_decoder_config_t config = {
+        .read = memory_read,
+        .strip_begin = sink_strip_begin,
+        .strip_end = sink_strip_end,
+        .user_data = &src,
+    };
+    jpeg_decoder_t *decoder = NULL;
+    CHECK(jpeg_decoder_create(&decoder, &config) == ESP_OK, "create");
+    jpeg_info_t info;
+    esp_err_t ret = jpeg_decoder_read_header(decoder, &info);
+    CHECK(ret == ESP_ERR_INVALID_ARG, "%u codes of length %u: %d", count, length, ret);
+    jpeg_decoder_destroy(decoder);
+}
+
+#ifdef HAVE_LIBJPEG
+// libjpeg with replicated chroma, as the firmware does it.
+static void compare_libjpeg(const fixture_t *fx, const uint16_t *image, uint16_t width, uint16_t height) {
+    FILE *file = open_fixture(fx->name);
+    if (!file) {
+        return;
+    }
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.dct_method = JDCT_ISLOW;
+    jpeg_start_decompress(&cinfo);
+    CHECK(cinfo.output_width == width && cinfo.output_height == height, "%s libjpeg size %ux%u", fx->name, cinfo.output_width, cinfo.output_height);
+
+    uint8_t *row = malloc((size_t)cinfo.output_width * 3);
+    int worst = 0;
+    long total = 0;
+    while (cinfo.output_scanline < cinfo.output_height && cinfo.output_width == width) {
+        uint16_t y = cinfo.output_scanline;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+        for (uint16_t x = 0; x < width; ++x) {
+            uint16_t be = image[(size_t)y * width + x];
+            uint16_t px = (uint16_t)((be >> 8) | (be << 8));
+            int diff[3] = {
+                abs((px >> 11) - (row[x * 3] >> 3)),
+                abs(((px >> 5) & 0x3f) - (row[x * 3 + 1] >> 2)),
+                abs((px & 0x1f) - (row[x * 3 + 2] >> 3)),
+            };
+            for (int c = 0; c < 3; ++c) {
+                worst = diff[c] > worst ? diff[c] : worst;
+                total += diff[c];
+            }
+        }
+    }
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    free(row);
+    fclose(file);
+
+    double mean = (double)total / ((double)width * height * 3);
+    CHECK(worst <= MAX_STEPS && mean <= MAX_MEAN_STEPS, "%s differs from libjpeg: max %d, mean %.3f RGB565 steps",
+          fx->name, worst, mean);
+}
+#endif
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(s_fixtures) / sizeof(s_fixtures[0]); ++i) {
+        const fixture_t *fx = &s_fixtures[i];
+        for (jpeg_scale_t scale = JPEG_SCALE_1_1; scale <= JPEG_SCALE_1_8; ++scale) {
+            uint16_t width, height;
+            uint16_t *image = decode(fx, scale, &width, &height);
+            if (!image) {
+                continue;
+            }
+            uint32_t checksum = host_fnv1a(HOST_FNV1A_INIT, image, (size_t)width * height * sizeof(uint16_t));
+            printf("%-18s 1/%u %3ux%-3u 0x%08x\n", fx->name, 1u << scale, width, height, checksum);
+            CHECK(checksum == fx->checksum[scale], "%s 1/%u checksum 0x%08x, expected 0x%08x", fx->name, 1u << scale,
+                  checksum, fx->checksum[scale]);
+#ifdef HAVE_LIBJPEG
+            if (scale == JPEG_SCALE_1_1) {
+                compare_libjpeg(fx, image, width, height);
+            }
+#endif
+            free(image);
+        }
+    }
+    test_oversubscribed_dht(1, 200);
+    test_oversubscribed_dht(2, 5);
+    return host_test_result("test_jpeg_decoder");
+}
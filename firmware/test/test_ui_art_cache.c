@@ -0,0 +1,117 @@
+// Runs the album-art cache against a scratch directory: entries are stored,
+// hit and evicted least recently used first, and temporaries left by a
+// write that never finished are cleared by the first scan.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "host_test.h"
+#include "ui_art_cache.h"
+
+#define SIDE 8
+#define ENTRY_BYTES (sizeof(ui_art_cache_header_t) + SIDE * SIDE * sizeof(uint16_t))
+
+static char s_base[] = "/tmp/artXXXXXX";
+static char s_dir[32];
+
+static void source_path(int n, char *out, size_t len) {
+    snprintf(out, len, "%s/src%d.jpg", s_base, n);
+}
+
+static bool exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static bool store(ui_art_cache_t *cache, int n, uint16_t width, uint16_t height) {
+    char source[64];
+    source_path(n, source, sizeof(source));
+    ui_art_cache_writer_t writer;
+    if (ui_art_cache_write_begin(cache, source, width, height, &writer) != ESP_OK) {
+        return false;
+    }
+    uint16_t row[64];
+    for (uint16_t x = 0; x < width; ++x) {
+        row[x] = (uint16_t)(n * 1000 + x);
+    }
+    for (uint16_t y = 0; y < height; ++y) {
+        ui_art_cache_write(&writer, row, width);
+    }
+    return ui_art_cache_write_end(cache, &writer, true) == ESP_OK;
+}
+
+static bool hit(ui_art_cache_t *cache, int n) {
+    char source[64];
+    source_path(n, source, sizeof(source));
+    uint16_t width, height;
+    FILE *file = ui_art_cache_open(cache, source, &width, &height);
+    if (!file) {
+        return false;
+    }
+    uint16_t first;
+    CHECK(fread(&first, sizeof(first), 1, file) == 1 && first == n * 1000, "entry %d pixels", n);
+    fclose(file);
+    return true;
+}
+
+int main(void) {
+    CHECK(mkdtemp(s_base), "scratch directory");
+    snprintf(s_dir, sizeof(s_dir), "%s/AC", s_base);
+    for (int n = 0; n < 5; ++n) {
+        char source[64];
+        source_path(n, source, sizeof(source));
+        FILE *file = fopen(source, "wb");
+        fprintf(file, "cover %d", n);
+        fclose(file);
+    }
+
+    // A temporary from a write cut short before this boot.
+    mkdir(s_dir, 0755);
+    char stale[64];
+    snprintf(stale, sizeof(stale), "%s/DEADBEEF.tmp", s_dir);
+    fclose(fopen(stale, "wb"));
+
+    ui_art_cache_t cache;
+    ui_art_cache_init(&cache, s_dir, 3 * ENTRY_BYTES);
+    CHECK(!hit(&cache, 0), "empty cache hit");
+    CHECK(!exists(stale), "unfinished write left behind");
+
+    for (int n = 0; n < 3; ++n) {
+        CHECK(store(&cache, n, SIDE, SIDE), "store %d", n);
+    }
+    CHECK(cache.stats.bytes == 3 * ENTRY_BYTES && cache.stats.evictions == 0, "%u bytes, %u evictions",
+          (unsigned)cache.stats.bytes, (unsigned)cache.stats.evictions);
+
+    // 0 is used again, so 1 is now the oldest.
+    CHECK(hit(&cache, 0), "hit 0");
+    CHECK(store(&cache, 3, SIDE, SIDE), "store 3");
+    CHECK(cache.stats.evictions == 1, "%u evictions", (unsigned)cache.stats.evictions);
+    CHECK(!hit(&cache, 1), "1 should have been evicted");
+    CHECK(hit(&cache, 0) && hit(&cache, 2) && hit(&cache, 3), "survivors");
+
+    // An entry twice the size pushes out the two least recently used.
+    CHECK(hit(&cache, 2), "hit 2");
+    CHECK(store(&cache, 4, SIDE, 2 * SIDE), "store 4");
+    CHECK(cache.stats.evictions == 3, "%u evictions", (unsigned)cache.stats.evictions);
+    CHECK(!hit(&cache, 0) && !hit(&cache, 3), "0 and 3 should have been evicted");
+    CHECK(hit(&cache, 2) && hit(&cache, 4), "survivors");
+    CHECK(cache.stats.bytes <= 3 * ENTRY_BYTES, "%u bytes over the limit", (unsigned)cache.stats.bytes);
+
+    // A write that never ends leaves its temporary until the next boot.
+    char source[64];
+    source_path(1, source, sizeof(source));
+    ui_art_cache_writer_t writer;
+    CHECK(ui_art_cache_write_begin(&cache, source, SIDE, SIDE, &writer) == ESP_OK, "begin");
+    fclose(writer.file);
+    CHECK(exists(writer.path), "temporary");
+    ui_art_cache_init(&cache, s_dir, 3 * ENTRY_BYTES);
+    CHECK(hit(&cache, 2), "entries survive a restart");
+    CHECK(!exists(writer.path), "unfinished write left behind");
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", s_base);
+    CHECK(system(command) == 0, "cleanup");
+    return host_test_result("test_ui_art_cache");
+}
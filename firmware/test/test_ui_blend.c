@@ -0,0 +1,143 @@
+// Checks the blend kernels against a per-channel reference at every alpha,
+// for both alignments of the destination and lengths that leave odd heads
+// and tails around the pair loop, with guard pixels either side.
+#include <stdbool.h>
+
+#include "host_test.h"
+#include "ui_blend.h"
+
+#define MAX_PIXELS 40
+#define GUARD 0xA55A
+
+static uint32_t s_seed = 1;
+
+static uint32_t next_random(void) {
+    s_seed = (s_seed ^ (s_seed >> 15)) * 2654435761u + 12345u;
+    return s_seed >> 7;
+}
+
+// Pixels are in panel order: RGB565 with its bytes swapped.
+static uint16_t reference_pixel(uint16_t dst, uint16_t src, uint32_t alpha) {
+    if (alpha >= UI_ALPHA_OPAQUE) {
+        return src;
+    }
+    uint16_t d = (uint16_t)(dst >> 8 | dst << 8);
+    uint16_t s = (uint16_t)(src >> 8 | src << 8);
+    uint32_t keep = UI_ALPHA_OPAQUE - alpha;
+    uint32_t r = (((s >> 11) * alpha + (d >> 11) * keep) >> 5) << 11;
+    uint32_t g = ((((s >> 5) & 0x3F) * alpha + ((d >> 5) & 0x3F) * keep) >> 5) << 5;
+    uint32_t b = ((s & 0x1F) * alpha + (d & 0x1F) * keep) >> 5;
+    uint16_t out = (uint16_t)(r | g | b);
+    return (uint16_t)(out >> 8 | out << 8);
+}
+
+// Fills words so the span can start on either half; guard pixels sit on
+// both sides of dst[0..count).
+static uint16_t *fill_span(uint32_t *words, size_t word_count, int offset, uint16_t *before, size_t count) {
+    uint16_t *all = (uint16_t *)words;
+    for (size_t i = 0; i < word_count * 2; ++i) {
+        all[i] = GUARD;
+    }
+    uint16_t *dst = all + 1 + offset;
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = before[i] = (uint16_t)next_random();
+    }
+    return dst;
+}
+
+static bool guards_intact(const uint32_t *words, size_t word_count, const uint16_t *dst, size_t count) {
+    const uint16_t *all = (const uint16_t *)words;
+    for (size_t i = 0; i < word_count * 2; ++i) {
+        if ((all + i < dst || all + i >= dst + count) && all[i] != GUARD) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_fill(void) {
+    uint32_t words[MAX_PIXELS / 2 + 2];
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+    uint16_t before[MAX_PIXELS];
+    for (uint32_t alpha = 0; alpha <= UI_ALPHA_OPAQUE + 1; ++alpha) {
+        for (int offset = 0; offset < 2; ++offset) {
+            for (size_t count = 0; count <= MAX_PIXELS; ++count) {
+                uint16_t px = (uint16_t)next_random();
+                uint16_t *dst = fill_span(words, word_count, offset, before, count);
+                ui_blend_fill(dst, px, (uint8_t)alpha, count);
+                size_t wrong = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    wrong += dst[i] != (alpha ? reference_pixel(before[i], px, alpha) : before[i]);
+                }
+                CHECK(wrong == 0, "alpha %u, dst +%d, %zu pixels: %zu wrong", (unsigned)alpha, offset * 2, count, wrong);
+                CHECK(guards_intact(words, word_count, dst, count), "alpha %u, dst +%d, %zu pixels: wrote outside",
+                      (unsigned)alpha, offset * 2, count);
+            }
+        }
+    }
+}
+
+// Coverage as shapes produce it: runs of clear and opaque with antialiased
+// edges between, plus values above opaque.
+static uint8_t random_alpha(void) {
+    switch (next_random() % 5) {
+    case 0:
+    case 1:
+        return 0;
+    case 2:
+        return UI_ALPHA_OPAQUE;
+    case 3:
+        return (uint8_t)(UI_ALPHA_OPAQUE + next_random() % 224);
+    default:
+        return (uint8_t)(1 + next_random() % (UI_ALPHA_OPAQUE - 1));
+    }
+}
+
+static void test_mask(void) {
+    uint32_t words[MAX_PIXELS / 2 + 2];
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+    uint16_t before[MAX_PIXELS];
+    uint8_t alpha[MAX_PIXELS];
+    for (int round = 0; round < 64; ++round) {
+        for (int offset = 0; offset < 2; ++offset) {
+            for (size_t count = 0; count <= MAX_PIXELS; ++count) {
+                uint16_t px = (uint16_t)next_random();
+                for (size_t i = 0; i < count; ++i) {
+                    alpha[i] = random_alpha();
+                }
+                uint16_t *dst = fill_span(words, word_count, offset, before, count);
+                ui_blend_mask(dst, px, alpha, count);
+                size_t wrong = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    wrong += dst[i] != (alpha[i] ? reference_pixel(before[i], px, alpha[i]) : before[i]);
+                }
+                CHECK(wrong == 0, "round %d, dst +%d, %zu pixels: %zu wrong", round, offset * 2, count, wrong);
+                CHECK(guards_intact(words, word_count, dst, count), "round %d, dst +%d, %zu pixels: wrote outside",
+                      round, offset * 2, count);
+            }
+        }
+    }
+}
+
+// The inline single-pixel blend, exhaustively over alpha and each channel's
+// extremes against every destination.
+static void test_pixel(void) {
+    const uint16_t sources[] = {0x0000, 0xFFFF, 0x00F8, 0xE007, 0x1F00, 0x55AA};
+    size_t wrong = 0;
+    for (size_t s = 0; s < sizeof(sources) / sizeof(sources[0]); ++s) {
+        uint32_t src = ui_blend_expand(sources[s]);
+        for (uint32_t alpha = 1; alpha < UI_ALPHA_OPAQUE; ++alpha) {
+            for (uint32_t d = 0; d < 65536; ++d) {
+                wrong += ui_blend_pixel((uint16_t)d, src, alpha) != reference_pixel((uint16_t)d, sources[s], alpha);
+            }
+        }
+    }
+    CHECK(wrong == 0, "%zu single-pixel blends wrong", wrong);
+}
+
+int main(void) {
+    test_fill();
+    test_mask();
+    test_pixel();
+    return host_test_result("test_ui_blend");
+}